@@ -15,6 +15,8 @@
 #include "PPAC.hh"
 #include "Beam.hh"
 #include "DALI.hh"
+#include "HistogramRegistry.hh"
+#include "FillPlan.hh"
 #include "Globaldefs.h"
 using namespace TMath;
 using namespace std;
@@ -56,79 +58,87 @@ int main(int argc, char* argv[]){
     cout<<InputFiles[i]<<endl;
   }
   cout<<"output file: "<<OutFile<< endl;
-  TList *hlist = new TList();
+  HistogramRegistry* hreg = new HistogramRegistry();
   //histograms
 
   //ppacs
-  TH2F* tsumx_id = new TH2F("tsumx_id","tsumx_id",NPPACS,0,NPPACS,2500,0,250);hlist->Add(tsumx_id);
-  TH2F* tsumy_id = new TH2F("tsumy_id","tsumy_id",NPPACS,0,NPPACS,2500,0,250);hlist->Add(tsumy_id);
-  TH1F* tsumx[NPPACS];
-  TH1F* tsumy[NPPACS];
-  TH2F* ppacx_vs_time[NPPACS];
-  TH2F* ppacy_vs_time[NPPACS];
+  LazyHistogram* tsumx_id = hreg->H2("tsumx_id","tsumx_id",NPPACS,0,NPPACS,2500,0,250);
+  LazyHistogram* tsumy_id = hreg->H2("tsumy_id","tsumy_id",NPPACS,0,NPPACS,2500,0,250);
+  LazyHistogram* tsumx[NPPACS];
+  LazyHistogram* tsumy[NPPACS];
+  LazyHistogram* ppacx_vs_time[NPPACS];
+  LazyHistogram* ppacy_vs_time[NPPACS];
   
   for(unsigned short p=0;p<NPPACS;p++){
-    tsumx[p] = new TH1F(Form("tsumx_%d",p),Form("tsumx_%d",p),1000,-200,800);hlist->Add(tsumx[p]);
-    tsumy[p] = new TH1F(Form("tsumy_%d",p),Form("tsumy_%d",p),1000,-200,800);hlist->Add(tsumy[p]);
-    ppacx_vs_time[p] = new TH2F(Form("ppacx_vs_time_%d",p),Form("ppacx_vs_time_%d",p),10000,0,100e6,500,-100,100);hlist->Add(ppacx_vs_time[p]);
-    ppacy_vs_time[p] = new TH2F(Form("ppacy_vs_time_%d",p),Form("ppacy_vs_time_%d",p),10000,0,100e6,500,-100,100);hlist->Add(ppacy_vs_time[p]);
+    tsumx[p] = hreg->H1(Form("tsumx_%d",p),Form("tsumx_%d",p),1000,-200,800);
+    tsumy[p] = hreg->H1(Form("tsumy_%d",p),Form("tsumy_%d",p),1000,-200,800);
+    ppacx_vs_time[p] = hreg->H2(Form("ppacx_vs_time_%d",p),Form("ppacx_vs_time_%d",p),10000,0,100e6,500,-100,100);
+    ppacy_vs_time[p] = hreg->H2(Form("ppacy_vs_time_%d",p),Form("ppacy_vs_time_%d",p),10000,0,100e6,500,-100,100);
   }
   //focal planes
-  TH2F* dT_vs_logQ[NFPLANES];
-  TH2F* logQ_vs_X[NFPLANES];
-  TH2F* dT_vs_X[NFPLANES];
+  LazyHistogram* dT_vs_logQ[NFPLANES];
+  LazyHistogram* logQ_vs_X[NFPLANES];
+  LazyHistogram* dT_vs_X[NFPLANES];
   for(unsigned short f=0;f<NFPLANES;f++){
-    dT_vs_logQ[f] = new TH2F(Form("dT_vs_logQ_%d",fpID[f]),Form("dT_vs_logQ_%d",fpID[f]),1000,-5,5,300,-3,3);hlist->Add( dT_vs_logQ[f]);
-    logQ_vs_X[f] = new TH2F(Form("logQ_vs_X_%d",fpID[f]),Form("logQ_vs_X_%d",fpID[f]),1000,-50,50,300,-3,3);hlist->Add( logQ_vs_X[f]);
-    dT_vs_X[f] = new TH2F(Form("dT_vs_X_%d",fpID[f]),Form("dT_vs_X_%d",fpID[f]),1000,-50,50,1000,-5,5);hlist->Add( dT_vs_X[f]);
+    dT_vs_logQ[f] = hreg->H2(Form("dT_vs_logQ_%d",fpID[f]),Form("dT_vs_logQ_%d",fpID[f]),1000,-5,5,300,-3,3);
+    logQ_vs_X[f] = hreg->H2(Form("logQ_vs_X_%d",fpID[f]),Form("logQ_vs_X_%d",fpID[f]),1000,-50,50,300,-3,3);
+    dT_vs_X[f] = hreg->H2(Form("dT_vs_X_%d",fpID[f]),Form("dT_vs_X_%d",fpID[f]),1000,-50,50,1000,-5,5);
   }
   //beam
-  TH1F* beta[3];
+  LazyHistogram* beta[3];
   for(unsigned short b=0;b<3;b++){
-    beta[b] = new TH1F(Form("beta_%d",b),Form("beta_%d",b),1000,0,1);hlist->Add(beta[b]);
+    beta[b] = hreg->H1(Form("beta_%d",b),Form("beta_%d",b),1000,0,1);
   }
-  TH1F* delta[4];
+  LazyHistogram* delta[4];
   for(unsigned short b=0;b<4;b++){
-    delta[b] = new TH1F(Form("delta_%d",b),Form("delta_%d",b),1000,-10,10);hlist->Add(delta[b]);
+    delta[b] = hreg->H1(Form("delta_%d",b),Form("delta_%d",b),1000,-10,10);
   }
 
-  //dali
-  TH2F* adc_id = new TH2F("adc_id","adc_id",250,0,250,5000,0,5000);hlist->Add(adc_id);
-  TH2F* en_id = new TH2F("en_id","en_id",250,0,250,500,0,2000);hlist->Add(en_id);
-  TH2F* enF_id = new TH2F("enF_id","enF_id",250,0,250,2000,0,2000);hlist->Add(enF_id);
-  TH2F* enDC_id = new TH2F("enDC_id","enDC_id",250,0,250,500,0,2000);hlist->Add(enDC_id);
-  TH2F* time_id = new TH2F("time_id","time_id",250,0,250,2000,-2000,0);hlist->Add(time_id);
-  TH2F* time_id_g = new TH2F("time_id_g","time_id_g",250,0,250,2000,-2000,0);hlist->Add(time_id_g);
-  TH2F* toffset_id = new TH2F("toffset_id","toffset_id",250,0,250,1000,-200,800);hlist->Add(toffset_id);
+  //dali, the hits of an event are filled from a plan
+  FillPlan* hits = new FillPlan(hreg);
+  int id = hits->Variable("id");
+  int adc = hits->Variable("adc");
+  int en = hits->Variable("en");
+  int dcen = hits->Variable("dcen");
+  int tdc = hits->Variable("time");
+  int toffset = hits->Variable("toffset");
+  hits->H2("adc_id",id,250,0,250,adc,5000,0,5000);
+  hits->H2("en_id",id,250,0,250,en,500,0,2000);
+  hits->H2("enF_id",id,250,0,250,en,2000,0,2000);
+  hits->H2("enDC_id",id,250,0,250,dcen,500,0,2000);
+  hits->H2("time_id",id,250,0,250,tdc,2000,-2000,0);
+  int time_id_g = hits->H2("time_id_g",id,250,0,250,tdc,2000,-2000,0);
+  hits->GateAbove(time_id_g,en,500);
+  hits->H2("toffset_id",id,250,0,250,toffset,1000,-200,800);
 
   //PID
-  TH2F* z_vs_aoq[6];
-  TH2F* z_vs_aoqc[6];
-  TH2F* euz_vs_aoq[6];
-  TH2F* euz_vs_aoqc[6];
-  TH2F* euaoq_vs_time[6];
-  TH2F* euz_vs_time[6];
-  TH2F* gez_vs_aoq[6];
-  TH2F* gez_vs_aoqc[6];
-  TH2F* gezraw_vs_aoq[6];
-  TH2F* gezraw_vs_aoqc[6];
-  TH2F* geaoq_vs_time[6];
-  TH2F* gez_vs_time[6];
-  TH2F* gezraw_vs_time[6];
+  LazyHistogram* z_vs_aoq[6];
+  LazyHistogram* z_vs_aoqc[6];
+  LazyHistogram* euz_vs_aoq[6];
+  LazyHistogram* euz_vs_aoqc[6];
+  LazyHistogram* euaoq_vs_time[6];
+  LazyHistogram* euz_vs_time[6];
+  LazyHistogram* gez_vs_aoq[6];
+  LazyHistogram* gez_vs_aoqc[6];
+  LazyHistogram* gezraw_vs_aoq[6];
+  LazyHistogram* gezraw_vs_aoqc[6];
+  LazyHistogram* geaoq_vs_time[6];
+  LazyHistogram* gez_vs_time[6];
+  LazyHistogram* gezraw_vs_time[6];
    for(unsigned short f=0;f<6;f++){
-    z_vs_aoq[f] = new TH2F(Form("z_vs_aoq_%d",f),Form("z_vs_aoq_%d",f),1000,1.8,2.2,1000,30,40);hlist->Add(z_vs_aoq[f]);
-    z_vs_aoqc[f] = new TH2F(Form("z_vs_aoqc_%d",f),Form("z_vs_aoqc_%d",f),1000,1.8,2.2,1000,30,40);hlist->Add(z_vs_aoqc[f]);
-    euz_vs_aoq[f] = new TH2F(Form("euz_vs_aoq_%d",f),Form("euz_vs_aoq_%d",f),1000,2.5,3.5,1000,15,30);hlist->Add(euz_vs_aoq[f]);
-    euz_vs_aoqc[f] = new TH2F(Form("euz_vs_aoqc_%d",f),Form("euz_vs_aoqc_%d",f),1000,2.5,3.5,1000,15,30);hlist->Add(euz_vs_aoqc[f]);
-    euaoq_vs_time[f] = new TH2F(Form("euaoq_vs_time_%d",f),Form("euaoq_vs_time_%d",f),5000,0,50e6,1000,2.5,3.0);hlist->Add(euaoq_vs_time[f]);
-    euz_vs_time[f] = new TH2F(Form("euz_vs_time_%d",f),Form("euz_vs_time_%d",f),5000,0,50e6,1000,15,30);hlist->Add(euz_vs_time[f]);
-    gez_vs_aoq[f] = new TH2F(Form("gez_vs_aoq_%d",f),Form("gez_vs_aoq_%d",f),1000,1.8,2.2,1000,20,40);hlist->Add(gez_vs_aoq[f]);
-    gez_vs_aoqc[f] = new TH2F(Form("gez_vs_aoqc_%d",f),Form("gez_vs_aoqc_%d",f),1000,1.8,2.2,1000,20,40);hlist->Add(gez_vs_aoqc[f]);
-    gezraw_vs_aoq[f] = new TH2F(Form("gezraw_vs_aoq_%d",f),Form("gezraw_vs_aoq_%d",f),1000,1.8,2.2,1000,1,5);hlist->Add(gezraw_vs_aoq[f]);
-    gezraw_vs_aoqc[f] = new TH2F(Form("gezraw_vs_aoqc_%d",f),Form("gezraw_vs_aoqc_%d",f),1000,1.8,2.2,1000,1,5);hlist->Add(gezraw_vs_aoqc[f]);
-    geaoq_vs_time[f] = new TH2F(Form("geaoq_vs_time_%d",f),Form("geaoq_vs_time_%d",f),10000,0,100e6,1000,1.8,2.2);hlist->Add(geaoq_vs_time[f]);
-    gez_vs_time[f] = new TH2F(Form("gez_vs_time_%d",f),Form("gez_vs_time_%d",f),10000,0,100e6,1000,10,50);hlist->Add(gez_vs_time[f]);
-    gezraw_vs_time[f] = new TH2F(Form("gezraw_vs_time_%d",f),Form("gezraw_vs_time_%d",f),10000,0,100e6,1000,1,5);hlist->Add(gezraw_vs_time[f]);
+    z_vs_aoq[f] = hreg->H2(Form("z_vs_aoq_%d",f),Form("z_vs_aoq_%d",f),1000,1.8,2.2,1000,30,40);
+    z_vs_aoqc[f] = hreg->H2(Form("z_vs_aoqc_%d",f),Form("z_vs_aoqc_%d",f),1000,1.8,2.2,1000,30,40);
+    euz_vs_aoq[f] = hreg->H2(Form("euz_vs_aoq_%d",f),Form("euz_vs_aoq_%d",f),1000,2.5,3.5,1000,15,30);
+    euz_vs_aoqc[f] = hreg->H2(Form("euz_vs_aoqc_%d",f),Form("euz_vs_aoqc_%d",f),1000,2.5,3.5,1000,15,30);
+    euaoq_vs_time[f] = hreg->H2(Form("euaoq_vs_time_%d",f),Form("euaoq_vs_time_%d",f),5000,0,50e6,1000,2.5,3.0);
+    euz_vs_time[f] = hreg->H2(Form("euz_vs_time_%d",f),Form("euz_vs_time_%d",f),5000,0,50e6,1000,15,30);
+    gez_vs_aoq[f] = hreg->H2(Form("gez_vs_aoq_%d",f),Form("gez_vs_aoq_%d",f),1000,1.8,2.2,1000,20,40);
+    gez_vs_aoqc[f] = hreg->H2(Form("gez_vs_aoqc_%d",f),Form("gez_vs_aoqc_%d",f),1000,1.8,2.2,1000,20,40);
+    gezraw_vs_aoq[f] = hreg->H2(Form("gezraw_vs_aoq_%d",f),Form("gezraw_vs_aoq_%d",f),1000,1.8,2.2,1000,1,5);
+    gezraw_vs_aoqc[f] = hreg->H2(Form("gezraw_vs_aoqc_%d",f),Form("gezraw_vs_aoqc_%d",f),1000,1.8,2.2,1000,1,5);
+    geaoq_vs_time[f] = hreg->H2(Form("geaoq_vs_time_%d",f),Form("geaoq_vs_time_%d",f),10000,0,100e6,1000,1.8,2.2);
+    gez_vs_time[f] = hreg->H2(Form("gez_vs_time_%d",f),Form("gez_vs_time_%d",f),10000,0,100e6,1000,10,50);
+    gezraw_vs_time[f] = hreg->H2(Form("gezraw_vs_time_%d",f),Form("gezraw_vs_time_%d",f),10000,0,100e6,1000,1,5);
 
   
   } 
@@ -211,17 +221,15 @@ int main(int argc, char* argv[]){
     //dali
     for(unsigned short g=0;g<dali->GetMult();g++){
       DALIHit * hit = dali->GetHit(g);
-      short id = hit->GetID();
-      adc_id->Fill(id,hit->GetADC());
-      en_id->Fill(id,hit->GetEnergy());
-      enF_id->Fill(id,hit->GetEnergy());
-      enDC_id->Fill(id,hit->GetDCEnergy());
-      time_id->Fill(id,hit->GetTime());
-      if(hit->GetEnergy()>500){
-	time_id_g->Fill(id,hit->GetTime());
-      }
-      toffset_id->Fill(id,hit->GetTOffset());
+      hits->Set(id,hit->GetID());
+      hits->Set(adc,hit->GetADC());
+      hits->Set(en,hit->GetEnergy());
+      hits->Set(dcen,hit->GetDCEnergy());
+      hits->Set(tdc,hit->GetTime());
+      hits->Set(toffset,hit->GetTOffset());
+      hits->Next();
     }
+    hits->Fill();
     //focal planes
     for(unsigned short f=0;f<NFPLANES;f++){
       Plastic *pl = fp[f]->GetPlastic();
@@ -260,17 +268,8 @@ int main(int argc, char* argv[]){
   cout << endl;
   cout << "creating outputfile " << endl;
   TFile* ofile = new TFile(OutFile,"recreate");
-  TH1F* h1;
-  TH2F* h2;
-  TIter next(hlist);
-  while( (h1 = (TH1F*)next()) ){
-    if(h1->GetEntries()>0)
-      h1->Write("",TObject::kOverwrite);
-  }
-  while( (h2 = (TH2F*)next()) ){
-    if(h2->GetEntries()>0)
-      h2->Write("",TObject::kOverwrite);
-  }
+  hreg->Write();
+  hreg->MemoryReport(Verbose>0);
   ofile->Close();
   double time_end = get_time();
   cout << "Program Run time: " << time_end - time_start << " s." << endl;
@@ -0,0 +1,244 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/time.h>
+#include <signal.h>
+#include "TMath.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TRandom3.h"
+#include "TClonesArray.h"
+#include "TStopwatch.h"
+#include "TArtEventInfo.hh"
+#include "TArtGeCluster.hh"
+
+#include "CommandLineInterface.hh"
+#include "Beam.hh"
+#include "FocalPlane.hh"
+#include "WASABI.hh"
+#include "Globaldefs.h"
+
+using namespace TMath;
+using namespace std;
+
+bool signal_received = false;
+void signalhandler(int sig);
+double get_time();
+vector<double> Poisson(TRandom3* rand, double rate, double duration);
+unsigned long long int Timestamp(double time, double segment, double delay, double ticks);
+int main(int argc, char* argv[]){
+  double time_start = get_time();
+  TStopwatch timer;
+  timer.Start();
+  signal(SIGINT,signalhandler);
+  cout << "\"The Elephants\" (1948), Salvador Dali" << endl;
+  cout << "Generator of synthetic BigRIPS, WASABI, and EURICA trees for the event building" << endl;
+  char* OutFile = NULL;
+  double Duration = 60;
+  double Ticks = 1e8;
+  double RateBR = 1000;
+  double RateWA = 500;
+  double RateEU = 2000;
+  double CoincWA = 0.1;
+  double CoincEU = 0.1;
+  double OffsetWA = 500;
+  double OffsetEU = 1000;
+  double Jitter = 50;
+  int Resets = 0;
+  double ResetDelay = 0;
+  double MultWA = 2;
+  int Seed = 4357;
+  int Verbose = 0;
+  //Read in the command line arguments
+  CommandLineInterface* interface = new CommandLineInterface();
+  interface->Add("-o", "output file prefix, writes prefix_bigrips.root, prefix_wasabi.root, prefix_eurica.root", &OutFile);
+  interface->Add("-d", "duration of the run in s", &Duration);
+  interface->Add("-t", "timestamp ticks per s", &Ticks);
+  interface->Add("-rb", "BigRIPS rate in Hz", &RateBR);
+  interface->Add("-rw", "rate of WASABI entries without BigRIPS in Hz", &RateWA);
+  interface->Add("-re", "rate of EURICA entries without BigRIPS in Hz", &RateEU);
+  interface->Add("-cw", "fraction of BigRIPS entries with a WASABI coincidence", &CoincWA);
+  interface->Add("-ce", "fraction of BigRIPS entries with a EURICA coincidence", &CoincEU);
+  interface->Add("-ow", "offset of coincident WASABI entries in ticks", &OffsetWA);
+  interface->Add("-oe", "offset of coincident EURICA entries in ticks", &OffsetEU);
+  interface->Add("-j", "jitter (sigma) of coincident entries in ticks", &Jitter);
+  interface->Add("-nr", "number of timestamp resets", &Resets);
+  interface->Add("-rd", "delay of the WASABI timestamp reset with respect to the others in s", &ResetDelay);
+  interface->Add("-m", "mean number of WASABI hits per DSSSD side", &MultWA);
+  interface->Add("-s", "random seed", &Seed);
+  interface->Add("-v", "verbose level", &Verbose);
+  interface->CheckFlags(argc, argv);
+  if(OutFile == NULL){
+    cout << "No output file prefix given " << endl;
+    return 2;
+  }
+  if(Resets<0)
+    Resets = 0;
+  TRandom3* rand = new TRandom3(Seed);
+  double segment = Duration/(Resets+1);
+
+  //times of all entries, coincident ones are derived from BigRIPS
+  vector<double> timesBR = Poisson(rand, RateBR, Duration);
+  vector<double> timesWA = Poisson(rand, RateWA, Duration);
+  vector<double> timesEU = Poisson(rand, RateEU, Duration);
+  for(vector<double>::iterator br=timesBR.begin(); br!=timesBR.end(); br++){
+    if(rand->Uniform(0,1)<CoincWA){
+      double time = *br + (OffsetWA + rand->Gaus(0,Jitter))/Ticks;
+      if(time>0 && time<Duration)
+	timesWA.push_back(time);
+    }
+    if(rand->Uniform(0,1)<CoincEU){
+      double time = *br + (OffsetEU + rand->Gaus(0,Jitter))/Ticks;
+      if(time>0 && time<Duration)
+	timesEU.push_back(time);
+    }
+  }
+  sort(timesWA.begin(), timesWA.end());
+  sort(timesEU.begin(), timesEU.end());
+  cout << timesBR.size() << " BigRIPS, " << timesWA.size() << " WASABI, and " << timesEU.size() << " EURICA entries" << endl;
+
+  //BigRIPS
+  TFile* ofile = new TFile(Form("%s_bigrips.root",OutFile),"recreate");
+  TTree* tr = new TTree("tr","synthetic BigRIPS data");
+  unsigned long long int timestamp = 0;
+  Beam* beam = new Beam;
+  FocalPlane* fp[NFPLANES];
+  tr->Branch("timestamp",&timestamp,"timestamp/l");
+  tr->Branch("beam",&beam,320000);
+  for(unsigned short f=0;f<NFPLANES;f++){
+    fp[f] = new FocalPlane;
+    tr->Branch(Form("fp%d",fpID[f]),&fp[f],320000);
+  }
+  for(unsigned int i=0;i<timesBR.size() && !signal_received;i++){
+    timestamp = Timestamp(timesBR[i], segment, 0, Ticks);
+    beam->Clear();
+    for(unsigned short j=0;j<6;j++)
+      beam->SetAQZ(j, rand->Gaus(2.5,0.01), rand->Gaus(50,0.5));
+    for(unsigned short j=0;j<3;j++)
+      beam->SetTOFBeta(j, rand->Gaus(200,1), rand->Gaus(0.6,0.01));
+    for(unsigned short f=0;f<NFPLANES;f++){
+      fp[f]->Clear();
+      Track track;
+      track.Set(rand->Gaus(0,10), rand->Gaus(0,10), rand->Gaus(0,5), rand->Gaus(0,5));
+      fp[f]->SetTrack(track);
+      Plastic plastic;
+      plastic.SetTime(rand->Gaus(100,1), rand->Gaus(100,1));
+      plastic.SetCharge(rand->Gaus(1000,50), rand->Gaus(1000,50));
+      fp[f]->SetPlastic(plastic);
+      MUSIC music;
+      music.SetNHits(6);
+      music.SetEnergy(rand->Gaus(500,20), rand->Gaus(250000,10000));
+      fp[f]->SetMUSIC(music);
+    }
+    tr->Fill();
+    if(Verbose>1)
+      cout << "BigRIPS " << i << "\t" << timestamp << endl;
+  }
+  tr->Write("",TObject::kOverwrite);
+  ofile->Close();
+
+  //WASABI
+  ofile = new TFile(Form("%s_wasabi.root",OutFile),"recreate");
+  tr = new TTree("tr","synthetic WASABI data");
+  WASABI* wasabi = new WASABI;
+  tr->Branch("timestamp",&timestamp,"timestamp/l");
+  tr->Branch("wasabi",&wasabi,320000);
+  for(unsigned int i=0;i<timesWA.size() && !signal_received;i++){
+    timestamp = Timestamp(timesWA[i], segment, ResetDelay, Ticks);
+    wasabi->Clear();
+    for(int d=0;d<NDSSSD;d++){
+      DSSSD* dsssd = wasabi->GetDSSSD(d);
+      int mult = rand->Poisson(MultWA);
+      for(int h=0;h<mult;h++){
+	WASABIHit* hit = new WASABIHit(rand->Integer(NXSTRIPS), rand->Exp(1000), true);
+	hit->SetTime(rand->Gaus(1000,20));
+	dsssd->AddHitX(hit);
+      }
+      mult = rand->Poisson(MultWA);
+      for(int h=0;h<mult;h++){
+	WASABIHit* hit = new WASABIHit(rand->Integer(NYSTRIPS), rand->Exp(1000), true);
+	hit->SetTime(rand->Gaus(1000,20));
+	dsssd->AddHitY(hit);
+      }
+    }
+    tr->Fill();
+    if(Verbose>1)
+      cout << "WASABI " << i << "\t" << timestamp << endl;
+  }
+  tr->Write("",TObject::kOverwrite);
+  ofile->Close();
+
+  //EURICA, only the timestamps, the Ge clusters are left empty
+  ofile = new TFile(Form("%s_eurica.root",OutFile),"recreate");
+  tr = new TTree("tree","synthetic EURICA data");
+  TClonesArray* eventinfo = new TClonesArray("TArtEventInfo",1);
+  TClonesArray* cluster = new TClonesArray("TArtGeCluster",1);
+  TClonesArray* clusterAB = new TClonesArray("TArtGeCluster",1);
+  tr->Branch("EventInfo",&eventinfo);
+  tr->Branch("GeCluster",&cluster);
+  tr->Branch("GeAddback",&clusterAB);
+  for(unsigned int i=0;i<timesEU.size() && !signal_received;i++){
+    timestamp = Timestamp(timesEU[i], segment, 0, Ticks);
+    TArtEventInfo* info = (TArtEventInfo*)eventinfo->ConstructedAt(0);
+    info->SetEventNumber(i);
+    info->SetTimeStamp(timestamp);
+    tr->Fill();
+    if(Verbose>1)
+      cout << "EURICA " << i << "\t" << timestamp << endl;
+  }
+  tr->Write("",TObject::kOverwrite);
+  ofile->Close();
+
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  timer.Stop();
+  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+  return 0;
+}
+/*!
+  Times of a Poisson process
+  \param rand the random generator
+  \param rate the rate in Hz
+  \param duration the length of the run in s
+  \return the times in s
+*/
+vector<double> Poisson(TRandom3* rand, double rate, double duration){
+  vector<double> times;
+  if(rate<=0)
+    return times;
+  double time = rand->Exp(1./rate);
+  while(time<duration){
+    times.push_back(time);
+    time += rand->Exp(1./rate);
+  }
+  return times;
+}
+/*!
+  Timestamp of an entry, the timestamps are reset after each segment
+  \param time the time in s
+  \param segment the time between two resets in s
+  \param delay the delay of the reset in s
+  \param ticks the timestamp ticks per s
+  \return the timestamp
+*/
+unsigned long long int Timestamp(double time, double segment, double delay, double ticks){
+  double reset = floor((time - delay)/segment);
+  double start = 0;
+  if(reset>0)
+    start = reset*segment + delay;
+  return (unsigned long long int)(1000 + (time - start)*ticks);
+}
+void signalhandler(int sig){
+  if (sig == SIGINT){
+    signal_received = true;
+  }
+}
+
+double get_time(){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    double d = t.tv_sec + (double) t.tv_usec/1000000;
+    return d;
+}
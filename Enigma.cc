@@ -0,0 +1,189 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <sys/time.h>
+#include <signal.h>
+#include "TMath.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TStopwatch.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TFileMerger.h"
+#include "CommandLineInterface.hh"
+#include "Calibration.hh"
+#include "WASABI.hh"
+#include "Globaldefs.h"
+
+using namespace TMath;
+using namespace std;
+atomic<bool> signal_received(false);
+void signalhandler(int sig);
+void Recalibrate(char* InputFile, char* SetFile, string OutFile, long long int first, long long int end, int Verbose, int slice);
+double get_time();
+int main(int argc, char* argv[]){
+  double time_start = get_time();
+  TStopwatch timer;
+  timer.Start();
+  signal(SIGINT,signalhandler);
+  cout << "\"The Enigma of Desire\" (1929), Salvador Dali" << endl;
+  cout << "Recalibration of unpacked WASABI data" << endl;
+  char* InputFile = NULL;
+  char* OutFile = NULL;
+  char* SetFile = NULL;
+  int LastEvent = -1;
+  int Threads = 1;
+  int Verbose = 0;
+  //Read in the command line arguments
+  CommandLineInterface* interface = new CommandLineInterface();
+  interface->Add("-i", "input file, output of Flames", &InputFile);
+  interface->Add("-o", "output file", &OutFile);
+  interface->Add("-s", "settings file", &SetFile);
+  interface->Add("-le", "last event to be read", &LastEvent);
+  interface->Add("-nt", "number of threads, the entries are split into ranges calibrated in parallel", &Threads);
+  interface->Add("-v", "verbose level", &Verbose);
+  interface->CheckFlags(argc, argv);
+  //Complain about missing mandatory arguments
+  if(InputFile == NULL || OutFile == NULL){
+    cerr<<"You have to provide the input file and the output file!"<<endl;
+    return 1;
+  }
+  if(SetFile == NULL)
+    cerr<<"No settings file! Using standard values"<<endl;
+  else
+    cout<<"settings file:"<<SetFile<<endl;
+  cout<<"input file: "<<InputFile<<endl;
+  TFile* infile = new TFile(InputFile);
+  TTree* tr = (TTree*)infile->Get("tr");
+  if(tr == NULL){
+    cout << "could not find tree tr in file " << infile->GetName() << endl;
+    return 3;
+  }
+  if(tr->GetBranch("wasabiRAW") == NULL){
+    cout << "could not find branch wasabiRAW in tree tr" << endl;
+    return 3;
+  }
+  long long int nentries = tr->GetEntries();
+  if(LastEvent>0 && LastEvent<nentries)
+    nentries = LastEvent;
+  //each thread opens the input file itself
+  infile->Close();
+  cout << nentries << " entries to be calibrated" << endl;
+
+  if(Threads<2){
+    cout<<"output file: "<<OutFile<< endl;
+    Recalibrate(InputFile, SetFile, OutFile, 0, nentries, Verbose, 0);
+  }
+  else{
+    ROOT::EnableThreadSafety();
+    string base(OutFile);
+    if(base.size()>5 && base.substr(base.size()-5)==".root")
+      base = base.substr(0,base.size()-5);
+    vector<string> slicefiles;
+    vector<thread> workers;
+    cout << "calibrating " << Threads << " ranges of entries in parallel" << endl;
+    for(int i=0;i<Threads;i++){
+      long long int first = nentries*i/Threads;
+      long long int end = nentries*(i+1)/Threads;
+      slicefiles.push_back(Form("%s_slice%d.root",base.c_str(),i));
+      workers.push_back(thread(Recalibrate, InputFile, SetFile, slicefiles.back(), first, end, Verbose, i));
+    }
+    for(unsigned int i=0;i<workers.size();i++)
+      workers[i].join();
+
+    //combine the ranges in entry order
+    cout<<"output file: "<<OutFile<< endl;
+    TFileMerger* merger = new TFileMerger(kFALSE);
+    merger->OutputFile(OutFile,"RECREATE");
+    for(unsigned int i=0;i<slicefiles.size();i++)
+      merger->AddFile(slicefiles[i].c_str());
+    if(!merger->Merge())
+      cout << "combining the ranges failed, the slices are kept" << endl;
+    else{
+      for(unsigned int i=0;i<slicefiles.size();i++)
+	gSystem->Unlink(slicefiles[i].c_str());
+    }
+    delete merger;
+  }
+  cout << "the output tree has the same entries as the input, it can be added as a friend, e.g. tr->AddFriend(\"recal=tr\",\"" << OutFile << "\")" << endl;
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  timer.Stop();
+  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+  return 0;
+}
+/*!
+  Calibrate a range of entries into its own output file, executed in a separate thread for parallel calibration.
+  Only the raw WASABI data and the timestamp are read. The entry number is passed to the calibration, so the result does not depend on the number of threads.
+*/
+void Recalibrate(char* InputFile, char* SetFile, string OutFile, long long int first, long long int end, int Verbose, int slice){
+  double time_start = get_time();
+  TFile* infile = new TFile(InputFile);
+  TTree* tr = (TTree*)infile->Get("tr");
+  tr->SetBranchStatus("*",0);
+  tr->SetBranchStatus("eventnumber",1);
+  tr->SetBranchStatus("timestamp",1);
+  tr->SetBranchStatus("wasabiRAW",1);
+  tr->SetBranchStatus("wasabiRAW.*",1);
+  int eventnumber = 0;
+  unsigned long long int timestamp = 0;
+  WASABIRaw* wasabiRAW = new WASABIRaw;
+  tr->SetBranchAddress("eventnumber",&eventnumber);
+  tr->SetBranchAddress("timestamp",&timestamp);
+  tr->SetBranchAddress("wasabiRAW",&wasabiRAW);
+
+  Calibration* cal = new Calibration(SetFile);
+
+  TFile* ofile = new TFile(OutFile.c_str(),"recreate");
+  ofile->cd();
+  TTree* otr = new TTree("tr","Recalibrated Data Tree");
+  otr->Branch("eventnumber",&eventnumber,"eventnumber/I");
+  otr->Branch("timestamp",&timestamp,"timestamp/l");
+  WASABI* wasabi = new WASABI;
+  otr->Branch("wasabi",&wasabi,320000);
+
+  Int_t status;
+  for(long long int i=first; i<end; i++){
+    if(signal_received){
+      break;
+    }
+    wasabiRAW->Clear();
+    status = tr->GetEntry(i);
+    if(status == -1){
+      cerr<<"Error occured, couldn't read entry "<<i<<" from tree "<<tr->GetName()<<" in file "<<infile->GetName()<<endl;
+      break;
+    }
+    else if(status == 0){
+      cerr<<"Error occured, entry "<<i<<" in tree "<<tr->GetName()<<" in file "<<infile->GetName()<<" doesn't exist"<<endl;
+      break;
+    }
+    cal->BuildWASABI(wasabiRAW, wasabi, i);
+    if(Verbose>1)
+      wasabi->Print();
+    otr->Fill();
+    if(slice==0 && (i-first)%10000 == 0){
+      double time_end = get_time();
+      cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*(i-first))/(end-first) <<
+	" % done\t" << (Float_t)(i-first)/(time_end - time_start) << " events/s \r" << flush;
+    }
+  }
+  cout << "range " << slice << " finished, " << otr->GetEntries() << " entries" << endl;
+  otr->Write("",TObject::kOverwrite);
+  ofile->Close();
+  infile->Close();
+}
+void signalhandler(int sig){
+  if (sig == SIGINT){
+    signal_received = true;
+  }
+}
+
+double get_time(){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    double d = t.tv_sec + (double) t.tv_usec/1000000;
+    return d;
+}
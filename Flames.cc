@@ -2,6 +2,9 @@
 #include <iomanip>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <sys/time.h>
 #include <signal.h>
 #include "TArtStoreManager.hh"
@@ -11,6 +14,7 @@
 #include "TFile.h"
 #include "TTree.h"
 #include "TStopwatch.h"
+#include "TROOT.h"
 
 
 #include "CommandLineInterface.hh"
@@ -25,6 +29,70 @@ using namespace std;
 bool signal_received = false;
 void signalhandler(int sig);
 double get_time();
+
+/*!
+  One data word of the WASABI ADC or TDC segments
+*/
+struct rawword{
+  //! detector ID of the segment, BETAA or BETAT
+  int detector;
+  //! geo address of the module
+  int geo;
+  //! channel
+  int ch;
+  //! value
+  int val;
+};
+
+/*!
+  One event in the unpacking pipeline
+*/
+struct unpackjob{
+  //! entry number in the output tree
+  unsigned long long int entry;
+  //! original event number
+  int eventnumber;
+  //! timestamp
+  unsigned long long int timestamp;
+  //! trigger bit
+  int trigger;
+  //! data words copied from the event store
+  vector<rawword> words;
+  //! decoded raw data
+  WASABIRaw* raw;
+  //! calibrated data
+  WASABI* wasabi;
+  //! decoding and calibration are finished
+  bool done;
+};
+
+/*!
+  The events between the reader, the calibration workers, and the writer.
+  Events are numbered in input order, event n is kept in jobs[n%jobs.size()].
+*/
+struct pipeline{
+  //! ring buffer of events
+  vector<unpackjob> jobs;
+  //! number of events read
+  unsigned long long int nread;
+  //! number of events taken by a worker
+  unsigned long long int nwork;
+  //! number of events written
+  unsigned long long int nwritten;
+  //! the reader has reached the end of the input
+  bool readerdone;
+  //! protects the counters and the done flags
+  mutex lock;
+  //! signalled when an event was read
+  condition_variable filled;
+  //! signalled when an event was calibrated
+  condition_variable calibrated;
+  //! signalled when an event was written
+  condition_variable written;
+};
+void AddRawData(int detector, int geo, int ch, int val, WASABIRaw* raw);
+void ReadEvents(TArtEventStore* estore, pipeline* pipe, int nmax, int vl);
+void CalibrateEvents(Calibration* cal, pipeline* pipe);
 int main(int argc, char* argv[]){
   double time_start = get_time();  
   TStopwatch timer;
@@ -38,6 +106,7 @@ int main(int argc, char* argv[]){
   char* CutFile = NULL;
   int nmax = 0;
   int vl = 0;
+  int Threads = 0;
 
   CommandLineInterface* interface = new CommandLineInterface();
   interface->Add("-i", "input file", &InputFile);
@@ -45,6 +114,7 @@ int main(int argc, char* argv[]){
   interface->Add("-s", "settings file", &SetFile);
   interface->Add("-n", "nmax", &nmax);
   interface->Add("-v", "verbose", &vl);
+  interface->Add("-nt", "number of calibration threads, 0 unpacks everything in the main thread", &Threads);
   interface->CheckFlags(argc, argv);
   cout << "verbose " << vl << endl;
   
@@ -100,7 +170,69 @@ int main(int argc, char* argv[]){
     
   unsigned long long int last_timestamp = 0;
   int ctr =0;
-  while(estore->GetNextEvent() && !signal_received){
+  if(Threads>0){
+    ROOT::EnableThreadSafety();
+    pipeline* pipe = new pipeline;
+    pipe->jobs.resize(4*Threads);
+    for(unsigned int i=0;i<pipe->jobs.size();i++){
+      pipe->jobs[i].raw = new WASABIRaw;
+      pipe->jobs[i].wasabi = new WASABI;
+      pipe->jobs[i].done = false;
+    }
+    pipe->nread = 0;
+    pipe->nwork = 0;
+    pipe->nwritten = 0;
+    pipe->readerdone = false;
+
+    //each worker has its own calibration, the random numbers depend only on the entry number
+    vector<thread> workers;
+    workers.push_back(thread(CalibrateEvents, cal, pipe));
+    for(int i=1;i<Threads;i++)
+      workers.push_back(thread(CalibrateEvents, new Calibration(SetFile), pipe));
+    thread reader(ReadEvents, estore, pipe, nmax, vl);
+
+    //write the events in input order
+    while(true){
+      unpackjob* job;
+      {
+	unique_lock<mutex> lock(pipe->lock);
+	while(!pipe->readerdone || pipe->nwritten<pipe->nread){
+	  if(pipe->nwritten<pipe->nread && pipe->jobs[pipe->nwritten%pipe->jobs.size()].done)
+	    break;
+	  pipe->calibrated.wait(lock);
+	}
+	if(pipe->nwritten==pipe->nread)
+	  break;
+	job = &pipe->jobs[pipe->nwritten%pipe->jobs.size()];
+      }
+      eventnumber = job->eventnumber;
+      timestamp = job->timestamp;
+      trigger = job->trigger;
+      wasabiRAW = job->raw;
+      wasabi = job->wasabi;
+      if(vl>1)
+	wasabiRAW->Print();
+      tr->Fill();
+      {
+	lock_guard<mutex> lock(pipe->lock);
+	job->done = false;
+	pipe->nwritten++;
+      }
+      pipe->written.notify_one();
+
+      //output
+      if(ctr%10000 == 0){
+	double time_end = get_time();
+	cout << setw(5) << ctr << " events done " << setiosflags(ios::fixed) << setprecision(1) << (Float_t)ctr/(time_end - time_start) << " events/s \r" << flush;
+	tr->AutoSave();
+      }
+      ctr++;
+    }
+    reader.join();
+    for(unsigned int i=0;i<workers.size();i++)
+      workers[i].join();
+  }
+  while(Threads<1 && estore->GetNextEvent() && !signal_received){
     if(vl>0)
       cout << "next event ------------------------------------------------" << endl;
     //clearing
@@ -137,11 +269,7 @@ int main(int argc, char* argv[]){
 	  int ch  = d->GetCh();
 	  int val = d->GetVal();
 	  //cout << "geo = " << geo <<", ch = " << ch << ", val = " << val << endl;
-	  int adc = geo-5;
-	  if(geo==4)
-	    adc = 0;
-	  if(geo==4 || (geo>5 && geo < 16))
-	    wasabiRAW->AddADC(new WASABIRawADC(adc,ch,val));
+	  AddRawData(detector,geo,ch,val,wasabiRAW);
 	}
       }
       else if(detector == BETAT){
@@ -152,16 +280,14 @@ int main(int argc, char* argv[]){
 	  int ch  = d->GetCh();
 	  int val = d->GetVal();
 	  //cout << "geo = " << geo <<", ch = " << ch << ", val = " << val << endl;
-	  if(geo>24 && geo<28){
-	    wasabiRAW->AddTDC(new WASABIRawTDC(geo-25,ch,val));
-	  }
+	  AddRawData(detector,geo,ch,val,wasabiRAW);
 	}
       }
     }
     if(vl>1)
       wasabiRAW->Print();
 
-    wasabi = cal->BuildWASABI(wasabiRAW);
+    cal->BuildWASABI(wasabiRAW, wasabi, ctr);
     //wasabi->Print();
     
     //fill the tree
@@ -190,6 +316,120 @@ int main(int argc, char* argv[]){
 
   return 0;
 }
+/*!
+  Add one data word to the raw WASABI data
+  \param detector the detector ID of the segment
+  \param geo the geo address of the module
+  \param ch the channel
+  \param val the value
+  \param raw the raw data to be filled
+*/
+void AddRawData(int detector, int geo, int ch, int val, WASABIRaw* raw){
+  if(detector == BETAA){
+    int adc = geo-5;
+    if(geo==4)
+      adc = 0;
+    if(geo==4 || (geo>5 && geo < 16))
+      raw->AddADC(adc,ch,val);
+  }
+  else if(detector == BETAT){
+    if(geo>24 && geo<28)
+      raw->AddTDC(geo-25,ch,val);
+  }
+}
+/*!
+  Read the events from the event store and copy the WASABI data words into the pipeline, executed in a separate thread
+  \param estore the event store
+  \param pipe the pipeline
+  \param nmax the maximum number of events, 0 for all
+  \param vl the verbose level
+*/
+void ReadEvents(TArtEventStore* estore, pipeline* pipe, int nmax, int vl){
+  TArtStoreManager* sman = TArtStoreManager::Instance();
+  unsigned long long int last_timestamp = 0;
+  int ctr = 0;
+  while(estore->GetNextEvent() && !signal_received){
+    {
+      unique_lock<mutex> lock(pipe->lock);
+      while(pipe->nread - pipe->nwritten == pipe->jobs.size())
+	pipe->written.wait(lock);
+    }
+    //the slot is not visible to the workers until nread is increased
+    unpackjob* job = &pipe->jobs[pipe->nread%pipe->jobs.size()];
+    job->entry = pipe->nread;
+    TClonesArray* info_a = (TClonesArray*)sman->FindDataContainer("EventInfo");
+    TArtEventInfo* info = (TArtEventInfo*)info_a->At(0);
+    job->timestamp = info->GetTimeStamp();
+    job->eventnumber = info->GetEventNumber();
+    job->trigger = info->GetTriggerBit();
+    if(job->timestamp<last_timestamp){
+      cout << "timestamp was reset, this TS = " << job->timestamp << ", last one was " << last_timestamp << " difference " << job->timestamp-last_timestamp << endl;
+    }
+    if(vl>1)
+      cout << job->eventnumber << "\t" << job->timestamp << "\t" << job->timestamp-last_timestamp << endl;
+    last_timestamp = job->timestamp;
+
+    job->words.clear();
+    TArtRawEventObject* rawevent = (TArtRawEventObject*)sman->FindDataContainer("RawEvent");
+    for(int i=0;i<rawevent -> GetNumSeg();i++){
+      TArtRawSegmentObject* seg = rawevent -> GetSegment(i);
+      Int_t detector = seg -> GetDetector();
+      if(detector != BETAA && detector != BETAT)
+	continue;
+      for(int j=0; j<seg->GetNumData(); j++){
+	TArtRawDataObject* d = seg->GetData(j);
+	rawword word;
+	word.detector = detector;
+	word.geo = d->GetGeo();
+	word.ch = d->GetCh();
+	word.val = d->GetVal();
+	job->words.push_back(word);
+      }
+    }
+    {
+      lock_guard<mutex> lock(pipe->lock);
+      pipe->nread++;
+    }
+    pipe->filled.notify_one();
+    ctr++;
+    if(nmax>0 && ctr>nmax-1)
+      break;
+  }
+  {
+    lock_guard<mutex> lock(pipe->lock);
+    pipe->readerdone = true;
+  }
+  pipe->filled.notify_all();
+  pipe->calibrated.notify_all();
+}
+/*!
+  Decode and calibrate the events of the pipeline, executed in a separate thread for each worker
+  \param cal the calibration of this worker
+  \param pipe the pipeline
+*/
+void CalibrateEvents(Calibration* cal, pipeline* pipe){
+  while(true){
+    unpackjob* job;
+    {
+      unique_lock<mutex> lock(pipe->lock);
+      while(pipe->nwork==pipe->nread && !pipe->readerdone)
+	pipe->filled.wait(lock);
+      if(pipe->nwork==pipe->nread)
+	return;
+      job = &pipe->jobs[pipe->nwork%pipe->jobs.size()];
+      pipe->nwork++;
+    }
+    job->raw->Clear();
+    for(vector<rawword>::iterator word=job->words.begin(); word!=job->words.end(); word++)
+      AddRawData(word->detector, word->geo, word->ch, word->val, job->raw);
+    cal->BuildWASABI(job->raw, job->wasabi, job->entry);
+    {
+      lock_guard<mutex> lock(pipe->lock);
+      job->done = true;
+    }
+    pipe->calibrated.notify_one();
+  }
+}
 void signalhandler(int sig){
   if (sig == SIGINT){
     signal_received = true;
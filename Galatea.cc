@@ -1,6 +1,8 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <thread>
 #include <sys/time.h>
 #include <signal.h>
 #include "TMath.h"
@@ -9,6 +11,9 @@
 #include "TCutG.h"
 #include "TKey.h"
 #include "TStopwatch.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TFileMerger.h"
 #include "CommandLineInterface.hh"
 #include "BuildEvents.hh"
 #include "Globaldefs.h"
@@ -17,6 +22,7 @@ using namespace TMath;
 using namespace std;
 bool signal_received = false;
 void signalhandler(int sig);
+void BuildSlice(char* InputBigRIPS, char* InputWASABI, char* InputEURICA, string OutFile, eventrange range, long long int Window, int Mode, int Prefetch, int Verbose, int slice);
 double get_time();
 int main(int argc, char* argv[]){
   double time_start = get_time();  
@@ -29,6 +35,10 @@ int main(int argc, char* argv[]){
   int Verbose = 0;
   long long int Window = 10000;
   int Mode = 0;
+  int Prefetch = 256;
+  bool TwoPass = false;
+  int Threads = 1;
+  bool Segmented = false;
   char* InputBigRIPS = NULL;
   char* InputWASABI = NULL;
   char* InputEURICA = NULL;
@@ -42,9 +52,13 @@ int main(int argc, char* argv[]){
   interface->Add("-o", "output file", &OutFile);    
   //interface->Add("-c", "cutfile", &CutFile);
   interface->Add("-w", "event building window", &Window);  
-  // interface->Add("-m", "event building mode: 0 everything, 1 isomerdata", &Mode);  
+  interface->Add("-m", "event building mode: 0 everything, 1 isomerdata", &Mode);  
   interface->Add("-le", "last event to be read", &LastEvent);  
   interface->Add("-v", "verbose level", &Verbose);  
+  interface->Add("-pf", "number of entries to read ahead per input file, 0 reads in the main thread", &Prefetch);  
+  interface->Add("-tp", "two pass mode, pre-scan the timestamps and read only entries of written events", &TwoPass);  
+  interface->Add("-nt", "number of threads, the data is split into time slices merged in parallel", &Threads);  
+  interface->Add("-seg", "find the timestamp resets first and merge the segments between them separately", &Segmented);  
   interface->CheckFlags(argc, argv);
   //Complain about missing mandatory arguments
   TTree* trbigrips = NULL;
@@ -89,38 +103,129 @@ int main(int argc, char* argv[]){
     return 2;
   }
 
+  if(Threads>1 && LastEvent>-1){
+    cout << "the last event can not be set for parallel event building, using one thread" << endl;
+    Threads = 1;
+  }
+  if(Threads>1 && TwoPass){
+    cout << "two pass mode is not used for parallel event building" << endl;
+    TwoPass = false;
+  }
+  if(Segmented && (TwoPass || LastEvent>-1)){
+    cout << "timestamp segments can not be used together with the two pass mode or the last event" << endl;
+    Segmented = false;
+  }
+  if(Threads>1){
+    ROOT::EnableThreadSafety();
+    //find the time slices, the merged tree of this instance is not used
+    gROOT->cd();
+    BuildEvents* scan = new BuildEvents();
+    scan->SetVerbose(Verbose);
+    scan->SetWindow(Window);
+    scan->SetCoincMode(Mode);
+    scan->Init(trbigrips,trwasabi,treurica);
+    vector<eventrange> slices = scan->TimeSlices(Threads);
+    delete scan->GetTree();
+    delete scan;
+    //each thread opens the input files itself
+    if(inbigrips!=NULL)
+      inbigrips->Close();
+    if(inwasabi!=NULL)
+      inwasabi->Close();
+    if(ineurica!=NULL)
+      ineurica->Close();
+
+    string base(OutFile);
+    if(base.size()>5 && base.substr(base.size()-5)==".root")
+      base = base.substr(0,base.size()-5);
+    vector<string> slicefiles;
+    vector<thread> workers;
+    cout << "merging " << slices.size() << " time slices in parallel" << endl;
+    for(unsigned int i=0;i<slices.size();i++){
+      slicefiles.push_back(Form("%s_slice%d.root",base.c_str(),i));
+      workers.push_back(thread(BuildSlice, InputBigRIPS, InputWASABI, InputEURICA, slicefiles.back(), slices[i], Window, Mode, Prefetch, Verbose, i));
+    }
+    for(unsigned int i=0;i<workers.size();i++)
+      workers[i].join();
+
+    //combine the slices in time order
+    cout<<"output file: "<<OutFile<< endl;
+    TFileMerger* merger = new TFileMerger(kFALSE);
+    merger->OutputFile(OutFile,"RECREATE");
+    for(unsigned int i=0;i<slicefiles.size();i++)
+      merger->AddFile(slicefiles[i].c_str());
+    if(!merger->Merge())
+      cout << "merging the time slices failed, the slices are kept" << endl;
+    else{
+      for(unsigned int i=0;i<slicefiles.size();i++)
+	gSystem->Unlink(slicefiles[i].c_str());
+    }
+    delete merger;
+    double time_end = get_time();
+    cout << "Program Run time: " << time_end - time_start << " s." << endl;
+    timer.Stop();
+    cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+    return 0;
+  }
+
   cout<<"output file: "<<OutFile<< endl;
   TFile* ofile = new TFile(OutFile,"recreate");
   ofile->cd();
  
+  if(TwoPass && Prefetch>0){
+    cout << "two pass mode, entries are not read ahead" << endl;
+    Prefetch = 0;
+  }
+  if(Prefetch>0)
+    ROOT::EnableThreadSafety();
   BuildEvents* evts = new BuildEvents();
   evts->SetVerbose(Verbose);
   evts->SetWindow(Window);
   evts->SetCoincMode(Mode);  
+  evts->SetPrefetch(Prefetch);
   evts->Init(trbigrips,trwasabi,treurica);
   evts->SetLastEvent(LastEvent);
+  if(TwoPass)
+    evts->PreScan();
+  vector<eventrange> segments;
+  if(Segmented){
+    segments = evts->Segments();
+    if(segments.size()==0)
+      Segmented = false;
+  }
 
   double time_last = get_time();
-  evts->ReadEach();
   int ctr=0;
   int total = evts->GetNEvents();
-  while(evts->Merge()){
-    if(ctr%10000 == 0){
-      double time_end = get_time();
-      cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*ctr)/total<<" % done\t" << 
-    	(Float_t)ctr/(time_end - time_start) << " events/s (average) " <<
-    	10000./(time_end - time_last) << " events/s (current) " <<
-    	(total-ctr)*(time_end - time_start)/(Float_t)ctr << "s to go \r" << flush;
-      time_last = time_end;
+  unsigned int seg = 0;
+  do{
+    if(Segmented){
+      cout << endl << "merging segment " << seg << endl;
+      evts->SetRange(segments[seg]);
     }
-    if(signal_received){
-      break;
+    evts->ReadEach();
+    while(evts->Merge()){
+      if(ctr%10000 == 0){
+        double time_end = get_time();
+        cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*ctr)/total<<" % done\t" << 
+      	(Float_t)ctr/(time_end - time_start) << " events/s (average) " <<
+      	10000./(time_end - time_last) << " events/s (current) " <<
+      	(total-ctr)*(time_end - time_start)/(Float_t)ctr << "s to go \r" << flush;
+        time_last = time_end;
+      }
+      if(signal_received){
+        break;
+      }
+      ctr++;
     }
-    ctr++;
-  }
+    evts->CloseEvent();
+    seg++;
+  }while(Segmented && seg<segments.size() && !signal_received);
   
-  evts->CloseEvent();
+  evts->WriteStatistics();
   evts->GetTree()->Write("",TObject::kOverwrite);
+  //stop the reader threads before the input files are closed
+  delete evts;
   ofile->Close();
   if(inbigrips!=NULL)
     inbigrips->Close();
@@ -134,6 +239,59 @@ int main(int argc, char* argv[]){
   cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
   return 0;
 }
+/*!
+  Merge one time slice into its own output file, executed in a separate thread
+*/
+void BuildSlice(char* InputBigRIPS, char* InputWASABI, char* InputEURICA, string OutFile, eventrange range, long long int Window, int Mode, int Prefetch, int Verbose, int slice){
+  TTree* trbigrips = NULL;
+  TTree* treurica = NULL;
+  TTree* trwasabi = NULL;
+  TFile* inbigrips = NULL;
+  TFile* ineurica = NULL;
+  TFile* inwasabi = NULL;
+  if(InputBigRIPS != NULL){
+    inbigrips = new TFile(InputBigRIPS);
+    trbigrips = (TTree*) inbigrips->Get("tr");
+  }
+  if(InputEURICA != NULL){
+    ineurica = new TFile(InputEURICA);
+    treurica = (TTree*) ineurica->Get("tree");
+  }
+  if(InputWASABI != NULL){
+    inwasabi = new TFile(InputWASABI);
+    trwasabi = (TTree*) inwasabi->Get("tr");
+  }
+  TFile* ofile = new TFile(OutFile.c_str(),"recreate");
+  ofile->cd();
+
+  BuildEvents* evts = new BuildEvents();
+  evts->SetVerbose(Verbose);
+  evts->SetWindow(Window);
+  evts->SetCoincMode(Mode);
+  evts->SetPrefetch(Prefetch);
+  evts->Init(trbigrips,trwasabi,treurica);
+  evts->SetRange(range);
+
+  evts->ReadEach();
+  while(evts->Merge()){
+    if(signal_received){
+      break;
+    }
+  }
+  evts->CloseEvent();
+  cout << "slice " << slice << " finished, " << evts->GetTree()->GetEntries() << " events" << endl;
+  //the histograms are added up when the slices are combined, the summaries are kept for each slice
+  evts->WriteStatistics(Form("buildstatistics_slice%d",slice));
+  evts->GetTree()->Write("",TObject::kOverwrite);
+  delete evts;
+  ofile->Close();
+  if(inbigrips!=NULL)
+    inbigrips->Close();
+  if(inwasabi!=NULL)
+    inwasabi->Close();
+  if(ineurica!=NULL)
+    ineurica->Close();
+}
 void signalhandler(int sig){
   if (sig == SIGINT){
     signal_received = true;
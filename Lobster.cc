@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sys/time.h>
+#include <signal.h>
+#include "TMath.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TStopwatch.h"
+#include "CommandLineInterface.hh"
+#include "WASABI.hh"
+
+#include "Globaldefs.h"
+
+using namespace TMath;
+using namespace std;
+bool signal_received = false;
+void signalhandler(int sig);
+double get_time();
+int main(int argc, char* argv[]){
+  double time_start = get_time();
+  TStopwatch timer;
+  timer.Start();
+  signal(SIGINT,signalhandler);
+  cout << "\"Lobster Telephone\" (1936), Salvador Dali" << endl;
+  cout << "Converter between the WASABI objects and the columnar WASABI storage" << endl;
+  char* InputFile = NULL;
+  char* OutFile = NULL;
+  bool Reverse = false;
+  int LastEvent = -1;
+  int Verbose = 0;
+  //Read in the command line arguments
+  CommandLineInterface* interface = new CommandLineInterface();
+  interface->Add("-i", "input file", &InputFile);
+  interface->Add("-o", "output file", &OutFile);
+  interface->Add("-r", "reverse, convert the columns back to WASABI objects", &Reverse);
+  interface->Add("-le", "last event to be read", &LastEvent);
+  interface->Add("-v", "verbose level", &Verbose);
+  interface->CheckFlags(argc, argv);
+  //Complain about missing mandatory arguments
+  if(InputFile == NULL){
+    cout << "No input file given " << endl;
+    return 1;
+  }
+  if(OutFile == NULL){
+    cout << "No output ROOT file given " << endl;
+    return 2;
+  }
+  cout<<"input file: "<<InputFile<<endl;
+  TFile* infile = new TFile(InputFile);
+  TTree* tr = (TTree*)infile->Get("tr");
+  if(tr == NULL){
+    cout << "could not find tree tr in file " << infile->GetName() << endl;
+    return 3;
+  }
+  //the branch that is converted, all others are copied
+  const char* inbranch = Reverse ? "wasabicol" : "wasabi";
+  const char* outbranch = Reverse ? "wasabi" : "wasabicol";
+  if(tr->GetBranch(inbranch) == NULL){
+    cout << "could not find branch " << inbranch << " in tree tr" << endl;
+    return 3;
+  }
+  WASABI* wasabi = new WASABI;
+  WASABIColumns* columns = new WASABIColumns;
+
+  cout<<"output file: "<<OutFile<< endl;
+  TFile* ofile = new TFile(OutFile,"recreate");
+  tr->SetBranchStatus(inbranch,0);
+  tr->SetBranchStatus(Form("%s.*",inbranch),0);
+  TTree* otr = tr->CloneTree(0);
+  tr->SetBranchStatus(inbranch,1);
+  tr->SetBranchStatus(Form("%s.*",inbranch),1);
+  if(Reverse){
+    tr->SetBranchAddress(inbranch,&columns);
+    otr->Branch(outbranch,&wasabi,320000);
+  }
+  else{
+    tr->SetBranchAddress(inbranch,&wasabi);
+    //split, each column is stored in its own basket
+    otr->Branch(outbranch,&columns,320000,99);
+  }
+
+  Double_t nentries = tr->GetEntries();
+  if(LastEvent>0)
+    nentries = LastEvent;
+  cout << nentries << " entries in tree" << endl;
+  Int_t nbytes = 0;
+  Int_t status;
+  for(int i=0; i<nentries;i++){
+    if(signal_received){
+      break;
+    }
+    wasabi->Clear();
+    columns->Clear();
+    status = tr->GetEvent(i);
+    if(status == -1){
+      cerr<<"Error occured, couldn't read entry "<<i<<" from tree "<<tr->GetName()<<" in file "<<infile->GetName()<<endl;
+      return 5;
+    }
+    else if(status == 0){
+      cerr<<"Error occured, entry "<<i<<" in tree "<<tr->GetName()<<" in file "<<infile->GetName()<<" doesn't exist"<<endl;
+      return 6;
+    }
+    nbytes += status;
+
+    if(Reverse)
+      columns->Get(wasabi);
+    else
+      columns->Set(wasabi);
+    if(Verbose>1)
+      columns->Print();
+    otr->Fill();
+
+    if(i%10000 == 0){
+      double time_end = get_time();
+      cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*i)/nentries <<
+	" % done\t" << (Float_t)i/(time_end - time_start) << " events/s " <<
+	(nentries-i)*(time_end - time_start)/(Float_t)i << "s to go \r" << flush;
+    }
+  }
+  cout << endl;
+  cout << "converted " << otr->GetEntries() << " entries, " << inbranch << " " << tr->GetBranch(inbranch)->GetZipBytes()/(1024*1024) << " MB, " << outbranch << " " << otr->GetBranch(outbranch)->GetZipBytes()/(1024*1024) << " MB" << endl;
+  otr->Write("",TObject::kOverwrite);
+  ofile->Close();
+  infile->Close();
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  timer.Stop();
+  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+  return 0;
+}
+void signalhandler(int sig){
+  if (sig == SIGINT){
+    signal_received = true;
+  }
+}
+
+double get_time(){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    double d = t.tv_sec + (double) t.tv_usec/1000000;
+    return d;
+}
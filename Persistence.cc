@@ -1,6 +1,9 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include <sys/time.h>
 #include <signal.h>
 #include "TMath.h"
@@ -11,23 +14,30 @@
 #include "TCutG.h"
 #include "TKey.h"
 #include "TStopwatch.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TFileMerger.h"
 #include "CommandLineInterface.hh"
 #include "FocalPlane.hh"
 #include "DALI.hh"
 #include "Beam.hh"
 #include "PPAC.hh"
 #include "Reconstruction.hh"
+#include "HistogramRegistry.hh"
+#include "FillPlan.hh"
 #include "Globaldefs.h"
 
 int DALIIDS = 300;
 
 using namespace TMath;
 using namespace std;
-bool signal_received = false;
+atomic<bool> signal_received(false);
 void signalhandler(int sig);
 double get_time();
 double deg2rad = TMath::Pi()/180.;
 double rad2deg = 180./TMath::Pi();
+int Analyze(vector<char*> InputFiles, char* TreeName, Reconstruction* rec, HistogramRegistry* hreg, TFile* treefile, long long int first, long long int end, int Verbose, int minID, int br, int zd, int slice);
+long long int ClusterStart(TChain* tr, long long int entry);
 int main(int argc, char* argv[]){
   double time_start = get_time();  
   TStopwatch timer;
@@ -46,6 +56,8 @@ int main(int argc, char* argv[]){
   int minID = 79;
   int br = 2;
   int zd = 5;
+  int Threads = 1;
+  long long int SparseBins = 0;
   //Read in the command line arguments
   CommandLineInterface* interface = new CommandLineInterface();
   interface->Add("-i", "input files", &InputFiles);
@@ -59,6 +71,8 @@ int main(int argc, char* argv[]){
   interface->Add("-id", "minimum DALI ID for additional gamma-gamma spectra", &minID);
   interface->Add("-br", "cut on this BigRIPS PIC", &br);
   interface->Add("-zd", "cut on this ZeroDeg PIC", &zd);
+  interface->Add("-nt", "number of threads, the entries are split into ranges analyzed in parallel", &Threads);
+  interface->Add("-sp", "2D histograms with more bins than this are kept in sparse storage, default dense", &SparseBins);
 
   interface->CheckFlags(argc, argv);
   //Complain about missing mandatory arguments
@@ -90,6 +104,137 @@ int main(int argc, char* argv[]){
     }
     return 3;
   }
+  Double_t nentries = tr->GetEntries();
+  cout << nentries << " entries in tree" << endl;
+  if(nentries<1)
+    return 4;
+  if(LastEvent>0)
+    nentries = LastEvent;
+
+  //the histograms of each range are kept in memory and written explicitly
+  TH1::AddDirectory(kFALSE);
+
+  //ranges of entries, starting at cluster boundaries so that no basket is read by two threads
+  vector<long long int> bounds;
+  bounds.push_back(0);
+  for(int t=1;t<Threads;t++){
+    long long int start = ClusterStart(tr, (long long int)nentries*t/Threads);
+    if(start>bounds.back() && start<nentries)
+      bounds.push_back(start);
+  }
+  bounds.push_back(nentries);
+  int nranges = bounds.size()-1;
+
+  //the reconstruction fits beta(z) when it is constructed, this is done before the threads start
+  cout<<"settings file: " << SetFile <<endl;
+  vector<Reconstruction*> recs;
+  for(int r=0;r<nranges;r++){
+    Reconstruction *rec = new Reconstruction(SetFile);
+    if(Verbose>0){
+      rec->GetSettings()->SetVerboseLevel(Verbose);
+      if(r==0)
+	rec->GetSettings()->PrintSettings();
+    }
+    if(beta>0)
+      rec->SetBeta(beta);
+    recs.push_back(rec);
+  }
+
+  TFile* ofile;
+  HistogramRegistry* hreg;
+  int status = 0;
+  if(nranges<2){
+    cout << "creating outputfile " << OutFile << endl;
+    ofile = new TFile(OutFile,"recreate");
+    hreg = new HistogramRegistry();
+    hreg->SetSparseThreshold(SparseBins);
+    status = Analyze(InputFiles, TreeName, recs[0], hreg, writeTree>0 ? ofile : NULL, 0, nentries, Verbose, minID, br, zd, 0);
+    cout << endl;
+  }
+  else{
+    ROOT::EnableThreadSafety();
+    string base(OutFile);
+    if(base.size()>5 && base.substr(base.size()-5)==".root")
+      base = base.substr(0,base.size()-5);
+    vector<HistogramRegistry*> hregs;
+    vector<string> slicenames;
+    vector<TFile*> slicefiles;
+    vector<int> slicestatus(nranges,0);
+    vector<thread> workers;
+    cout << "analyzing " << nranges << " ranges of entries in parallel" << endl;
+    for(int r=0;r<nranges;r++){
+      hregs.push_back(new HistogramRegistry());
+      hregs.back()->SetSparseThreshold(SparseBins);
+      TFile* slicefile = NULL;
+      if(writeTree>0){
+	slicenames.push_back(Form("%s_slice%d.root",base.c_str(),r));
+	slicefile = new TFile(slicenames.back().c_str(),"recreate");
+      }
+      slicefiles.push_back(slicefile);
+    }
+    for(int r=0;r<nranges;r++){
+      long long int first = bounds[r];
+      long long int end = bounds[r+1];
+      workers.push_back(thread([&, r, first, end](){
+	    slicestatus[r] = Analyze(InputFiles, TreeName, recs[r], hregs[r], slicefiles[r], first, end, Verbose, minID, br, zd, r);
+	  }));
+    }
+    for(unsigned int r=0;r<workers.size();r++)
+      workers[r].join();
+    for(int r=0;r<nranges;r++){
+      if(slicestatus[r]!=0)
+	status = slicestatus[r];
+      if(slicefiles[r]!=NULL)
+	slicefiles[r]->Close();
+    }
+
+    //add the histograms of all ranges in range order, the result does not depend on the timing of the threads
+    hreg = hregs[0];
+    for(int r=1;r<nranges;r++)
+      hreg->Add(hregs[r]);
+
+    //the trees of the ranges are combined in entry order
+    cout << endl;
+    cout << "creating outputfile " << OutFile << endl;
+    if(writeTree>0){
+      TFileMerger* merger = new TFileMerger(kFALSE);
+      merger->OutputFile(OutFile,"RECREATE");
+      for(unsigned int r=0;r<slicenames.size();r++)
+	merger->AddFile(slicenames[r].c_str());
+      if(!merger->Merge())
+	cout << "combining the trees of the ranges failed, the slices are kept" << endl;
+      else{
+	for(unsigned int r=0;r<slicenames.size();r++)
+	  gSystem->Unlink(slicenames[r].c_str());
+      }
+      delete merger;
+      ofile = new TFile(OutFile,"update");
+    }
+    else
+      ofile = new TFile(OutFile,"recreate");
+  }
+  ofile->cd();
+  hreg->Write();
+  hreg->MemoryReport(Verbose>0);
+  ofile->Close();
+  if(status!=0)
+    return status;
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  timer.Stop();
+  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+  return 0;
+}
+/*!
+  Analyze a range of entries, executed in a separate thread for parallel analysis.
+  Each range has its own chain, reconstruction, and histograms. The reconstructed events are written into treefile, if given.
+*/
+int Analyze(vector<char*> InputFiles, char* TreeName, Reconstruction* rec, HistogramRegistry* hreg, TFile* treefile, long long int first, long long int end, int Verbose, int minID, int br, int zd, int slice){
+  double time_start = get_time();
+  TChain* tr = new TChain(TreeName);
+  for(unsigned int i=0; i<InputFiles.size(); i++){
+    tr->Add(InputFiles[i]);
+  }
   int trigbit = 0;
   tr->SetBranchAddress("trigbit",&trigbit);
   PPAC* ppac = new PPAC;
@@ -104,232 +249,261 @@ int main(int argc, char* argv[]){
   DALI* dali = new DALI;
   tr->SetBranchAddress("dali",&dali);
 
-  TTree* rtr = new TTree("rtr","Reconstructed events");
-  rtr->Branch("trigbit",&trigbit,"trigbit/I");
-  rtr->Branch("dali",&dali,320000);
-  rtr->Branch("beam",&beam,320000);
-
-  cout<<"settings file: " << SetFile <<endl;
-  Reconstruction *rec = new Reconstruction(SetFile);
-  if(Verbose>0){
-    rec->GetSettings()->SetVerboseLevel(Verbose);
-    rec->GetSettings()->PrintSettings();
+  TTree* rtr = NULL;
+  if(treefile!=NULL){
+    treefile->cd();
+    rtr = new TTree("rtr","Reconstructed events");
+    rtr->Branch("trigbit",&trigbit,"trigbit/I");
+    rtr->Branch("dali",&dali,320000);
+    rtr->Branch("beam",&beam,320000);
   }
-  if(beta>0)
-    rec->SetBeta(beta);
-  bool recalibrate = rec->DoReCalibration();
-
-  TList *hlist = new TList();
 
   //histograms
-  TH1F* trigger = new TH1F("trigger","trigger",10,0,10);hlist->Add(trigger);
-  TH2F* bigrips = new TH2F("bigrips","bigrips",1000,1.8,2.3,1000,20,40);hlist->Add(bigrips);
-  TH2F* zerodeg = new TH2F("zerodeg","zerodeg",1000,1.8,2.3,1000,20,40);hlist->Add(zerodeg);
-  TH2F* bigrips_tr[10];
-  TH2F* zerodeg_tr[10];
-  TH1F* f5X_tr[10];
+  LazyHistogram* trigger = hreg->H1("trigger","trigger",10,0,10);
+  LazyHistogram* bigrips = hreg->H2("bigrips","bigrips",1000,1.8,2.3,1000,20,40);
+  LazyHistogram* zerodeg = hreg->H2("zerodeg","zerodeg",1000,1.8,2.3,1000,20,40);
+  LazyHistogram* bigrips_tr[10];
+  LazyHistogram* zerodeg_tr[10];
+  LazyHistogram* f5X_tr[10];
   for(int i=0;i<10;i++){
-    bigrips_tr[i] = new TH2F(Form("bigrips_tr%d",i),Form("bigrips_tr%d",i),1000,1.8,2.3,1000,20,40);hlist->Add(bigrips_tr[i]);
-    zerodeg_tr[i] = new TH2F(Form("zerodeg_tr%d",i),Form("zerodeg_tr%d",i),1000,1.8,2.3,1000,20,40);hlist->Add(zerodeg_tr[i]);
-    f5X_tr[i] = new TH1F(Form("f5X_tr%d",i),Form("f5X_tr%d",i),3000,-150,150);hlist->Add(f5X_tr[i]);
+    bigrips_tr[i] = hreg->H2(Form("bigrips_tr%d",i),Form("bigrips_tr%d",i),1000,1.8,2.3,1000,20,40);
+    zerodeg_tr[i] = hreg->H2(Form("zerodeg_tr%d",i),Form("zerodeg_tr%d",i),1000,1.8,2.3,1000,20,40);
+    f5X_tr[i] = hreg->H1(Form("f5X_tr%d",i),Form("f5X_tr%d",i),3000,-150,150);
   }
 
-  TH1F* f8ppacX[6];
-  TH1F* f8ppacY[6];
-  TH2F* f8ppacXY[6];
+  LazyHistogram* f8ppacX[6];
+  LazyHistogram* f8ppacY[6];
+  LazyHistogram* f8ppacXY[6];
   for(int p=0;p<6;p++){
-    f8ppacX[p] = new TH1F(Form("f8ppacX_%d",p),Form("f8ppacX_%d",p),200,-100,100);hlist->Add(f8ppacX[p]);
-    f8ppacY[p] = new TH1F(Form("f8ppacY_%d",p),Form("f8ppacY_%d",p),200,-100,100);hlist->Add(f8ppacY[p]);
-    f8ppacXY[p] = new TH2F(Form("f8ppacXY_%d",p),Form("f8ppacXY_%d",p),200,-100,100,200,-100,100);hlist->Add(f8ppacXY[p]);
+    f8ppacX[p] = hreg->H1(Form("f8ppacX_%d",p),Form("f8ppacX_%d",p),200,-100,100);
+    f8ppacY[p] = hreg->H1(Form("f8ppacY_%d",p),Form("f8ppacY_%d",p),200,-100,100);
+    f8ppacXY[p] = hreg->H2(Form("f8ppacXY_%d",p),Form("f8ppacXY_%d",p),200,-100,100,200,-100,100);
   }
-  TH2F* compareX[2];
-  TH2F* compareY[2];
-  TH1F* compare1dX[2];
-  TH1F* compare1dY[2];
+  LazyHistogram* compareX[2];
+  LazyHistogram* compareY[2];
+  LazyHistogram* compare1dX[2];
+  LazyHistogram* compare1dY[2];
   for(int p=0;p<2;p++){
-    compareX[p] = new TH2F(Form("compareX_%d",p),Form("compareX_%d",p),200,-100,100,200,-100,100);hlist->Add(compareX[p]);
-    compareY[p] = new TH2F(Form("compareY_%d",p),Form("compareY_%d",p),200,-100,100,200,-100,100);hlist->Add(compareY[p]);
-    compare1dX[p] = new TH1F(Form("compare1dX_%d",p),Form("compare1dX_%d",p),1000,-100,100);hlist->Add(compare1dX[p]);
-    compare1dY[p] = new TH1F(Form("compare1dY_%d",p),Form("compare1dY_%d",p),1000,-100,100);hlist->Add(compare1dY[p]);
+    compareX[p] = hreg->H2(Form("compareX_%d",p),Form("compareX_%d",p),200,-100,100,200,-100,100);
+    compareY[p] = hreg->H2(Form("compareY_%d",p),Form("compareY_%d",p),200,-100,100,200,-100,100);
+    compare1dX[p] = hreg->H1(Form("compare1dX_%d",p),Form("compare1dX_%d",p),1000,-100,100);
+    compare1dY[p] = hreg->H1(Form("compare1dY_%d",p),Form("compare1dY_%d",p),1000,-100,100);
   }
-  TH2F* compareA = new TH2F("compareA","compareA",200,-100,100,200,-100,100);hlist->Add(compareA);
-  TH2F* compareB = new TH2F("compareB","compareB",200,-100,100,200,-100,100);hlist->Add(compareB);
-  TH2F* ppacZpos = new TH2F("ppacZpos","ppacZpos",40,0,40,3000,-1500,1500);hlist->Add(ppacZpos);
-  TH2F* incAB = new TH2F("incAB","incAB",300,-30,30,300,-30,30);hlist->Add(incAB);
-  TH2F* scaAB = new TH2F("scaAB","scaAB",300,-30,30,300,-30,30);hlist->Add(scaAB);
-  TH2F* targetXY = new TH2F("targetXY","targetXY",200,-100,100,200,-100,100);hlist->Add(targetXY);
-  TH2F* thetaphi = new TH2F("thetaphi","thetaphi",800,-4,4,1500,0,150);hlist->Add(thetaphi);
-  TH2F* thetaphideg = new TH2F("thetaphideg","thetaphideg",800,-180,180,1500,0,5);hlist->Add(thetaphideg);
-  TH2F* thetaphiin = new TH2F("thetaphiin","thetaphiin",800,-4,4,1500,0,150);hlist->Add(thetaphiin);
-  TH2F* thetaphiout = new TH2F("thetaphiout","thetaphiout",800,-4,4,1500,0,150);hlist->Add(thetaphiout);
-  TH2F* thetaphisca = new TH2F("thetaphisca","thetaphisca",800,-4,4,1500,0,150);hlist->Add(thetaphisca);
-  TH2F* phiinout = new TH2F("phiinout","phiinout",800,-4,4,800,-4,4);hlist->Add(phiinout);
-  TH2F* thetaphi_tr[10];
-  TH2F* thetaphideg_tr[10];
+  LazyHistogram* compareA = hreg->H2("compareA","compareA",200,-100,100,200,-100,100);
+  LazyHistogram* compareB = hreg->H2("compareB","compareB",200,-100,100,200,-100,100);
+  LazyHistogram* ppacZpos = hreg->H2("ppacZpos","ppacZpos",40,0,40,3000,-1500,1500);
+  LazyHistogram* incAB = hreg->H2("incAB","incAB",300,-30,30,300,-30,30);
+  LazyHistogram* scaAB = hreg->H2("scaAB","scaAB",300,-30,30,300,-30,30);
+  LazyHistogram* targetXY = hreg->H2("targetXY","targetXY",200,-100,100,200,-100,100);
+  LazyHistogram* thetaphi = hreg->H2("thetaphi","thetaphi",800,-4,4,1500,0,150);
+  LazyHistogram* thetaphideg = hreg->H2("thetaphideg","thetaphideg",800,-180,180,1500,0,5);
+  LazyHistogram* thetaphiin = hreg->H2("thetaphiin","thetaphiin",800,-4,4,1500,0,150);
+  LazyHistogram* thetaphiout = hreg->H2("thetaphiout","thetaphiout",800,-4,4,1500,0,150);
+  LazyHistogram* thetaphisca = hreg->H2("thetaphisca","thetaphisca",800,-4,4,1500,0,150);
+  LazyHistogram* phiinout = hreg->H2("phiinout","phiinout",800,-4,4,800,-4,4);
+  LazyHistogram* thetaphi_tr[10];
+  LazyHistogram* thetaphideg_tr[10];
   for(int i=0;i<10;i++){
-    thetaphi_tr[i] = new TH2F(Form("thetaphi_tr%d",i),Form("thetaphi_tr%d",i),800,-4,4,1500,0,150);hlist->Add(thetaphi_tr[i]);
-    thetaphideg_tr[i] = new TH2F(Form("thetaphideg_tr%d",i),Form("thetaphideg_tr%d",i),800,-180,180,1500,0,5);hlist->Add(thetaphideg_tr[i]);
+    thetaphi_tr[i] = hreg->H2(Form("thetaphi_tr%d",i),Form("thetaphi_tr%d",i),800,-4,4,1500,0,150);
+    thetaphideg_tr[i] = hreg->H2(Form("thetaphideg_tr%d",i),Form("thetaphideg_tr%d",i),800,-180,180,1500,0,5);
   }
-  TH1F* bbeta[3];
+  LazyHistogram* bbeta[3];
   for(unsigned short b=0;b<3;b++){
-    bbeta[b] = new TH1F(Form("bbeta_%d",b),Form("bbeta_%d",b),10000,0,1);hlist->Add(bbeta[b]);
+    bbeta[b] = hreg->H1(Form("bbeta_%d",b),Form("bbeta_%d",b),10000,0,1);
   }
-  TH1F* delta[4];
+  LazyHistogram* delta[4];
   for(unsigned short b=0;b<4;b++){
-    delta[b] = new TH1F(Form("delta_%d",b),Form("delta_%d",b),1000,-10,10);hlist->Add(delta[b]);
+    delta[b] = hreg->H1(Form("delta_%d",b),Form("delta_%d",b),1000,-10,10);
   }
-  TH1F* deltadiff[2];
+  LazyHistogram* deltadiff[2];
   for(unsigned short b=0;b<2;b++){
-    deltadiff[b] = new TH1F(Form("deltadiff_%d",b),Form("deltadiff_%d",b),1000,-10,10);hlist->Add(deltadiff[b]);
+    deltadiff[b] = hreg->H1(Form("deltadiff_%d",b),Form("deltadiff_%d",b),1000,-10,10);
   }
   //background inspection
-  TH2F* PL3PPAC3   = new TH2F("PL3PPAC3","PL3PPAC3",    1000,-5,5,1000,-150,150);hlist->Add(PL3PPAC3);
-  TH2F* PL7PPAC7   = new TH2F("PL7PPAC7","PL7PPAC7",    1000,-5,5,1000,-150,150);hlist->Add(PL7PPAC7);
-  TH2F* PL9PPAC9   = new TH2F("PL9PPAC9","PL9PPAC9",    1000,-5,5,1000,-150,150);hlist->Add(PL9PPAC9);
-  TH2F* PL11PPAC11 = new TH2F("PL11PPAC11","PL11PPAC11",1000,-5,5,1000,-150,150);hlist->Add(PL11PPAC11);
-  TH2F* PL3PL3     = new TH2F("PL3PL3","PL3PL3",        1000,-5,5,1000,-5,5);hlist->Add(PL3PL3);
-  TH2F* PL7PL7     = new TH2F("PL7PL7","PL7PL7",        1000,-5,5,1000,-5,5);hlist->Add(PL7PL7);
-  TH2F* PL9PL9     = new TH2F("PL9PL9","PL9PL9",        1000,-5,5,1000,-5,5);hlist->Add(PL9PL9);
-  TH2F* PL11PL11   = new TH2F("PL11PL11","PL11PL11",    1000,-5,5,1000,-5,5);hlist->Add(PL11PL11);
+  LazyHistogram* PL3PPAC3   = hreg->H2("PL3PPAC3","PL3PPAC3",    1000,-5,5,1000,-150,150);
+  LazyHistogram* PL7PPAC7   = hreg->H2("PL7PPAC7","PL7PPAC7",    1000,-5,5,1000,-150,150);
+  LazyHistogram* PL9PPAC9   = hreg->H2("PL9PPAC9","PL9PPAC9",    1000,-5,5,1000,-150,150);
+  LazyHistogram* PL11PPAC11 = hreg->H2("PL11PPAC11","PL11PPAC11",1000,-5,5,1000,-150,150);
+  LazyHistogram* PL3PL3     = hreg->H2("PL3PL3","PL3PL3",        1000,-5,5,1000,-5,5);
+  LazyHistogram* PL7PL7     = hreg->H2("PL7PL7","PL7PL7",        1000,-5,5,1000,-5,5);
+  LazyHistogram* PL9PL9     = hreg->H2("PL9PL9","PL9PL9",        1000,-5,5,1000,-5,5);
+  LazyHistogram* PL11PL11   = hreg->H2("PL11PL11","PL11PL11",    1000,-5,5,1000,-5,5);
   
   
-  TH1F* tdiff = new TH1F("tdiff","tdiff",2000,-1000,1000);hlist->Add(tdiff);
-  TH1F* rdiff = new TH1F("rdiff","rdiff",2000,0,10);hlist->Add(rdiff);
-  TH1F* adiff = new TH1F("adiff","adiff",2000,0,4);hlist->Add(adiff);
-  TH2F* radiff = new TH2F("radiff","radiff",200,0,4,200,0,10);hlist->Add(radiff);
-
-  // TH1F* tdiff_coinc = new TH1F("tdiff_coinc","tdiff_coinc",2000,-1000,1000);hlist->Add(tdiff_coinc);
-  // TH1F* rdiff_coinc = new TH1F("rdiff_coinc","rdiff_coinc",2000,0,10);hlist->Add(rdiff_coinc);
-  // TH1F* adiff_coinc = new TH1F("adiff_coinc","adiff_coinc",2000,0,4);hlist->Add(adiff_coinc);
-  // TH2F* radiff_coinc = new TH2F("radiff_coinc","radiff_coinc",200,0,4,200,0,10);hlist->Add(radiff_coinc);
+  // LazyHistogram* tdiff_coinc = hreg->H1("tdiff_coinc","tdiff_coinc",2000,-1000,1000);
+  // LazyHistogram* rdiff_coinc = hreg->H1("rdiff_coinc","rdiff_coinc",2000,0,10);
+  // LazyHistogram* adiff_coinc = hreg->H1("adiff_coinc","adiff_coinc",2000,0,4);
+  // LazyHistogram* radiff_coinc = hreg->H2("radiff_coinc","radiff_coinc",200,0,4,200,0,10);
 
   int bins = 8000;
   
-  TH2F* triggertgam = new TH2F("triggertgam","triggertgam",1000,-500,500,10,0,10);hlist->Add(triggertgam);
-  TH2F* ID_theta  = new TH2F("ID_theta","ID_theta",250,0,250,180,0,180);hlist->Add(ID_theta);
-  TH1F* mult = new TH1F("mult","mult",50,0,50);hlist->Add(mult);
-  TH2F* multtrig = new TH2F("multtrig","multtrig",20,0,20,50,0,50);hlist->Add(multtrig);
-  TH1F* egam = new TH1F("egam","egam",bins,0,bins);hlist->Add(egam);
-  TH1F* egamdc = new TH1F("egamdc","egamdc",bins,0,bins);hlist->Add(egamdc);
-  TH1F* egam_IDgate = new TH1F("egam_IDgate","egam_IDgate",bins,0,bins);hlist->Add(egam_IDgate);
-  TH1F* egamdc_IDgate = new TH1F("egamdc_IDgate","egamdc_IDgate",bins,0,bins);hlist->Add(egamdc_IDgate);
-  TH2F* egamtgam = new TH2F("egamtgam","egamtgam",1000,-500,500,1000,0,bins);hlist->Add(egamtgam);
-  TH2F* egamdctgam = new TH2F("egamdctgam","egamdctgam",1000,-500,500,1000,0,bins);hlist->Add(egamdctgam);
-  TH2F* egammult = new TH2F("egammult","egammult",20,0,20,bins,0,bins);hlist->Add(egammult);
-  TH2F* egamdcmult = new TH2F("egamdcmult","egamdcmult",20,0,20,bins,0,bins);hlist->Add(egamdcmult);
-  TH2F* egammult_IDgate = new TH2F("egammult_IDgate","egammult_IDgate",20,0,20,bins,0,bins);hlist->Add(egammult_IDgate);
-  TH2F* egamdcmult_IDgate = new TH2F("egamdcmult_IDgate","egamdcmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamdcmult_IDgate);
-  TH2F* egamtrig = new TH2F("egamtrig","egamtrig",10,0,10,bins,0,bins);hlist->Add(egamtrig);
-  TH2F* egamID_mult[10];
-  TH2F* egamdcID_mult[10];
-  TH2F* egamdctrig_mult[10];
-  TH2F* egamdctrigmult_theta[10][10];
-  TH2F* egamdctheta_mult[10];
-  TH2F* egamdcphi_mult[10];
-  TH2F* egamegam_mult[10];
-  TH2F* egamegamdc_mult[10];
-  TH2F* egamegam_IDgate_mult[10];
-  TH2F* egamegamdc_IDgate_mult[10];
-  TH1F* multAB = new TH1F("multAB","multAB",50,0,50);hlist->Add(multAB);
-  TH1F* egamAB = new TH1F("egamAB","egamAB",bins,0,bins);hlist->Add(egamAB);
-  TH1F* egamABdc = new TH1F("egamABdc","egamABdc",bins,0,bins);hlist->Add(egamABdc);
-  TH2F* egamABmult = new TH2F("egamABmult","egamABmult",20,0,20,bins,0,bins);hlist->Add(egamABmult);
-  TH2F* egamABmultAB = new TH2F("egamABmultAB","egamABmultAB",20,0,20,bins,0,bins);hlist->Add(egamABmultAB);
-  TH2F* egamABdcmult = new TH2F("egamABdcmult","egamABdcmult",20,0,20,bins,0,bins);hlist->Add(egamABdcmult);
-  TH2F* egamABdcmultAB = new TH2F("egamABdcmultAB","egamABdcmultAB",20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB);
-  TH1F* egamAB_IDgate = new TH1F("egamAB_IDgate","egamAB_IDgate",bins,0,bins);hlist->Add(egamAB_IDgate);
-  TH1F* egamABdc_IDgate = new TH1F("egamABdc_IDgate","egamABdc_IDgate",bins,0,bins);hlist->Add(egamABdc_IDgate);
-  TH2F* egamABmult_IDgate = new TH2F("egamABmult_IDgate","egamABmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABmult_IDgate);
-  TH2F* egamABmultAB_IDgate = new TH2F("egamABmultAB_IDgate","egamABmultAB_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABmultAB_IDgate);
-  TH2F* egamABdcmult_IDgate = new TH2F("egamABdcmult_IDgate","egamABdcmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABdcmult_IDgate);
-  TH2F* egamABdcmultAB_IDgate = new TH2F("egamABdcmultAB_IDgate","egamABdcmultAB_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB_IDgate);
-  TH2F* egamABtrig = new TH2F("egamABtrig","egamABtrig",10,0,10,bins,0,bins);hlist->Add(egamABtrig);
-  TH2F* egamABID_mult[10];
-  TH2F* egamABID_multAB[10];
-  TH2F* egamABdcID_mult[10];
-  TH2F* egamABdcID_multAB[10];
-  TH2F* egamABdctrig_mult[10];
-  TH2F* egamABdctrig_multAB[10];
-  TH2F* egamABdctrigmult_theta[10][10];
-  TH2F* egamABdctrigmultAB_theta[10][10];
- 
-  TH2F* egamegamAB_mult[10];
-  TH2F* egamegamABdc_mult[10];
-  TH2F* egamegamAB_multAB[10];
-  TH2F* egamegamABdc_multAB[10];
-  TH2F* egamegamAB_IDgate_mult[10];
-  TH2F* egamegamABdc_IDgate_mult[10];
-  TH2F* egamegamAB_IDgate_multAB[10];
-  TH2F* egamegamABdc_IDgate_multAB[10];
-
-  egamID_mult[0] = new TH2F("egamID","egamID",DALIIDS,0,DALIIDS,bins,0,bins);hlist->Add(egamID_mult[0]);
-  egamdcID_mult[0] = new TH2F("egamdcID","egamdcID",DALIIDS,0,DALIIDS,bins,0,bins);hlist->Add(egamdcID_mult[0]);
-  egamdctrig_mult[0] = new TH2F("egamdctrig","egamdctrig",10,0,10,bins,0,bins);hlist->Add(egamdctrig_mult[0]);
-  egamdctheta_mult[0] = new TH2F("egamdctheta","egamdctheta",200,0,4,400,0,bins);hlist->Add(egamdctheta_mult[0]);
-  egamdcphi_mult[0] = new TH2F("egamdcphi","egamdcphi",200,-4,4,400,0,bins);hlist->Add(egamdcphi_mult[0]);
-  egamABID_mult[0] = new TH2F("egamABID","egamABID",DALIIDS,0,DALIIDS,bins,0,bins);hlist->Add(egamABID_mult[0]);
-  egamABdcID_mult[0] = new TH2F("egamABdcID","egamABdcID",DALIIDS,0,DALIIDS,bins,0,bins);hlist->Add(egamABdcID_mult[0]);
-  egamABdctrig_mult[0] = new TH2F("egamABdctrig","egamABdctrig",10,0,10,bins,0,bins);hlist->Add(egamABdctrig_mult[0]);
+  LazyHistogram* mult = hreg->H1("mult","mult",50,0,50);
+  LazyHistogram* multtrig = hreg->H2("multtrig","multtrig",20,0,20,50,0,50);
+  LazyHistogram* multAB = hreg->H1("multAB","multAB",50,0,50);
+
+  //DALI hits, the spectra are also split by multiplicity and trigger, and gated on the ID
+  FillPlan* hits = new FillPlan(hreg);
+  int en = hits->Variable("en");
+  int dcen = hits->Variable("dcen");
+  int id = hits->Variable("id");
+  int toffset = hits->Variable("toffset");
+  int theta = hits->Variable("theta");
+  int thetadeg = hits->Variable("thetadeg");
+  int phi = hits->Variable("phi");
+  int hmult = hits->Variable("mult");
+  int htrig = hits->Variable("trig");
+  int hbeamtheta = hits->Variable("beamtheta");
+  int f;
+  hits->H2("ID_theta",id,250,0,250,thetadeg,180,0,180);
+  hits->H1("egam",en,bins,0,bins);
+  hits->H1("egamdc",dcen,bins,0,bins);
+  hits->H2("triggertgam",toffset,1000,-500,500,htrig,10,0,10);
+  hits->H2("egamtgam",toffset,1000,-500,500,en,1000,0,bins);
+  hits->H2("egamdctgam",toffset,1000,-500,500,dcen,1000,0,bins);
+  hits->H2("egamtrig",htrig,10,0,10,en,bins,0,bins);
+  hits->H2("egammult",hmult,20,0,20,en,bins,0,bins);
+  hits->H2("egamdcmult",hmult,20,0,20,dcen,bins,0,bins);
   for(int t=0;t<10;t++){
-    egamdctrigmult_theta[t][0] = new TH2F(Form("egamdctrig%d_theta",t),Form("egamdctrig%d_theta",t),100,0,5,bins,0,bins);hlist->Add(egamdctrigmult_theta[t][0]);
-    egamABdctrigmult_theta[t][0] = new TH2F(Form("egamABdctrig%d_theta",t),Form("egamABdctrig%d_theta",t),100,0,5,bins,0,bins);hlist->Add(egamABdctrigmult_theta[t][0]);
+    f = hits->H2(Form("egamdcmult_trig%d",t),hmult,20,0,20,dcen,bins,0,bins);
+    hits->Gate(f,htrig,t,t+1);
+    f = hits->H2(Form("egamdcmult_IDgate_trig%d",t),hmult,20,0,20,dcen,bins,0,bins);
+    hits->Gate(f,htrig,t,t+1);
+    hits->Gate(f,id,minID);
   }
-  
-  egamegam_mult[0] = new TH2F("egamegam","egamegam",200,0,4000,200,0,4000);hlist->Add(egamegam_mult[0]);
-  egamegamdc_mult[0] = new TH2F("egamegamdc","egamegamdc",200,0,4000,200,0,4000);hlist->Add(egamegamdc_mult[0]);
-  egamegamAB_mult[0] = new TH2F("egamegamAB","egamegamAB",200,0,4000,200,0,4000);hlist->Add(egamegamAB_mult[0]);
-  egamegamABdc_mult[0] = new TH2F("egamegamABdc","egamegamABdc",200,0,4000,200,0,4000);hlist->Add(egamegamABdc_mult[0]);
-  egamegam_IDgate_mult[0] = new TH2F("egamegam_IDgate","egamegam_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegam_IDgate_mult[0]);
-  egamegamdc_IDgate_mult[0] = new TH2F("egamegamdc_IDgate","egamegamdc_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamdc_IDgate_mult[0]);
-  egamegamAB_IDgate_mult[0] = new TH2F("egamegamAB_IDgate","egamegamAB_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_mult[0]);
-  egamegamABdc_IDgate_mult[0] = new TH2F("egamegamABdc_IDgate","egamegamABdc_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_mult[0]);
-  for(int m=1;m<10;m++){
-    egamID_mult[m] = new TH2F(Form("egamIDmult%d",m),Form("egamIDmult%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamID_mult[m]);
-    egamdcID_mult[m] = new TH2F(Form("egamdcIDmult%d",m),Form("egamdcIDmult%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamdcID_mult[m]);
-    egamdctrig_mult[m] = new TH2F(Form("egamdctrigmult%d",m),Form("egamdctrigmult%d",m),10,0,10,400,0,4000);hlist->Add(egamdctrig_mult[m]);
-    egamdctheta_mult[m] = new TH2F(Form("egamdcthetamult%d",m),Form("egamdcthetamult%d",m),200,0,4,400,0,4000);hlist->Add(egamdctheta_mult[m]);
-    egamdcphi_mult[m] = new TH2F(Form("egamdcphimult%d",m),Form("egamdcphimult%d",m),200,-4,4,400,0,4000);hlist->Add(egamdcphi_mult[m]);
-    egamABID_mult[m] = new TH2F(Form("egamABIDmult%d",m),Form("egamABIDmult%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamABID_mult[m]);
-    egamABID_multAB[m] = new TH2F(Form("egamABIDmultAB%d",m),Form("egamABIDmultAB%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamABID_multAB[m]);
-    egamABdcID_mult[m] = new TH2F(Form("egamABdcIDmult%d",m),Form("egamABdcIDmult%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamABdcID_mult[m]);
-    egamABdcID_multAB[m] = new TH2F(Form("egamABdcIDmultAB%d",m),Form("egamABdcIDmultAB%d",m),DALIIDS,0,DALIIDS,400,0,4000);hlist->Add(egamABdcID_multAB[m]);
-    egamABdctrig_mult[m] = new TH2F(Form("egamABdctrigmult%d",m),Form("egamABdctrigmult%d",m),10,0,10,400,0,4000);hlist->Add(egamABdctrig_mult[m]);
-    egamABdctrig_multAB[m] = new TH2F(Form("egamABdctrigmultAB%d",m),Form("egamABdctrigmultAB%d",m),10,0,10,400,0,4000);hlist->Add(egamABdctrig_multAB[m]);
-    for(int t=0;t<10;t++){
-      egamdctrigmult_theta[t][m] = new TH2F(Form("egamdctrig%dmult%d_theta",t,m),Form("egamdctrig%dmult%d_theta",t,m),100,0,5,4000,0,4000);hlist->Add(egamdctrigmult_theta[t][m]);
-      egamABdctrigmult_theta[t][m] = new TH2F(Form("egamABdctrig%dmult%d_theta",t,m),Form("egamABdctrig%dmult%d_theta",t,m),100,0,5,4000,0,4000);hlist->Add(egamABdctrigmult_theta[t][m]);
-      egamABdctrigmultAB_theta[t][m] = new TH2F(Form("egamABdctrig%dmultAB%d_theta",t,m),Form("egamABdctrig%dmultAB%d_theta",t,m),100,0,5,4000,0,4000);hlist->Add(egamABdctrigmultAB_theta[t][m]);
-    }
-
-    
-    egamegam_mult[m] = new TH2F(Form("egamegammult%d",m),Form("egamegammult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegam_mult[m]);
-    egamegamdc_mult[m] = new TH2F(Form("egamegamdcmult%d",m),Form("egamegamdcmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamdc_mult[m]);
-    egamegamAB_mult[m] = new TH2F(Form("egamegamABmult%d",m),Form("egamegamABmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_mult[m]);
-    egamegamABdc_mult[m] = new TH2F(Form("egamegamABdcmult%d",m),Form("egamegamABdcmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_mult[m]);
-    egamegamAB_multAB[m] = new TH2F(Form("egamegamABmultAB%d",m),Form("egamegamABmultAB%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_multAB[m]);
-    egamegamABdc_multAB[m] = new TH2F(Form("egamegamABdcmultAB%d",m),Form("egamegamABdcmultAB%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_multAB[m]);
-
-    egamegam_IDgate_mult[m] = new TH2F(Form("egamegammult%d_IDgate",m),Form("egamegammult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegam_IDgate_mult[m]);
-    egamegamdc_IDgate_mult[m] = new TH2F(Form("egamegamdcmult%d_IDgate",m),Form("egamegamdcmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamdc_IDgate_mult[m]);
-    egamegamAB_IDgate_mult[m] = new TH2F(Form("egamegamABmult%d_IDgate",m),Form("egamegamABmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_mult[m]);
-    egamegamABdc_IDgate_mult[m] = new TH2F(Form("egamegamABdcmult%d_IDgate",m),Form("egamegamABdcmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_mult[m]);
-    egamegamAB_IDgate_multAB[m] = new TH2F(Form("egamegamABmultAB%d_IDgate",m),Form("egamegamABmultAB%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_multAB[m]);
-    egamegamABdc_IDgate_multAB[m] = new TH2F(Form("egamegamABdcmultAB%d_IDgate",m),Form("egamegamABdcmultAB%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_multAB[m]);
+  f = hits->H2("egamID",id,DALIIDS,0,DALIIDS,en,bins,0,bins);
+  hits->Split(f,hmult,10,"egamIDmult%d",DALIIDS,0,DALIIDS,400,0,4000);
+  f = hits->H2("egamdcID",id,DALIIDS,0,DALIIDS,dcen,bins,0,bins);
+  hits->Split(f,hmult,10,"egamdcIDmult%d",DALIIDS,0,DALIIDS,400,0,4000);
+  f = hits->H2("egamdctrig",htrig,10,0,10,dcen,bins,0,bins);
+  hits->Split(f,hmult,10,"egamdctrigmult%d",10,0,10,400,0,4000);
+  for(int t=0;t<10;t++){
+    f = hits->H2(Form("egamdctrig%d_theta",t),hbeamtheta,100,0,5,dcen,bins,0,bins);
+    hits->Gate(f,htrig,t,t+1);
+    hits->Split(f,hmult,10,Form("egamdctrig%dmult%%d_theta",t),100,0,5,4000,0,4000);
   }
-
-  TH2F* egamdcmult_trig[10];
-  TH2F* egamABdcmult_trig[10];
-  TH2F* egamABdcmultAB_trig[10];
-  TH2F* egamdcmult_IDgate_trig[10];
-  TH2F* egamABdcmult_IDgate_trig[10];
-  TH2F* egamABdcmultAB_IDgate_trig[10];
-  for(int i=0;i<10;i++){
-    egamdcmult_trig[i] = new TH2F(Form("egamdcmult_trig%d",i),Form("egamdcmult_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamdcmult_trig[i]);
-    egamABdcmult_trig[i] = new TH2F(Form("egamABdcmult_trig%d",i),Form("egamABdcmult_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamABdcmult_trig[i]);
-    egamABdcmultAB_trig[i] = new TH2F(Form("egamABdcmultAB_trig%d",i),Form("egamABdcmultAB_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB_trig[i]);
-    egamdcmult_IDgate_trig[i] = new TH2F(Form("egamdcmult_IDgate_trig%d",i),Form("egamdcmult_IDgate_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamdcmult_IDgate_trig[i]);
-    egamABdcmult_IDgate_trig[i] = new TH2F(Form("egamABdcmult_IDgate_trig%d",i),Form("egamABdcmult_IDgate_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamABdcmult_IDgate_trig[i]);
-    egamABdcmultAB_IDgate_trig[i] = new TH2F(Form("egamABdcmultAB_IDgate_trig%d",i),Form("egamABdcmultAB_IDgate_trig%d",i),20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB_IDgate_trig[i]);
+  f = hits->H2("egamdctheta",theta,200,0,4,dcen,400,0,bins);
+  hits->Split(f,hmult,10,"egamdcthetamult%d",200,0,4,400,0,4000);
+  f = hits->H2("egamdcphi",phi,200,-4,4,dcen,400,0,bins);
+  hits->Split(f,hmult,10,"egamdcphimult%d",200,-4,4,400,0,4000);
+  f = hits->H1("egam_IDgate",en,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H1("egamdc_IDgate",dcen,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H2("egammult_IDgate",hmult,20,0,20,en,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H2("egamdcmult_IDgate",hmult,20,0,20,dcen,bins,0,bins);
+  hits->Gate(f,id,minID);
+
+  //DALI addback hits, split by the multiplicity before and after addback
+  FillPlan* hitsAB = new FillPlan(hreg);
+  int enAB = hitsAB->Variable("en");
+  int dcenAB = hitsAB->Variable("dcen");
+  int idAB = hitsAB->Variable("id");
+  int amult = hitsAB->Variable("mult");
+  int amultAB = hitsAB->Variable("multAB");
+  int atrig = hitsAB->Variable("trig");
+  int abeamtheta = hitsAB->Variable("beamtheta");
+  hitsAB->H1("egamAB",enAB,bins,0,bins);
+  hitsAB->H1("egamABdc",dcenAB,bins,0,bins);
+  hitsAB->H2("egamABtrig",atrig,10,0,10,enAB,bins,0,bins);
+  hitsAB->H2("egamABmult",amult,20,0,20,enAB,bins,0,bins);
+  hitsAB->H2("egamABmultAB",amultAB,20,0,20,enAB,bins,0,bins);
+  hitsAB->H2("egamABdcmult",amult,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->H2("egamABdcmultAB",amultAB,20,0,20,dcenAB,bins,0,bins);
+  for(int t=0;t<10;t++){
+    f = hitsAB->H2(Form("egamABdcmult_trig%d",t),amult,20,0,20,dcenAB,bins,0,bins);
+    hitsAB->Gate(f,atrig,t,t+1);
+    f = hitsAB->H2(Form("egamABdcmultAB_trig%d",t),amultAB,20,0,20,dcenAB,bins,0,bins);
+    hitsAB->Gate(f,atrig,t,t+1);
+    f = hitsAB->H2(Form("egamABdcmult_IDgate_trig%d",t),amult,20,0,20,dcenAB,bins,0,bins);
+    hitsAB->Gate(f,atrig,t,t+1);
+    hitsAB->Gate(f,idAB,minID);
+    f = hitsAB->H2(Form("egamABdcmultAB_IDgate_trig%d",t),amultAB,20,0,20,dcenAB,bins,0,bins);
+    hitsAB->Gate(f,atrig,t,t+1);
+    hitsAB->Gate(f,idAB,minID);
+  }
+  f = hitsAB->H2("egamABID",idAB,DALIIDS,0,DALIIDS,enAB,bins,0,bins);
+  hitsAB->Split(f,amult,10,"egamABIDmult%d",DALIIDS,0,DALIIDS,400,0,4000);
+  hitsAB->Split(f,amultAB,10,"egamABIDmultAB%d",DALIIDS,0,DALIIDS,400,0,4000);
+  f = hitsAB->H2("egamABdcID",idAB,DALIIDS,0,DALIIDS,dcenAB,bins,0,bins);
+  hitsAB->Split(f,amult,10,"egamABdcIDmult%d",DALIIDS,0,DALIIDS,400,0,4000);
+  hitsAB->Split(f,amultAB,10,"egamABdcIDmultAB%d",DALIIDS,0,DALIIDS,400,0,4000);
+  f = hitsAB->H2("egamABdctrig",atrig,10,0,10,dcenAB,bins,0,bins);
+  hitsAB->Split(f,amult,10,"egamABdctrigmult%d",10,0,10,400,0,4000);
+  hitsAB->Split(f,amultAB,10,"egamABdctrigmultAB%d",10,0,10,400,0,4000);
+  for(int t=0;t<10;t++){
+    f = hitsAB->H2(Form("egamABdctrig%d_theta",t),abeamtheta,100,0,5,dcenAB,bins,0,bins);
+    hitsAB->Gate(f,atrig,t,t+1);
+    hitsAB->Split(f,amult,10,Form("egamABdctrig%dmult%%d_theta",t),100,0,5,4000,0,4000);
+    hitsAB->Split(f,amultAB,10,Form("egamABdctrig%dmultAB%%d_theta",t),100,0,5,4000,0,4000);
+  }
+  f = hitsAB->H1("egamAB_IDgate",enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H1("egamABdc_IDgate",dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABmult_IDgate",amult,20,0,20,enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABmultAB_IDgate",amultAB,20,0,20,enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABdcmult_IDgate",amult,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABdcmultAB_IDgate",amultAB,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+
+  //pairs of DALI hits, the Doppler corrected energies are ordered, the ID gate requires both IDs above minID
+  FillPlan* pairs = new FillPlan(hreg);
+  int en0 = pairs->Variable("en0");
+  int en1 = pairs->Variable("en1");
+  int dcen0 = pairs->Variable("dcen0");
+  int dcen1 = pairs->Variable("dcen1");
+  int tdiff = pairs->Variable("tdiff");
+  int rdiff = pairs->Variable("rdiff");
+  int adiff = pairs->Variable("adiff");
+  int idmin = pairs->Variable("idmin");
+  int pmult = pairs->Variable("mult");
+  pairs->H1("tdiff",tdiff,2000,-1000,1000);
+  pairs->H1("rdiff",rdiff,2000,0,10);
+  pairs->H1("adiff",adiff,2000,0,4);
+  pairs->H2("radiff",adiff,200,0,4,rdiff,200,0,10);
+  f = pairs->H2("egamegam",en0,200,0,4000,en1,200,0,4000);
+  pairs->Split(f,pmult,10,"egamegammult%d");
+  f = pairs->H2("egamegamdc",dcen0,200,0,4000,dcen1,200,0,4000);
+  pairs->Split(f,pmult,10,"egamegamdcmult%d");
+  f = pairs->H2("egamegam_IDgate",en0,200,0,4000,en1,200,0,4000);
+  pairs->Gate(f,idmin,minID);
+  pairs->Split(f,pmult,10,"egamegammult%d_IDgate");
+  f = pairs->H2("egamegamdc_IDgate",dcen0,200,0,4000,dcen1,200,0,4000);
+  pairs->Gate(f,idmin,minID);
+  pairs->Split(f,pmult,10,"egamegamdcmult%d_IDgate");
+
+  //pairs of DALI addback hits
+  FillPlan* pairsAB = new FillPlan(hreg);
+  int en0AB = pairsAB->Variable("en0");
+  int en1AB = pairsAB->Variable("en1");
+  int dcen0AB = pairsAB->Variable("dcen0");
+  int dcen1AB = pairsAB->Variable("dcen1");
+  int idminAB = pairsAB->Variable("idmin");
+  int qmult = pairsAB->Variable("mult");
+  int qmultAB = pairsAB->Variable("multAB");
+  f = pairsAB->H2("egamegamAB",en0AB,200,0,4000,en1AB,200,0,4000);
+  pairsAB->Split(f,qmult,10,"egamegamABmult%d");
+  pairsAB->Split(f,qmultAB,10,"egamegamABmultAB%d");
+  f = pairsAB->H2("egamegamABdc",dcen0AB,200,0,4000,dcen1AB,200,0,4000);
+  pairsAB->Split(f,qmult,10,"egamegamABdcmult%d");
+  pairsAB->Split(f,qmultAB,10,"egamegamABdcmultAB%d");
+  f = pairsAB->H2("egamegamAB_IDgate",en0AB,200,0,4000,en1AB,200,0,4000);
+  pairsAB->Gate(f,idminAB,minID);
+  pairsAB->Split(f,qmult,10,"egamegamABmult%d_IDgate");
+  pairsAB->Split(f,qmultAB,10,"egamegamABmultAB%d_IDgate");
+  f = pairsAB->H2("egamegamABdc_IDgate",dcen0AB,200,0,4000,dcen1AB,200,0,4000);
+  pairsAB->Gate(f,idminAB,minID);
+  pairsAB->Split(f,qmult,10,"egamegamABdcmult%d_IDgate");
+  pairsAB->Split(f,qmultAB,10,"egamegamABdcmultAB%d_IDgate");
+  if(Verbose>1 && slice==0){
+    hits->Print();
+    hitsAB->Print();
+    pairs->Print();
+    pairsAB->Print();
   }
 
 
@@ -338,16 +512,11 @@ int main(int argc, char* argv[]){
   // TCutG *gc = (TCutG*)fc->Get("cscoinc");
   // fc->Close();
 
-  Double_t nentries = tr->GetEntries();
-  cout << nentries << " entries in tree" << endl;
-  if(nentries<1)
-    return 4;
-  if(LastEvent>0)
-    nentries = LastEvent;
-  
+
   Int_t nbytes = 0;
   Int_t status;
-  for(int i=0; i<nentries;i++){
+  int result = 0;
+  for(long long int i=first; i<end; i++){
     if(signal_received){
       break;
     }
@@ -365,11 +534,13 @@ int main(int argc, char* argv[]){
       cout << "status " << status << endl;
     if(status == -1){
       cerr<<"Error occured, couldn't read entry "<<i<<" from tree "<<tr->GetName()<<" in file "<<tr->GetFile()->GetName()<<endl;
-      return 5;
+      result = 5;
+      break;
     }
     else if(status == 0){
       cerr<<"Error occured, entry "<<i<<" in tree "<<tr->GetName()<<" in file "<<tr->GetFile()->GetName()<<" doesn't exist"<<endl;
-      return 6;
+      result = 6;
+      break;
     }
     nbytes += status;
     
@@ -383,27 +554,8 @@ int main(int argc, char* argv[]){
 
     //analysis
 
-    // filter over and underflow
-    dali->SetHits(rec->FilterBadHits(dali->GetHits()));
-
-    // apply timing gate
-    dali->SetHits(rec->TimingGate(dali->GetHits()));
-
-    // recalibration second order
-    if(recalibrate)
-      rec->ReCalibrate(dali->GetHits());
-
-    // sort by energy
-    dali->SetHits(rec->Sort(dali->GetHits()));
-
-    // set the positions
-    rec->SetPositions(dali);
-
-    // addback
-    dali->SetABHits(rec->Addback(dali->GetHits()));
- 
-    // sort by energy
-    dali->SetABHits(rec->Sort(dali->GetHitsAB()));
+    // filter, gate, recalibrate, set the positions, sort, and addback
+    rec->Process(dali,rec->DoReCalibration());
 
     // Doppler correction
     rec->DopplerCorrect(dali);
@@ -527,243 +679,119 @@ int main(int argc, char* argv[]){
     // DALI
     mult->Fill(dali->GetMult());
     multtrig->Fill(trigbit,dali->GetMult());
+    hits->Set(hmult,dali->GetMult());
+    hits->Set(htrig,trigbit);
+    hits->Set(hbeamtheta,beam->GetTheta()*rad2deg);
     for(unsigned short k=0;k<dali->GetMult();k++){
-      ID_theta->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetPos().Theta()*180/TMath::Pi());
-      egam->Fill(dali->GetHit(k)->GetEnergy());
-      egamdc->Fill(dali->GetHit(k)->GetDCEnergy()); 
-      triggertgam->Fill(dali->GetHit(k)->GetTOffset(),trigbit);
-      egamtgam->Fill(dali->GetHit(k)->GetTOffset(),dali->GetHit(k)->GetEnergy());
-      egamdctgam->Fill(dali->GetHit(k)->GetTOffset(),dali->GetHit(k)->GetDCEnergy());    
-      egamtrig->Fill(trigbit,dali->GetHit(k)->GetEnergy());
-      //egamdctrig->Fill(trigbit,dali->GetHit(k)->GetDCEnergy());
-      egammult->Fill(dali->GetMult(),dali->GetHit(k)->GetEnergy());
-      egamdcmult->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      egamdcmult_trig[trigbit]->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      if(dali->GetHit(k)->GetID()>=minID){
-	egamdcmult_IDgate_trig[trigbit]->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      }
-      egamID_mult[0]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-      egamdcID_mult[0]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-      egamdctrig_mult[0]->Fill(trigbit,dali->GetHit(k)->GetDCEnergy());
-      egamdctrigmult_theta[trigbit][0]->Fill(beam->GetTheta()*rad2deg,dali->GetHit(k)->GetDCEnergy());
-	
-      egamdctheta_mult[0]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-      egamdcphi_mult[0]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      if(dali->GetMult()<9){
-	egamID_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-	egamdcID_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-	egamdctrig_mult[dali->GetMult()]->Fill(trigbit,dali->GetHit(k)->GetDCEnergy());
-	egamdctrigmult_theta[trigbit][dali->GetMult()]->Fill(beam->GetTheta()*rad2deg,dali->GetHit(k)->GetDCEnergy());
-	egamdctheta_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-	egamdcphi_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      }
-      else{
-	egamID_mult[9]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-	egamdcID_mult[9]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-	egamdctrig_mult[9]->Fill(trigbit,dali->GetHit(k)->GetDCEnergy());
-	egamdctrigmult_theta[trigbit][9]->Fill(beam->GetTheta()*rad2deg,dali->GetHit(k)->GetDCEnergy());
-	egamdctheta_mult[9]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-	egamdcphi_mult[9]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      }
-      if(dali->GetHit(k)->GetID()>=minID){
-	egam_IDgate->Fill(dali->GetHit(k)->GetEnergy());
-	egamdc_IDgate->Fill(dali->GetHit(k)->GetDCEnergy()); 
-	egammult_IDgate->Fill(dali->GetMult(),dali->GetHit(k)->GetEnergy());
-	egamdcmult_IDgate->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      }
+      DALIHit* hit = dali->GetHit(k);
+      hits->Set(en,hit->GetEnergy());
+      hits->Set(dcen,hit->GetDCEnergy());
+      hits->Set(id,hit->GetID());
+      hits->Set(toffset,hit->GetTOffset());
+      hits->Set(theta,hit->GetPos().Theta());
+      hits->Set(thetadeg,hit->GetPos().Theta()*rad2deg);
+      hits->Set(phi,hit->GetPos().Phi());
+      hits->Next();
     }
+    hits->Fill();
 
     multAB->Fill(dali->GetMultAB());
+    hitsAB->Set(amult,dali->GetMult());
+    hitsAB->Set(amultAB,dali->GetMultAB());
+    hitsAB->Set(atrig,trigbit);
+    hitsAB->Set(abeamtheta,beam->GetTheta()*rad2deg);
     for(unsigned short k=0;k<dali->GetMultAB();k++){
-      egamAB->Fill(dali->GetHitAB(k)->GetEnergy());
-      egamABdc->Fill(dali->GetHitAB(k)->GetDCEnergy());
-      egamABtrig->Fill(trigbit,dali->GetHitAB(k)->GetEnergy());
-      //egamABdctrig->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-      egamABmult->Fill(dali->GetMult(),dali->GetHitAB(k)->GetEnergy());    
-      egamABmultAB->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetEnergy());    
-      egamABID_mult[0]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-      egamABdcmult->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());    
-      egamABdcmultAB->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());    
-      egamABdcmult_trig[trigbit]->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());    
-      egamABdcmultAB_trig[trigbit]->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());    
-      if(dali->GetHitAB(k)->GetID()>=minID){
-	egamABdcmult_IDgate_trig[trigbit]->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());    
-	egamABdcmultAB_IDgate_trig[trigbit]->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());    
-      }
-      egamABdcID_mult[0]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      egamABdctrig_mult[0]->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-      egamABdctrigmult_theta[trigbit][0]->Fill(beam->GetTheta()*rad2deg,dali->GetHitAB(k)->GetDCEnergy());
-      
-      if(dali->GetMult()<9){
-	egamABID_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrig_mult[dali->GetMult()]->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrigmult_theta[trigbit][dali->GetMult()]->Fill(beam->GetTheta()*rad2deg,dali->GetHitAB(k)->GetDCEnergy());
-      }
-      else{
-	egamABID_mult[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_mult[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrig_mult[9]->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrigmult_theta[trigbit][9]->Fill(beam->GetTheta()*rad2deg,dali->GetHitAB(k)->GetDCEnergy());
-      }
-      if(dali->GetMultAB()<9){
-	egamABID_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
- 	egamABdcID_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
- 	egamABdctrig_multAB[dali->GetMultAB()]->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrigmultAB_theta[trigbit][dali->GetMultAB()]->Fill(beam->GetTheta()*rad2deg,dali->GetHitAB(k)->GetDCEnergy());
-      }
-      else{
-	egamABID_multAB[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_multAB[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrig_multAB[9]->Fill(trigbit,dali->GetHitAB(k)->GetDCEnergy());
-	egamABdctrigmultAB_theta[trigbit][9]->Fill(beam->GetTheta()*rad2deg,dali->GetHitAB(k)->GetDCEnergy());
-      }
-      if(dali->GetHitAB(k)->GetID()>=minID){
-	egamAB_IDgate->Fill(dali->GetHitAB(k)->GetEnergy());
-	egamABdc_IDgate->Fill(dali->GetHitAB(k)->GetDCEnergy()); 
-	egamABmult_IDgate->Fill(dali->GetMult(),dali->GetHitAB(k)->GetEnergy());
-	egamABmultAB_IDgate->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcmult_IDgate->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());
- 	egamABdcmultAB_IDgate->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());
-      }
+      DALIHit* hit = dali->GetHitAB(k);
+      hitsAB->Set(enAB,hit->GetEnergy());
+      hitsAB->Set(dcenAB,hit->GetDCEnergy());
+      hitsAB->Set(idAB,hit->GetID());
+      hitsAB->Next();
     }
+    hitsAB->Fill();
 
-    if(dali->GetMult()>1){
-      for(unsigned short k=0;k<dali->GetMult();k++){
-	for(unsigned short l=k+1;l<dali->GetMult();l++){
-	  tdiff->Fill(dali->GetHit(k)->GetTOffset() - dali->GetHit(l)->GetTOffset());
-	  rdiff->Fill(dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  adiff->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()));
-	  radiff->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()),dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  // if(gc->IsInside(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy())){
-	  //   tdiff_coinc->Fill(dali->GetHit(k)->GetTOffset() - dali->GetHit(l)->GetTOffset());
-	  //   rdiff_coinc->Fill(dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  //   adiff_coinc->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()));
-	  //   radiff_coinc->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()),dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  // }
-	  double dcen[2];
-	  if(dali->GetHit(k)->GetDCEnergy() > dali->GetHit(l)->GetDCEnergy()){
-	    dcen[0] = dali->GetHit(k)->GetDCEnergy();
-	    dcen[1] = dali->GetHit(l)->GetDCEnergy();
-	  }
-	  else{
-	    dcen[0] = dali->GetHit(l)->GetDCEnergy();
-	    dcen[1] = dali->GetHit(k)->GetDCEnergy();
-	  }
-	  egamegam_mult[0]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	  egamegamdc_mult[0]->Fill(dcen[0],dcen[1]);
-	  if(dali->GetMult()<9){
-	    egamegam_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegam_mult[9]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_mult[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetHit(k)->GetID()>=minID && dali->GetHit(l)->GetID()>=minID){
-	    egamegam_IDgate_mult[0]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_IDgate_mult[0]->Fill(dcen[0],dcen[1]);
-	    if(dali->GetMult()<9){
-	      egamegam_IDgate_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	      egamegamdc_IDgate_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegam_IDgate_mult[9]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	      egamegamdc_IDgate_mult[9]->Fill(dcen[0],dcen[1]);
-	    }
-	  }//ID gated
-	}
+    pairs->Set(pmult,dali->GetMult());
+    for(unsigned short k=0;k<dali->GetMult();k++){
+      DALIHit* hitk = dali->GetHit(k);
+      for(unsigned short l=k+1;l<dali->GetMult();l++){
+	DALIHit* hitl = dali->GetHit(l);
+	// if(gc->IsInside(hitk->GetEnergy(),hitl->GetEnergy())){
+	//   tdiff_coinc->Fill(hitk->GetTOffset() - hitl->GetTOffset());
+	//   rdiff_coinc->Fill(hitk->GetPos().DeltaR(hitl->GetPos()));
+	//   adiff_coinc->Fill(hitk->GetPos().Angle(hitl->GetPos()));
+	//   radiff_coinc->Fill(hitk->GetPos().Angle(hitl->GetPos()),hitk->GetPos().DeltaR(hitl->GetPos()));
+	// }
+	pairs->Set(en0,hitk->GetEnergy());
+	pairs->Set(en1,hitl->GetEnergy());
+	pairs->Set(dcen0,max(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairs->Set(dcen1,min(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairs->Set(tdiff,hitk->GetTOffset() - hitl->GetTOffset());
+	pairs->Set(rdiff,hitk->GetPos().DeltaR(hitl->GetPos()));
+	pairs->Set(adiff,hitk->GetPos().Angle(hitl->GetPos()));
+	pairs->Set(idmin,min(hitk->GetID(),hitl->GetID()));
+	pairs->Next();
       }
     }
-    if(dali->GetMultAB()>1){
-      for(unsigned short k=0;k<dali->GetMultAB();k++){
-	for(unsigned short l=k+1;l<dali->GetMultAB();l++){
-	  double dcen[2];
-	  if(dali->GetHitAB(k)->GetDCEnergy() > dali->GetHitAB(l)->GetDCEnergy()){
-	    dcen[0] = dali->GetHitAB(k)->GetDCEnergy();
-	    dcen[1] = dali->GetHitAB(l)->GetDCEnergy();
-	  }
-	  else{
-	    dcen[0] = dali->GetHitAB(l)->GetDCEnergy();
-	    dcen[1] = dali->GetHitAB(k)->GetDCEnergy();
-	  }
-	  egamegamAB_mult[0]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	  egamegamABdc_mult[0]->Fill(dcen[0],dcen[1]);
-	  if(dali->GetMult()<9){
-	    egamegamAB_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegamAB_mult[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_mult[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetMultAB()<9){
-	    egamegamAB_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_multAB[dali->GetMultAB()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegamAB_multAB[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_multAB[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetHitAB(k)->GetID()>=minID && dali->GetHitAB(l)->GetID()>=minID){
-	    egamegamAB_IDgate_mult[0]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_IDgate_mult[0]->Fill(dcen[0],dcen[1]);
-	    if(dali->GetMult()<9){
-	      egamegamAB_IDgate_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegamAB_IDgate_mult[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_mult[9]->Fill(dcen[0],dcen[1]);
-	    }
-	    if(dali->GetMultAB()<9){
-	      egamegamAB_IDgate_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_multAB[dali->GetMultAB()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegamAB_IDgate_multAB[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_multAB[9]->Fill(dcen[0],dcen[1]);
-	    }
-	  }
-	}
+    pairs->Fill();
+
+    pairsAB->Set(qmult,dali->GetMult());
+    pairsAB->Set(qmultAB,dali->GetMultAB());
+    for(unsigned short k=0;k<dali->GetMultAB();k++){
+      DALIHit* hitk = dali->GetHitAB(k);
+      for(unsigned short l=k+1;l<dali->GetMultAB();l++){
+	DALIHit* hitl = dali->GetHitAB(l);
+	pairsAB->Set(en0AB,hitk->GetEnergy());
+	pairsAB->Set(en1AB,hitl->GetEnergy());
+	pairsAB->Set(dcen0AB,max(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairsAB->Set(dcen1AB,min(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairsAB->Set(idminAB,min(hitk->GetID(),hitl->GetID()));
+	pairsAB->Next();
       }
     }
+    pairsAB->Fill();
 
     // fill tree
-    rtr->Fill();
-    if(i%10000 == 0){
+    if(rtr!=NULL)
+      rtr->Fill();
+    if(slice==0 && (i-first)%10000 == 0){
       double time_end = get_time();
-      cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*i)/nentries <<
-	" % done\t" << (Float_t)i/(time_end - time_start) << " events/s " << 
-	(nentries-i)*(time_end - time_start)/(Float_t)i << "s to go \r" << flush;
+      cout << setw(5) << setiosflags(ios::fixed) << setprecision(1) << (100.*(i-first))/(end-first) <<
+	" % done\t" << (Float_t)(i-first)/(time_end - time_start) << " events/s " << 
+	(end-i)*(time_end - time_start)/(Float_t)(i-first) << "s to go \r" << flush;
     }
   }
-
-
-  cout << endl;
-  cout << "creating outputfile " << OutFile << endl;
-  TFile* ofile = new TFile(OutFile,"recreate");
-  ofile->cd();
-  TH1F* h1;
-  TH2F* h2;
-  TIter next(hlist);
-  while( (h1 = (TH1F*)next()) ){
-    if(h1->GetEntries()>0)
-      h1->Write("",TObject::kOverwrite);
-  }
-  while( (h2 = (TH2F*)next()) ){
-    if(h2->GetEntries()>0)
-      h2->Write("",TObject::kOverwrite);
-  }
-  if(writeTree>0)
+  if(rtr!=NULL){
+    treefile->cd();
     rtr->Write("",TObject::kOverwrite);
-  ofile->Close();
-  double time_end = get_time();
-  cout << "Program Run time: " << time_end - time_start << " s." << endl;
-  timer.Stop();
-  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
-  return 0;
+    //the tree stays in treefile, its branches must not point to the deleted objects
+    rtr->ResetBranchAddresses();
+  }
+  delete hits;
+  delete hitsAB;
+  delete pairs;
+  delete pairsAB;
+  delete tr;
+  delete ppac;
+  delete beam;
+  for(unsigned short f=0;f<NFPLANES;f++)
+    delete fp[f];
+  delete dali;
+  return result;
 }
+
+/*!
+  Start of the cluster of baskets containing an entry of the chain
+  \param tr the chain
+  \param entry the entry
+  \return the first entry of the cluster
+*/
+long long int ClusterStart(TChain* tr, long long int entry){
+  long long int local = tr->LoadTree(entry);
+  if(local<0 || tr->GetTree()==NULL)
+    return entry;
+  TTree::TClusterIterator cluster = tr->GetTree()->GetClusterIterator(local);
+  return tr->GetTreeOffset()[tr->GetTreeNumber()] + cluster();
+}
+
 void signalhandler(int sig){
   if (sig == SIGINT){
     signal_received = true;
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <sys/time.h>
+#include "CommandLineInterface.hh"
+#include "Calibration.hh"
+#include "Reconstruction.hh"
+
+using namespace std;
+double get_time();
+int main(int argc, char* argv[]){
+  double time_start = get_time();
+  cout << "\"Soft Construction with Boiled Beans\" (1936), Salvador Dali" << endl;
+  cout << "Compiler of the parameter bundles for the WASABI calibration and the DALI reconstruction" << endl;
+  char* WASABISetFile = NULL;
+  char* DALISetFile = NULL;
+  bool Force = false;
+  //Read in the command line arguments
+  CommandLineInterface* interface = new CommandLineInterface();
+  interface->Add("-w", "WASABI settings file, input of Flames", &WASABISetFile);
+  interface->Add("-d", "DALI settings file, input of Persistence", &DALISetFile);
+  interface->Add("-f", "force, rebuild the bundles even if the sources are unchanged", &Force);
+  interface->CheckFlags(argc, argv);
+  //Complain about missing mandatory arguments
+  if(WASABISetFile == NULL && DALISetFile == NULL){
+    cerr<<"You have to provide at least one settings file!"<<endl;
+    return 1;
+  }
+  //the constructors validate and compile the bundle if it is missing or out of date
+  if(WASABISetFile != NULL){
+    cout<<"WASABI settings file: "<<WASABISetFile<<endl;
+    if(Force)
+      remove((string(WASABISetFile) + ".wasabi.bundle").c_str());
+    Calibration* cal = new Calibration(WASABISetFile);
+    delete cal;
+  }
+  if(DALISetFile != NULL){
+    cout<<"DALI settings file: "<<DALISetFile<<endl;
+    if(Force)
+      remove((string(DALISetFile) + ".dali.bundle").c_str());
+    Reconstruction* rec = new Reconstruction(DALISetFile);
+    delete rec;
+  }
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  return 0;
+}
+
+double get_time(){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    double d = t.tv_sec + (double) t.tv_usec/1000000;
+    return d;
+}
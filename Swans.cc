@@ -78,7 +78,15 @@ int main(int argc, char* argv[]){
   WASABIRaw* wasabiRAW = new WASABIRaw;
   tr->SetBranchAddress("wasabiRAW",&wasabiRAW);
   WASABI* wasabi = new WASABI;
-  tr->SetBranchAddress("wasabi",&wasabi);
+  //files converted by Lobster store the WASABI events as columns, these are unpacked into the pooled hits of wasabi
+  WASABIColumns* columns = NULL;
+  if(tr->GetBranch("wasabicol") != NULL){
+    cout << "reading the WASABI columns" << endl;
+    columns = new WASABIColumns;
+    tr->SetBranchAddress("wasabicol",&columns);
+  }
+  else
+    tr->SetBranchAddress("wasabi",&wasabi);
   EURICA *eurica = new EURICA;
   tr->SetBranchAddress("eurica",&eurica);
   Beam* beam = new Beam;
@@ -360,6 +368,8 @@ int main(int argc, char* argv[]){
     }
     wasabiRAW->Clear();
     wasabi->Clear();
+    if(columns != NULL)
+      columns->Clear();
     eurica->Clear();
     beam->Clear();
     for(int f=0;f<NFPLANES;f++){
@@ -379,6 +389,8 @@ int main(int argc, char* argv[]){
       return 6;
     }
     nbytes += status;
+    if(columns != NULL)
+      columns->Get(wasabi);
 
     bigrips->Fill(beam->GetAQ(1),beam->GetZ(1));
     zerodeg->Fill(beam->GetAQ(5),beam->GetZ(5));
@@ -390,13 +402,13 @@ int main(int argc, char* argv[]){
       egamID->Fill((*ghit)->GetID(),(*ghit)->GetEnergy());
     }
     
-    vector<WASABIRawADC*> adcs = wasabiRAW->GetADCs();
-    for(vector<WASABIRawADC*>::iterator hit=adcs.begin(); hit!=adcs.end(); hit++){
+    const vector<WASABIRawADC*>& adcs = wasabiRAW->GetADCs();
+    for(vector<WASABIRawADC*>::const_iterator hit=adcs.begin(); hit!=adcs.end(); hit++){
       //adc[(*hit)->GetADC()][(*hit)->GetChan()]->Fill((*hit)->GetVal());
       adcthresh->Fill((*hit)->GetADC()*NADCCH+(*hit)->GetChan(),(*hit)->GetVal());
     }
-    vector<WASABIRawTDC*> tdcs = wasabiRAW->GetTDCs();
-    for(vector<WASABIRawTDC*>::iterator hit=tdcs.begin(); hit!=tdcs.end(); hit++){
+    const vector<WASABIRawTDC*>& tdcs = wasabiRAW->GetTDCs();
+    for(vector<WASABIRawTDC*>::const_iterator hit=tdcs.begin(); hit!=tdcs.end(); hit++){
       for(unsigned short v = 0; v<(*hit)->GetVal().size(); v++){
 	tdcoffset->Fill((*hit)->GetTDC()*NTDCCH+(*hit)->GetChan(),(*hit)->GetVal().at(v));
       }
@@ -17,6 +17,8 @@
 #include "Beam.hh"
 #include "PPAC.hh"
 #include "Reconstruction.hh"
+#include "HistogramRegistry.hh"
+#include "FillPlan.hh"
 #include "Globaldefs.h"
 
 using namespace TMath;
@@ -100,103 +102,138 @@ int main(int argc, char* argv[]){
     rec->GetSettings()->PrintSettings();
   }
 
-  TList *hlist = new TList();
+  HistogramRegistry* hreg = new HistogramRegistry();
 
-  TH1F* tdiff = new TH1F("tdiff","tdiff",2000,-1000,1000);hlist->Add(tdiff);
-  TH1F* rdiff = new TH1F("rdiff","rdiff",2000,0,10);hlist->Add(rdiff);
-  TH1F* adiff = new TH1F("adiff","adiff",2000,0,4);hlist->Add(adiff);
-  TH2F* radiff = new TH2F("radiff","radiff",200,0,4,200,0,10);hlist->Add(radiff);
-
-  TH2F* beta_z = new TH2F("beta_z","beta_z",500,-5,5,500,0.4,0.6);;hlist->Add(beta_z);
+  LazyHistogram* beta_z = hreg->H2("beta_z","beta_z",500,-5,5,500,0.4,0.6);
   
   int bins = 8000;
   
-  TH1F* mult = new TH1F("mult","mult",50,0,50);hlist->Add(mult);
-  TH1F* egam = new TH1F("egam","egam",bins,0,bins);hlist->Add(egam);
-  TH1F* egamdc = new TH1F("egamdc","egamdc",bins,0,bins);hlist->Add(egamdc);
-  TH1F* egam_IDgate = new TH1F("egam_IDgate","egam_IDgate",bins,0,bins);hlist->Add(egam_IDgate);
-  TH1F* egamdc_IDgate = new TH1F("egamdc_IDgate","egamdc_IDgate",bins,0,bins);hlist->Add(egamdc_IDgate);
-  TH2F* egamtgam = new TH2F("egamtgam","egamtgam",1000,-500,500,1000,0,bins);hlist->Add(egamtgam);
-  TH2F* egamdc_z = new TH2F("egamdc_z","egamdc_z",500,-5,5,1000,0,bins);hlist->Add(egamdc_z);
-  TH2F* egamdctgam = new TH2F("egamdctgam","egamdctgam",1000,-500,500,1000,0,bins);hlist->Add(egamdctgam);
-  TH2F* egammult = new TH2F("egammult","egammult",20,0,20,bins,0,bins);hlist->Add(egammult);
-  TH2F* egamdcmult = new TH2F("egamdcmult","egamdcmult",20,0,20,bins,0,bins);hlist->Add(egamdcmult);
-  TH2F* egammult_IDgate = new TH2F("egammult_IDgate","egammult_IDgate",20,0,20,bins,0,bins);hlist->Add(egammult_IDgate);
-  TH2F* egamdcmult_IDgate = new TH2F("egamdcmult_IDgate","egamdcmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamdcmult_IDgate);
-  TH2F* egamID_mult[10];
-  TH2F* egamdcID_mult[10];
-  TH2F* egamdctheta_mult[10];
-  TH2F* egamdcphi_mult[10];
-  TH2F* egamegam_mult[10];
-  TH2F* egamegamdc_mult[10];
-  TH2F* egamegam_IDgate_mult[10];
-  TH2F* egamegamdc_IDgate_mult[10];
-  TH1F* multAB = new TH1F("multAB","multAB",50,0,50);hlist->Add(multAB);
-  TH1F* egamAB = new TH1F("egamAB","egamAB",bins,0,bins);hlist->Add(egamAB);
-  TH1F* egamABdc = new TH1F("egamABdc","egamABdc",bins,0,bins);hlist->Add(egamABdc);
-  TH2F* egamABdc_z = new TH2F("egamABdc_z","egamABdc_z",500,-5,5,bins,0,bins);hlist->Add(egamABdc_z);
-  TH2F* egamABmult = new TH2F("egamABmult","egamABmult",20,0,20,bins,0,bins);hlist->Add(egamABmult);
-  TH2F* egamABmultAB = new TH2F("egamABmultAB","egamABmultAB",20,0,20,bins,0,bins);hlist->Add(egamABmultAB);
-  TH2F* egamABdcmult = new TH2F("egamABdcmult","egamABdcmult",20,0,20,bins,0,bins);hlist->Add(egamABdcmult);
-  TH2F* egamABdcmultAB = new TH2F("egamABdcmultAB","egamABdcmultAB",20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB);
-  TH1F* egamAB_IDgate = new TH1F("egamAB_IDgate","egamAB_IDgate",bins,0,bins);hlist->Add(egamAB_IDgate);
-  TH1F* egamABdc_IDgate = new TH1F("egamABdc_IDgate","egamABdc_IDgate",bins,0,bins);hlist->Add(egamABdc_IDgate);
-  TH2F* egamABmult_IDgate = new TH2F("egamABmult_IDgate","egamABmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABmult_IDgate);
-  TH2F* egamABmultAB_IDgate = new TH2F("egamABmultAB_IDgate","egamABmultAB_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABmultAB_IDgate);
-  TH2F* egamABdcmult_IDgate = new TH2F("egamABdcmult_IDgate","egamABdcmult_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABdcmult_IDgate);
-  TH2F* egamABdcmultAB_IDgate = new TH2F("egamABdcmultAB_IDgate","egamABdcmultAB_IDgate",20,0,20,bins,0,bins);hlist->Add(egamABdcmultAB_IDgate);
-  TH2F* egamABID_mult[10];
-  TH2F* egamABID_multAB[10];
-  TH2F* egamABdcID_mult[10];
-  TH2F* egamABdcID_multAB[10];
- 
-  TH2F* egamegamAB_mult[10];
-  TH2F* egamegamABdc_mult[10];
-  TH2F* egamegamAB_multAB[10];
-  TH2F* egamegamABdc_multAB[10];
-  TH2F* egamegamAB_IDgate_mult[10];
-  TH2F* egamegamABdc_IDgate_mult[10];
-  TH2F* egamegamAB_IDgate_multAB[10];
-  TH2F* egamegamABdc_IDgate_multAB[10];
+  LazyHistogram* mult = hreg->H1("mult","mult",50,0,50);
+  LazyHistogram* multAB = hreg->H1("multAB","multAB",50,0,50);
 
-  egamID_mult[0] = new TH2F("egamID","egamID",200,0,200,bins,0,bins);hlist->Add(egamID_mult[0]);
-  egamdcID_mult[0] = new TH2F("egamdcID","egamdcID",200,0,200,bins,0,bins);hlist->Add(egamdcID_mult[0]);
-  egamdctheta_mult[0] = new TH2F("egamdctheta","egamdctheta",200,0,4,400,0,bins);hlist->Add(egamdctheta_mult[0]);
-  egamdcphi_mult[0] = new TH2F("egamdcphi","egamdcphi",200,-4,4,400,0,bins);hlist->Add(egamdcphi_mult[0]);
-  egamABID_mult[0] = new TH2F("egamABID","egamABID",200,0,200,bins,0,bins);hlist->Add(egamABID_mult[0]);
-  egamABdcID_mult[0] = new TH2F("egamABdcID","egamABdcID",200,0,200,bins,0,bins);hlist->Add(egamABdcID_mult[0]);
-  
-  egamegam_mult[0] = new TH2F("egamegam","egamegam",200,0,4000,200,0,4000);hlist->Add(egamegam_mult[0]);
-  egamegamdc_mult[0] = new TH2F("egamegamdc","egamegamdc",200,0,4000,200,0,4000);hlist->Add(egamegamdc_mult[0]);
-  egamegamAB_mult[0] = new TH2F("egamegamAB","egamegamAB",200,0,4000,200,0,4000);hlist->Add(egamegamAB_mult[0]);
-  egamegamABdc_mult[0] = new TH2F("egamegamABdc","egamegamABdc",200,0,4000,200,0,4000);hlist->Add(egamegamABdc_mult[0]);
-  egamegam_IDgate_mult[0] = new TH2F("egamegam_IDgate","egamegam_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegam_IDgate_mult[0]);
-  egamegamdc_IDgate_mult[0] = new TH2F("egamegamdc_IDgate","egamegamdc_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamdc_IDgate_mult[0]);
-  egamegamAB_IDgate_mult[0] = new TH2F("egamegamAB_IDgate","egamegamAB_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_mult[0]);
-  egamegamABdc_IDgate_mult[0] = new TH2F("egamegamABdc_IDgate","egamegamABdc_IDgate",200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_mult[0]);
-  for(int m=1;m<10;m++){
-    egamID_mult[m] = new TH2F(Form("egamIDmult%d",m),Form("egamIDmult%d",m),200,0,200,400,0,4000);hlist->Add(egamID_mult[m]);
-    egamdcID_mult[m] = new TH2F(Form("egamdcIDmult%d",m),Form("egamdcIDmult%d",m),200,0,200,400,0,4000);hlist->Add(egamdcID_mult[m]);
-    egamdctheta_mult[m] = new TH2F(Form("egamdcthetamult%d",m),Form("egamdcthetamult%d",m),200,0,4,400,0,4000);hlist->Add(egamdctheta_mult[m]);
-    egamdcphi_mult[m] = new TH2F(Form("egamdcphimult%d",m),Form("egamdcphimult%d",m),200,-4,4,400,0,4000);hlist->Add(egamdcphi_mult[m]);
-    egamABID_mult[m] = new TH2F(Form("egamABIDmult%d",m),Form("egamABIDmult%d",m),200,0,200,400,0,4000);hlist->Add(egamABID_mult[m]);
-    egamABID_multAB[m] = new TH2F(Form("egamABIDmultAB%d",m),Form("egamABIDmultAB%d",m),200,0,200,400,0,4000);hlist->Add(egamABID_multAB[m]);
-    egamABdcID_mult[m] = new TH2F(Form("egamABdcIDmult%d",m),Form("egamABdcIDmult%d",m),200,0,200,400,0,4000);hlist->Add(egamABdcID_mult[m]);
-    egamABdcID_multAB[m] = new TH2F(Form("egamABdcIDmultAB%d",m),Form("egamABdcIDmultAB%d",m),200,0,200,400,0,4000);hlist->Add(egamABdcID_multAB[m]);
-    
-    egamegam_mult[m] = new TH2F(Form("egamegammult%d",m),Form("egamegammult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegam_mult[m]);
-    egamegamdc_mult[m] = new TH2F(Form("egamegamdcmult%d",m),Form("egamegamdcmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamdc_mult[m]);
-    egamegamAB_mult[m] = new TH2F(Form("egamegamABmult%d",m),Form("egamegamABmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_mult[m]);
-    egamegamABdc_mult[m] = new TH2F(Form("egamegamABdcmult%d",m),Form("egamegamABdcmult%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_mult[m]);
-    egamegamAB_multAB[m] = new TH2F(Form("egamegamABmultAB%d",m),Form("egamegamABmultAB%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_multAB[m]);
-    egamegamABdc_multAB[m] = new TH2F(Form("egamegamABdcmultAB%d",m),Form("egamegamABdcmultAB%d",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_multAB[m]);
+  //DALI hits, the spectra are also split by multiplicity, and gated on the ID
+  FillPlan* hits = new FillPlan(hreg);
+  int en = hits->Variable("en");
+  int dcen = hits->Variable("dcen");
+  int id = hits->Variable("id");
+  int toffset = hits->Variable("toffset");
+  int theta = hits->Variable("theta");
+  int phi = hits->Variable("phi");
+  int hmult = hits->Variable("mult");
+  int hz = hits->Variable("z");
+  int f;
+  hits->H1("egam",en,bins,0,bins);
+  hits->H1("egamdc",dcen,bins,0,bins);
+  hits->H2("egamdc_z",hz,500,-5,5,dcen,1000,0,bins);
+  hits->H2("egamtgam",toffset,1000,-500,500,en,1000,0,bins);
+  hits->H2("egamdctgam",toffset,1000,-500,500,dcen,1000,0,bins);
+  hits->H2("egammult",hmult,20,0,20,en,bins,0,bins);
+  hits->H2("egamdcmult",hmult,20,0,20,dcen,bins,0,bins);
+  f = hits->H2("egamID",id,200,0,200,en,bins,0,bins);
+  hits->Split(f,hmult,10,"egamIDmult%d",200,0,200,400,0,4000);
+  f = hits->H2("egamdcID",id,200,0,200,dcen,bins,0,bins);
+  hits->Split(f,hmult,10,"egamdcIDmult%d",200,0,200,400,0,4000);
+  f = hits->H2("egamdctheta",theta,200,0,4,dcen,400,0,bins);
+  hits->Split(f,hmult,10,"egamdcthetamult%d",200,0,4,400,0,4000);
+  f = hits->H2("egamdcphi",phi,200,-4,4,dcen,400,0,bins);
+  hits->Split(f,hmult,10,"egamdcphimult%d",200,-4,4,400,0,4000);
+  f = hits->H1("egam_IDgate",en,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H1("egamdc_IDgate",dcen,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H2("egammult_IDgate",hmult,20,0,20,en,bins,0,bins);
+  hits->Gate(f,id,minID);
+  f = hits->H2("egamdcmult_IDgate",hmult,20,0,20,dcen,bins,0,bins);
+  hits->Gate(f,id,minID);
+
+  //DALI addback hits, split by the multiplicity before and after addback
+  FillPlan* hitsAB = new FillPlan(hreg);
+  int enAB = hitsAB->Variable("en");
+  int dcenAB = hitsAB->Variable("dcen");
+  int idAB = hitsAB->Variable("id");
+  int amult = hitsAB->Variable("mult");
+  int amultAB = hitsAB->Variable("multAB");
+  int az = hitsAB->Variable("z");
+  hitsAB->H1("egamAB",enAB,bins,0,bins);
+  hitsAB->H1("egamABdc",dcenAB,bins,0,bins);
+  hitsAB->H2("egamABdc_z",az,500,-5,5,dcenAB,bins,0,bins);
+  hitsAB->H2("egamABmult",amult,20,0,20,enAB,bins,0,bins);
+  hitsAB->H2("egamABmultAB",amultAB,20,0,20,enAB,bins,0,bins);
+  hitsAB->H2("egamABdcmult",amult,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->H2("egamABdcmultAB",amultAB,20,0,20,dcenAB,bins,0,bins);
+  f = hitsAB->H2("egamABID",idAB,200,0,200,enAB,bins,0,bins);
+  hitsAB->Split(f,amult,10,"egamABIDmult%d",200,0,200,400,0,4000);
+  hitsAB->Split(f,amultAB,10,"egamABIDmultAB%d",200,0,200,400,0,4000);
+  f = hitsAB->H2("egamABdcID",idAB,200,0,200,dcenAB,bins,0,bins);
+  hitsAB->Split(f,amult,10,"egamABdcIDmult%d",200,0,200,400,0,4000);
+  hitsAB->Split(f,amultAB,10,"egamABdcIDmultAB%d",200,0,200,400,0,4000);
+  f = hitsAB->H1("egamAB_IDgate",enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H1("egamABdc_IDgate",dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABmult_IDgate",amult,20,0,20,enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABmultAB_IDgate",amultAB,20,0,20,enAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABdcmult_IDgate",amult,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
+  f = hitsAB->H2("egamABdcmultAB_IDgate",amultAB,20,0,20,dcenAB,bins,0,bins);
+  hitsAB->Gate(f,idAB,minID);
 
-    egamegam_IDgate_mult[m] = new TH2F(Form("egamegammult%d_IDgate",m),Form("egamegammult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegam_IDgate_mult[m]);
-    egamegamdc_IDgate_mult[m] = new TH2F(Form("egamegamdcmult%d_IDgate",m),Form("egamegamdcmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamdc_IDgate_mult[m]);
-    egamegamAB_IDgate_mult[m] = new TH2F(Form("egamegamABmult%d_IDgate",m),Form("egamegamABmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_mult[m]);
-    egamegamABdc_IDgate_mult[m] = new TH2F(Form("egamegamABdcmult%d_IDgate",m),Form("egamegamABdcmult%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_mult[m]);
-    egamegamAB_IDgate_multAB[m] = new TH2F(Form("egamegamABmultAB%d_IDgate",m),Form("egamegamABmultAB%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamAB_IDgate_multAB[m]);
-    egamegamABdc_IDgate_multAB[m] = new TH2F(Form("egamegamABdcmultAB%d_IDgate",m),Form("egamegamABdcmultAB%d_IDgate",m),200,0,4000,200,0,4000);hlist->Add(egamegamABdc_IDgate_multAB[m]);
+  //pairs of DALI hits, the Doppler corrected energies are ordered, the ID gate requires both IDs above minID
+  FillPlan* pairs = new FillPlan(hreg);
+  int en0 = pairs->Variable("en0");
+  int en1 = pairs->Variable("en1");
+  int dcen0 = pairs->Variable("dcen0");
+  int dcen1 = pairs->Variable("dcen1");
+  int tdiff = pairs->Variable("tdiff");
+  int rdiff = pairs->Variable("rdiff");
+  int adiff = pairs->Variable("adiff");
+  int idmin = pairs->Variable("idmin");
+  int pmult = pairs->Variable("mult");
+  pairs->H1("tdiff",tdiff,2000,-1000,1000);
+  pairs->H1("rdiff",rdiff,2000,0,10);
+  pairs->H1("adiff",adiff,2000,0,4);
+  pairs->H2("radiff",adiff,200,0,4,rdiff,200,0,10);
+  f = pairs->H2("egamegam",en0,200,0,4000,en1,200,0,4000);
+  pairs->Split(f,pmult,10,"egamegammult%d");
+  f = pairs->H2("egamegamdc",dcen0,200,0,4000,dcen1,200,0,4000);
+  pairs->Split(f,pmult,10,"egamegamdcmult%d");
+  f = pairs->H2("egamegam_IDgate",en0,200,0,4000,en1,200,0,4000);
+  pairs->Gate(f,idmin,minID);
+  pairs->Split(f,pmult,10,"egamegammult%d_IDgate");
+  f = pairs->H2("egamegamdc_IDgate",dcen0,200,0,4000,dcen1,200,0,4000);
+  pairs->Gate(f,idmin,minID);
+  pairs->Split(f,pmult,10,"egamegamdcmult%d_IDgate");
+
+  //pairs of DALI addback hits
+  FillPlan* pairsAB = new FillPlan(hreg);
+  int en0AB = pairsAB->Variable("en0");
+  int en1AB = pairsAB->Variable("en1");
+  int dcen0AB = pairsAB->Variable("dcen0");
+  int dcen1AB = pairsAB->Variable("dcen1");
+  int idminAB = pairsAB->Variable("idmin");
+  int qmult = pairsAB->Variable("mult");
+  int qmultAB = pairsAB->Variable("multAB");
+  f = pairsAB->H2("egamegamAB",en0AB,200,0,4000,en1AB,200,0,4000);
+  pairsAB->Split(f,qmult,10,"egamegamABmult%d");
+  pairsAB->Split(f,qmultAB,10,"egamegamABmultAB%d");
+  f = pairsAB->H2("egamegamABdc",dcen0AB,200,0,4000,dcen1AB,200,0,4000);
+  pairsAB->Split(f,qmult,10,"egamegamABdcmult%d");
+  pairsAB->Split(f,qmultAB,10,"egamegamABdcmultAB%d");
+  f = pairsAB->H2("egamegamAB_IDgate",en0AB,200,0,4000,en1AB,200,0,4000);
+  pairsAB->Gate(f,idminAB,minID);
+  pairsAB->Split(f,qmult,10,"egamegamABmult%d_IDgate");
+  pairsAB->Split(f,qmultAB,10,"egamegamABmultAB%d_IDgate");
+  f = pairsAB->H2("egamegamABdc_IDgate",dcen0AB,200,0,4000,dcen1AB,200,0,4000);
+  pairsAB->Gate(f,idminAB,minID);
+  pairsAB->Split(f,qmult,10,"egamegamABdcmult%d_IDgate");
+  pairsAB->Split(f,qmultAB,10,"egamegamABdcmultAB%d_IDgate");
+  if(Verbose>1){
+    hits->Print();
+    hitsAB->Print();
+    pairs->Print();
+    pairsAB->Print();
   }
 
 
@@ -237,23 +274,8 @@ int main(int argc, char* argv[]){
 
     //analysis
 
-    // filter over and underflow
-    dali->SetHits(rec->FilterBadHits(dali->GetHits()));
-
-    // apply timing gate
-    dali->SetHits(rec->TimingGate(dali->GetHits()));
-
-     // sort by energy
-    dali->SetHits(rec->Sort(dali->GetHits()));
-
-    // set the positions
-    rec->SetPositions(dali);
-
-    // addback
-    dali->SetABHits(rec->Addback(dali->GetHits()));
- 
-    // sort by energy
-    dali->SetABHits(rec->Sort(dali->GetHitsAB()));
+    // filter, gate, set the positions, sort, and addback, the energies are not recalibrated
+    rec->Process(dali,false);
 
     // Doppler correction
     double recbeta  = rec->DopplerCorrect(dali,p0[2]);
@@ -264,177 +286,72 @@ int main(int argc, char* argv[]){
 
     // DALI
     mult->Fill(dali->GetMult());
-     for(unsigned short k=0;k<dali->GetMult();k++){
-      egam->Fill(dali->GetHit(k)->GetEnergy());
-      egamdc->Fill(dali->GetHit(k)->GetDCEnergy()); 
-      egamdc_z->Fill(p0[2],dali->GetHit(k)->GetDCEnergy()); 
-      egamtgam->Fill(dali->GetHit(k)->GetTOffset(),dali->GetHit(k)->GetEnergy());
-      egamdctgam->Fill(dali->GetHit(k)->GetTOffset(),dali->GetHit(k)->GetDCEnergy());    
-      egammult->Fill(dali->GetMult(),dali->GetHit(k)->GetEnergy());
-      egamdcmult->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      egamID_mult[0]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-      egamdcID_mult[0]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-	
-      egamdctheta_mult[0]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-      egamdcphi_mult[0]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      if(dali->GetMult()<9){
-	egamID_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-	egamdcID_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-	egamdctheta_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-	egamdcphi_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      }
-      else{
-	egamID_mult[9]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetEnergy());
-	egamdcID_mult[9]->Fill(dali->GetHit(k)->GetID(),dali->GetHit(k)->GetDCEnergy());
-	egamdctheta_mult[9]->Fill(dali->GetHit(k)->GetPos().Theta(),dali->GetHit(k)->GetDCEnergy());
-	egamdcphi_mult[9]->Fill(dali->GetHit(k)->GetPos().Phi(),dali->GetHit(k)->GetDCEnergy());
-      }
-      if(dali->GetHit(k)->GetID()>=minID){
-	egam_IDgate->Fill(dali->GetHit(k)->GetEnergy());
-	egamdc_IDgate->Fill(dali->GetHit(k)->GetDCEnergy()); 
-	egammult_IDgate->Fill(dali->GetMult(),dali->GetHit(k)->GetEnergy());
-	egamdcmult_IDgate->Fill(dali->GetMult(),dali->GetHit(k)->GetDCEnergy());
-      }
+    hits->Set(hmult,dali->GetMult());
+    hits->Set(hz,p0[2]);
+    for(unsigned short k=0;k<dali->GetMult();k++){
+      DALIHit* hit = dali->GetHit(k);
+      hits->Set(en,hit->GetEnergy());
+      hits->Set(dcen,hit->GetDCEnergy());
+      hits->Set(id,hit->GetID());
+      hits->Set(toffset,hit->GetTOffset());
+      hits->Set(theta,hit->GetPos().Theta());
+      hits->Set(phi,hit->GetPos().Phi());
+      hits->Next();
     }
+    hits->Fill();
 
     multAB->Fill(dali->GetMultAB());
+    hitsAB->Set(amult,dali->GetMult());
+    hitsAB->Set(amultAB,dali->GetMultAB());
+    hitsAB->Set(az,p0[2]);
     for(unsigned short k=0;k<dali->GetMultAB();k++){
-      egamAB->Fill(dali->GetHitAB(k)->GetEnergy());
-      egamABdc->Fill(dali->GetHitAB(k)->GetDCEnergy());
-      egamABdc_z->Fill(p0[2],dali->GetHitAB(k)->GetDCEnergy());
-      egamABmult->Fill(dali->GetMult(),dali->GetHitAB(k)->GetEnergy());    
-      egamABmultAB->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetEnergy());    
-      egamABID_mult[0]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-      egamABdcmult->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());    
-      egamABdcmultAB->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());    
-      egamABdcID_mult[0]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      
-      if(dali->GetMult()<9){
-	egamABID_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      }
-      else{
-	egamABID_mult[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_mult[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      }
-      if(dali->GetMultAB()<9){
-	egamABID_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
- 	egamABdcID_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      }
-      else{
-	egamABID_multAB[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcID_multAB[9]->Fill(dali->GetHitAB(k)->GetID(),dali->GetHitAB(k)->GetDCEnergy());
-      }
-      if(dali->GetHitAB(k)->GetID()>=minID){
-	egamAB_IDgate->Fill(dali->GetHitAB(k)->GetEnergy());
-	egamABdc_IDgate->Fill(dali->GetHitAB(k)->GetDCEnergy()); 
-	egamABmult_IDgate->Fill(dali->GetMult(),dali->GetHitAB(k)->GetEnergy());
-	egamABmultAB_IDgate->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetEnergy());
-	egamABdcmult_IDgate->Fill(dali->GetMult(),dali->GetHitAB(k)->GetDCEnergy());
- 	egamABdcmultAB_IDgate->Fill(dali->GetMultAB(),dali->GetHitAB(k)->GetDCEnergy());
-      }
+      DALIHit* hit = dali->GetHitAB(k);
+      hitsAB->Set(enAB,hit->GetEnergy());
+      hitsAB->Set(dcenAB,hit->GetDCEnergy());
+      hitsAB->Set(idAB,hit->GetID());
+      hitsAB->Next();
     }
+    hitsAB->Fill();
 
-    if(dali->GetMult()>1){
-      for(unsigned short k=0;k<dali->GetMult();k++){
-	for(unsigned short l=k+1;l<dali->GetMult();l++){
-	  tdiff->Fill(dali->GetHit(k)->GetTOffset() - dali->GetHit(l)->GetTOffset());
-	  rdiff->Fill(dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  adiff->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()));
-	  radiff->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()),dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  // if(gc->IsInside(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy())){
-	  //   tdiff_coinc->Fill(dali->GetHit(k)->GetTOffset() - dali->GetHit(l)->GetTOffset());
-	  //   rdiff_coinc->Fill(dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  //   adiff_coinc->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()));
-	  //   radiff_coinc->Fill(dali->GetHit(k)->GetPos().Angle(dali->GetHit(l)->GetPos()),dali->GetHit(k)->GetPos().DeltaR(dali->GetHit(l)->GetPos()));
-	  // }
-	  double dcen[2];
-	  if(dali->GetHit(k)->GetDCEnergy() > dali->GetHit(l)->GetDCEnergy()){
-	    dcen[0] = dali->GetHit(k)->GetDCEnergy();
-	    dcen[1] = dali->GetHit(l)->GetDCEnergy();
-	  }
-	  else{
-	    dcen[0] = dali->GetHit(l)->GetDCEnergy();
-	    dcen[1] = dali->GetHit(k)->GetDCEnergy();
-	  }
-	  egamegam_mult[0]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	  egamegamdc_mult[0]->Fill(dcen[0],dcen[1]);
-	  if(dali->GetMult()<9){
-	    egamegam_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegam_mult[9]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_mult[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetHit(k)->GetID()>=minID && dali->GetHit(l)->GetID()>=minID){
-	    egamegam_IDgate_mult[0]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	    egamegamdc_IDgate_mult[0]->Fill(dcen[0],dcen[1]);
-	    if(dali->GetMult()<9){
-	      egamegam_IDgate_mult[dali->GetMult()]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	      egamegamdc_IDgate_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegam_IDgate_mult[9]->Fill(dali->GetHit(k)->GetEnergy(),dali->GetHit(l)->GetEnergy());
-	      egamegamdc_IDgate_mult[9]->Fill(dcen[0],dcen[1]);
-	    }
-	  }//ID gated
-	}
+    pairs->Set(pmult,dali->GetMult());
+    for(unsigned short k=0;k<dali->GetMult();k++){
+      DALIHit* hitk = dali->GetHit(k);
+      for(unsigned short l=k+1;l<dali->GetMult();l++){
+	DALIHit* hitl = dali->GetHit(l);
+	// if(gc->IsInside(hitk->GetEnergy(),hitl->GetEnergy())){
+	//   tdiff_coinc->Fill(hitk->GetTOffset() - hitl->GetTOffset());
+	//   rdiff_coinc->Fill(hitk->GetPos().DeltaR(hitl->GetPos()));
+	//   adiff_coinc->Fill(hitk->GetPos().Angle(hitl->GetPos()));
+	//   radiff_coinc->Fill(hitk->GetPos().Angle(hitl->GetPos()),hitk->GetPos().DeltaR(hitl->GetPos()));
+	// }
+	pairs->Set(en0,hitk->GetEnergy());
+	pairs->Set(en1,hitl->GetEnergy());
+	pairs->Set(dcen0,max(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairs->Set(dcen1,min(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairs->Set(tdiff,hitk->GetTOffset() - hitl->GetTOffset());
+	pairs->Set(rdiff,hitk->GetPos().DeltaR(hitl->GetPos()));
+	pairs->Set(adiff,hitk->GetPos().Angle(hitl->GetPos()));
+	pairs->Set(idmin,min(hitk->GetID(),hitl->GetID()));
+	pairs->Next();
       }
     }
-    if(dali->GetMultAB()>1){
-      for(unsigned short k=0;k<dali->GetMultAB();k++){
-	for(unsigned short l=k+1;l<dali->GetMultAB();l++){
-	  double dcen[2];
-	  if(dali->GetHitAB(k)->GetDCEnergy() > dali->GetHitAB(l)->GetDCEnergy()){
-	    dcen[0] = dali->GetHitAB(k)->GetDCEnergy();
-	    dcen[1] = dali->GetHitAB(l)->GetDCEnergy();
-	  }
-	  else{
-	    dcen[0] = dali->GetHitAB(l)->GetDCEnergy();
-	    dcen[1] = dali->GetHitAB(k)->GetDCEnergy();
-	  }
-	  egamegamAB_mult[0]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	  egamegamABdc_mult[0]->Fill(dcen[0],dcen[1]);
-	  if(dali->GetMult()<9){
-	    egamegamAB_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegamAB_mult[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_mult[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetMultAB()<9){
-	    egamegamAB_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_multAB[dali->GetMultAB()]->Fill(dcen[0],dcen[1]);
-	  }
-	  else{
-	    egamegamAB_multAB[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_multAB[9]->Fill(dcen[0],dcen[1]);
-	  }
-	  if(dali->GetHitAB(k)->GetID()>=minID && dali->GetHitAB(l)->GetID()>=minID){
-	    egamegamAB_IDgate_mult[0]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	    egamegamABdc_IDgate_mult[0]->Fill(dcen[0],dcen[1]);
-	    if(dali->GetMult()<9){
-	      egamegamAB_IDgate_mult[dali->GetMult()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_mult[dali->GetMult()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegamAB_IDgate_mult[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_mult[9]->Fill(dcen[0],dcen[1]);
-	    }
-	    if(dali->GetMultAB()<9){
-	      egamegamAB_IDgate_multAB[dali->GetMultAB()]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_multAB[dali->GetMultAB()]->Fill(dcen[0],dcen[1]);
-	    }
-	    else{
-	      egamegamAB_IDgate_multAB[9]->Fill(dali->GetHitAB(k)->GetEnergy(),dali->GetHitAB(l)->GetEnergy());
-	      egamegamABdc_IDgate_multAB[9]->Fill(dcen[0],dcen[1]);
-	    }
-	  }
-	}
+    pairs->Fill();
+
+    pairsAB->Set(qmult,dali->GetMult());
+    pairsAB->Set(qmultAB,dali->GetMultAB());
+    for(unsigned short k=0;k<dali->GetMultAB();k++){
+      DALIHit* hitk = dali->GetHitAB(k);
+      for(unsigned short l=k+1;l<dali->GetMultAB();l++){
+	DALIHit* hitl = dali->GetHitAB(l);
+	pairsAB->Set(en0AB,hitk->GetEnergy());
+	pairsAB->Set(en1AB,hitl->GetEnergy());
+	pairsAB->Set(dcen0AB,max(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairsAB->Set(dcen1AB,min(hitk->GetDCEnergy(),hitl->GetDCEnergy()));
+	pairsAB->Set(idminAB,min(hitk->GetID(),hitl->GetID()));
+	pairsAB->Next();
       }
     }
+    pairsAB->Fill();
 
     if(i%10000 == 0){
       double time_end = get_time();
@@ -449,17 +366,8 @@ int main(int argc, char* argv[]){
   cout << "creating outputfile " << OutFile << endl;
   TFile* ofile = new TFile(OutFile,"recreate");
   ofile->cd();
-  TH1F* h1;
-  TH2F* h2;
-  TIter next(hlist);
-  while( (h1 = (TH1F*)next()) ){
-    if(h1->GetEntries()>0)
-      h1->Write("",TObject::kOverwrite);
-  }
-  while( (h2 = (TH2F*)next()) ){
-    if(h2->GetEntries()>0)
-      h2->Write("",TObject::kOverwrite);
-  }
+  hreg->Write();
+  hreg->MemoryReport(Verbose>0);
   ofile->Close();
   double time_end = get_time();
   cout << "Program Run time: " << time_end - time_start << " s." << endl;
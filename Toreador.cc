@@ -0,0 +1,161 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include "TMath.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TStopwatch.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "CommandLineInterface.hh"
+#include "BuildEvents.hh"
+#include "Globaldefs.h"
+
+using namespace TMath;
+using namespace std;
+bool signal_received = false;
+void signalhandler(int sig);
+double get_time();
+int main(int argc, char* argv[]){
+  double time_start = get_time();
+  TStopwatch timer;
+  timer.Start();
+  signal(SIGINT,signalhandler);
+  cout << "\"The Hallucinogenic Toreador\" (1970), Salvador Dali" << endl;
+  cout << "Benchmark for the event building of WASABI, EURICA, and BigRIPS" << endl;
+  int Verbose = -1;
+  long long int Window = 10000;
+  int Mode = 0;
+  int Prefetch = 256;
+  bool TwoPass = false;
+  bool Segmented = false;
+  int Repeat = 1;
+  bool Keep = false;
+  char* InputBigRIPS = NULL;
+  char* InputWASABI = NULL;
+  char* InputEURICA = NULL;
+  char* OutFile = (char*)"toreador.root";
+  //Read in the command line arguments
+  CommandLineInterface* interface = new CommandLineInterface();
+  interface->Add("-b", "BigRIPS input file", &InputBigRIPS);
+  interface->Add("-e", "EURICA input file", &InputEURICA);
+  interface->Add("-w", "WASABI input file", &InputWASABI);
+  interface->Add("-o", "output file, default toreador.root", &OutFile);
+  interface->Add("-k", "keep the output file", &Keep);
+  interface->Add("-wi", "event building window", &Window);
+  interface->Add("-m", "event building mode: 0 everything, 1 isomerdata", &Mode);
+  interface->Add("-pf", "number of entries to read ahead per input file, 0 reads in the main thread", &Prefetch);
+  interface->Add("-tp", "two pass mode, pre-scan the timestamps and read only entries of written events", &TwoPass);
+  interface->Add("-seg", "find the timestamp resets first and merge the segments between them separately", &Segmented);
+  interface->Add("-r", "number of repetitions", &Repeat);
+  interface->Add("-v", "verbose level", &Verbose);
+  interface->CheckFlags(argc, argv);
+  if(InputBigRIPS == NULL && InputWASABI == NULL && InputEURICA == NULL){
+    cout << "No input file given " << endl;
+    return 2;
+  }
+  if(TwoPass && Prefetch>0){
+    cout << "two pass mode, entries are not read ahead" << endl;
+    Prefetch = 0;
+  }
+  if(Segmented && TwoPass){
+    cout << "timestamp segments can not be used together with the two pass mode" << endl;
+    Segmented = false;
+  }
+  if(Prefetch>0)
+    ROOT::EnableThreadSafety();
+
+  for(int r=0;r<Repeat && !signal_received;r++){
+    TTree* trbigrips = NULL;
+    TTree* treurica = NULL;
+    TTree* trwasabi = NULL;
+    TFile* inbigrips = NULL;
+    TFile* ineurica = NULL;
+    TFile* inwasabi = NULL;
+    if(InputBigRIPS != NULL){
+      inbigrips = new TFile(InputBigRIPS);
+      trbigrips = (TTree*) inbigrips->Get("tr");
+    }
+    if(InputEURICA != NULL){
+      ineurica = new TFile(InputEURICA);
+      treurica = (TTree*) ineurica->Get("tree");
+    }
+    if(InputWASABI != NULL){
+      inwasabi = new TFile(InputWASABI);
+      trwasabi = (TTree*) inwasabi->Get("tr");
+    }
+    TFile* ofile = new TFile(OutFile,"recreate");
+    ofile->cd();
+
+    double time_run = get_time();
+    BuildEvents* evts = new BuildEvents();
+    evts->SetVerbose(Verbose);
+    evts->SetWindow(Window);
+    evts->SetCoincMode(Mode);
+    evts->SetPrefetch(Prefetch);
+    evts->Init(trbigrips,trwasabi,treurica);
+    if(TwoPass)
+      evts->PreScan();
+    vector<eventrange> segments;
+    if(Segmented)
+      segments = evts->Segments();
+    unsigned int seg = 0;
+    do{
+      if(segments.size()>0)
+	evts->SetRange(segments[seg]);
+      evts->ReadEach();
+      while(evts->Merge()){
+	if(signal_received){
+	  break;
+	}
+      }
+      evts->CloseEvent();
+      seg++;
+    }while(seg<segments.size() && !signal_received);
+    double elapsed = get_time() - time_run;
+
+    unsigned long long int steps = evts->GetMergeSteps();
+    double written = evts->GetTree()->GetEntries();
+    double bytes = evts->GetBytesRead();
+    cout << "run " << r << ": " << setiosflags(ios::fixed) << setprecision(1);
+    cout << steps/elapsed << " merge steps/s, " << written/elapsed << " events/s written, ";
+    cout << bytes/1e6/elapsed << " MB/s read, " << elapsed << " s" << endl;
+    if(Keep)
+      evts->GetTree()->Write("",TObject::kOverwrite);
+    delete evts;
+    ofile->Close();
+    if(inbigrips!=NULL)
+      inbigrips->Close();
+    if(inwasabi!=NULL)
+      inwasabi->Close();
+    if(ineurica!=NULL)
+      ineurica->Close();
+  }
+  if(!Keep)
+    gSystem->Unlink(OutFile);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cout << "peak RSS: " << usage.ru_maxrss/1024. << " MB" << endl;
+  double time_end = get_time();
+  cout << "Program Run time: " << time_end - time_start << " s." << endl;
+  timer.Stop();
+  cout << "CPU time: " << timer.CpuTime() << "\tReal time: " << timer.RealTime() << endl;
+  return 0;
+}
+void signalhandler(int sig){
+  if (sig == SIGINT){
+    signal_received = true;
+  }
+}
+
+double get_time(){
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    double d = t.tv_sec + (double) t.tv_usec/1000000;
+    return d;
+}
@@ -2,8 +2,12 @@
 #define __BUILDEVENTS_HH
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <sstream>
 
 #include "TTree.h"
+#include "TH1F.h"
+#include "TObjString.h"
 #include "TClonesArray.h"
 #include "TArtEventInfo.hh"
 #include "TArtGeCluster.hh"
@@ -13,7 +17,7 @@
 #include "WASABI.hh"
 #include "EURICA.hh"
 #include "Globaldefs.h"
-
+#include "StreamReader.hh"
 
 /*!
   A container to keep track of the timestamps and corresponding detectors
@@ -21,19 +25,104 @@
 struct detector{
   //! timestamp of the detector hit
   unsigned long long int TS;
-  //! ID for the detector, 0 BigRIPS, 1 WASABI
+  //! ID of the input stream, see streamID
   int ID;
 };
 
+/*!
+  A class for ordering the detectors in time, used for the heap of stream heads
+*/
+class TSComparer {
+public:
+  //! comparator, true if lhs comes after rhs, equal timestamps are ordered by stream ID
+  bool operator() (const detector &lhs, const detector &rhs) const {
+    if(lhs.TS != rhs.TS)
+      return lhs.TS > rhs.TS;
+    return lhs.ID > rhs.ID;
+  }
+};
+
+/*!
+  A priority queue of the heads of the input streams for a k-way timestamp merge.
+  Each stream has at most one entry, so pushing and popping is O(log k) and, once the number of streams is set, does not allocate.
+*/
+class TSQueue {
+public:
+  //! default constructor
+  TSQueue(){};
+  //! reserve space for n input streams
+  void SetNStreams(unsigned int n){fheap.reserve(n);}
+  //! add the head of a stream
+  void Push(unsigned long long int ts, int id){
+    detector det;
+    det.TS = ts;
+    det.ID = id;
+    fheap.push_back(det);
+    push_heap(fheap.begin(), fheap.end(), TSComparer());
+  }
+  //! the earliest head
+  const detector& Top() const {return fheap.front();}
+  //! remove the earliest head
+  void Pop(){
+    pop_heap(fheap.begin(), fheap.end(), TSComparer());
+    fheap.pop_back();
+  }
+  //! number of streams with a head in the queue
+  unsigned int Size() const {return fheap.size();}
+  //! no more heads
+  bool Empty() const {return fheap.empty();}
+  //! remove all heads
+  void Clear(){fheap.clear();}
+  //! Printing information
+  void Print() const {
+    for(vector<detector>::const_iterator det=fheap.begin(); det!=fheap.end(); det++){
+      cout << "ID = " << det->ID << ", TS = " << det->TS << endl;
+    }
+  }
+private:
+  //! binary heap of the stream heads, earliest first
+  vector<detector> fheap;
+};
+
+/*!
+  Reasons for closing an event
+*/
+enum closeReason{
+  //! a second BigRIPS entry arrived
+  kCloseBigRIPS = 0,
+  //! the next entry is outside of the window
+  kCloseWindow = 1,
+  //! end of the data or of the range
+  kCloseEnd = 2,
+  //! number of reasons
+  kNCLOSE = 3
+};
+
+/*!
+  A range of entries of the input trees, e.g. one time slice
+*/
+struct eventrange{
+  //! first entry of each stream, see streamID
+  unsigned int first[kNSTREAMS];
+  //! entry after the last one of each stream
+  unsigned int end[kNSTREAMS];
+  //! timestamp of the first entry of the range, 0 for the beginning of the data
+  unsigned long long int startTS;
+};
+
 /*!
   A class for building BigRIPS and WASABI combined events
 */
 class BuildEvents {
 public:
   //! Default constructor
-  BuildEvents(){};
+  BuildEvents(){fprefetch = 0; fBRreader = NULL; fWAreader = NULL; fEUreader = NULL; fprescanned = false; fdryrun = false;};
+  //! Destructor, stops the reader threads
+  ~BuildEvents();
   //! Initialize trees
   void Init(TTree* brtr, TTree* watr, TTree* eutr);
+  //! Set the number of entries to be read ahead in background threads, 0 reads in the main thread
+  void SetPrefetch(int prefetch){fprefetch = prefetch;};
   //! Set the window for event building
   void SetWindow(unsigned long long int window){fwindow = window;};
   //! Set coincidence mode
@@ -48,8 +137,16 @@ public:
   bool ReadBigRIPS();
   //! Read one entry from the EURICA tree
   bool ReadEURICA();
-  //! Read one entry from each tree
+  //! Read one entry from each tree, starts the background readers on the current range
   bool ReadEach();
+  //! Pre-scan the timestamps, afterwards only entries of written events are read
+  void PreScan();
+  //! Find the timestamp resets and pair the segments of the trees
+  vector<eventrange> Segments();
+  //! Split the data into time slices that can be merged independently
+  vector<eventrange> TimeSlices(unsigned int nslices);
+  //! Restrict the event building to a range of entries
+  void SetRange(eventrange range);
   
   
   //! Merge the data streams
@@ -58,11 +155,34 @@ public:
   //! Set the last event
   int GetNEvents(){return fWAentries + fBRentries + fEUentries;};
   //! Close the event and write to tree
-  void CloseEvent();
+  void CloseEvent(int reason = kCloseEnd);
+  //! Reset the event building statistics
+  void ResetStatistics();
+  //! Print the event building statistics and write them to the current directory
+  void WriteStatistics(const char* name = "buildstatistics");
   //! Get the merged tree
   TTree* GetTree(){return fmtr;};
+  //! Get the number of bytes read from all trees
+  unsigned long long int GetBytesRead(){return fnbytes[kBigRIPS] + fnbytes[kWASABI] + fnbytes[kEURICA];};
+  //! Get the number of merge steps
+  unsigned long long int GetMergeSteps(){return fnsteps;};
   
 private:
+  //! Reset to the first entries
+  void Rewind();
+  //! Read the timestamps of all entries
+  void ReadTimestamps();
+  //! Point the branches of the input trees to the local copies
+  void SetBranchAddresses();
+  //! Create and start the background readers
+  void StartReaders();
+  //! Delete the background readers and restore the branch addresses
+  void DeleteReaders();
+  //! Read an entry and measure the time needed
+  Int_t TimedGetEvent(TTree* tr, unsigned int entry, int id);
+  //! Add a merged entry to the statistics
+  void AddToStatistics(int id, unsigned long long int ts);
+
   //! BigRIPS input tree
   TTree* fBRtr;
   //! WASABI input tree
@@ -80,14 +200,40 @@ private:
   //! hasEU
   bool fhasEU;
   
-  //! list of detector hits
-  vector<detector*> fdetectors;
+  //! heads of the input streams, ordered in time
+  TSQueue fdetectors;
 
   //! number of events to be read
   int flastevent;
 
-  //! number of bytes read
-  int fnbytes;
+  //! number of bytes read per stream
+  unsigned long long int fnbytes[kNSTREAMS];
+  //! number of entries read completely per stream
+  unsigned long long int fnread[kNSTREAMS];
+  //! number of entries merged per stream
+  unsigned long long int fnmerged[kNSTREAMS];
+  //! time spent in TTree::GetEvent per stream, in s
+  double freadtime[kNSTREAMS];
+  //! number of merge steps
+  unsigned long long int fnsteps;
+  //! time of the first merge step
+  chrono::steady_clock::time_point fstart;
+  //! number of closed events per reason, see closeReason
+  unsigned long long int fnclosed[kNCLOSE];
+  //! number of written events
+  unsigned long long int fnwritten;
+  //! timestamp of the last merged entry per stream, 0 if none
+  unsigned long long int flastmergedts[kNSTREAMS];
+  //! number of entries in the current event
+  unsigned int fevententries;
+  //! timestamp of the first entry in the current event
+  unsigned long long int feventfirstts;
+  //! timestamp differences between the streams WASABI-BigRIPS, EURICA-BigRIPS, EURICA-WASABI
+  TH1F* fTSdiff[3];
+  //! number of entries per event
+  TH1F* fevententriesh;
+  //! time between the first and last entry of an event
+  TH1F* feventspanh;
   //! current timestamp
   unsigned long long int fcurrentts;
   //! last read BigRIPS timestamp
@@ -145,6 +291,12 @@ private:
   unsigned int fWAentry;
   //! current eurica entry
   unsigned int fEUentry;
+  //! bigrips entry after the last one to be read
+  unsigned int fBRend;
+  //! wasabi entry after the last one to be read
+  unsigned int fWAend;
+  //! eurica entry after the last one to be read
+  unsigned int fEUend;
 
   //! eurica event info
   TClonesArray *fEUeventinfo;
@@ -157,17 +309,41 @@ private:
   unsigned long long fwindow;
   //! modus for writing the merged data: 0 all, 1 only isomer (BR and WA)
   int fmode;
+
+  //! the timestamps of all entries have been read
+  bool ftsread;
+  //! the timestamps have been pre-scanned, entries which are not needed are not read
+  bool fprescanned;
+  //! merging on the timestamps only, to find the needed entries
+  bool fdryrun;
+  //! timestamps of all BigRIPS entries
+  vector<unsigned long long int> fBRTS;
+  //! timestamps of all WASABI entries
+  vector<unsigned long long int> fWATS;
+  //! timestamps of all EURICA entries
+  vector<unsigned long long int> fEUTS;
+  //! BigRIPS entries which are part of a written event
+  vector<bool> fBRneeded;
+  //! WASABI entries which are part of a written event
+  vector<bool> fWAneeded;
+  //! EURICA entries which are part of a written event
+  vector<bool> fEUneeded;
+  //! BigRIPS entry in the current event, -1 if none
+  int fBRevent;
+  //! WASABI entry in the current event, -1 if none
+  int fWAevent;
+  //! EURICA entries in the current event
+  vector<unsigned int> fEUevent;
+
+  //! number of entries read ahead per input stream
+  int fprefetch;
+  //! background reader for the BigRIPS tree
+  StreamReader* fBRreader;
+  //! background reader for the WASABI tree
+  StreamReader* fWAreader;
+  //! background reader for the EURICA tree
+  StreamReader* fEUreader;
   
 };
 
-/*!
-  A class for sorting the detectors in time
-*/
-class TSComparer {
-public:
-  //! comparator
-  bool operator() ( detector *lhs, detector *rhs) {
-    return (*rhs).TS > (*lhs).TS;
-  }
-};
 #endif
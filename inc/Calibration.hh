@@ -2,25 +2,54 @@
 #define __CALIBRATION_HH
 #include <iostream>
 #include <iomanip>
-#include "TRandom.h"
+#include <cstdlib>
+#include "Philox.hh"
 
 #include "WASABI.hh"
 #include "WASABISettings.hh"
 #include "WASABIdefs.h"
+#include "ParameterBundle.hh"
+
+/*!
+  Mapping and calibration of one ADC channel, combined from the mapping, thresholds, calibration and settings.
+  Each record fills one cache line, so a channel is read with a single line fill.
+*/
+struct __attribute__((aligned(64))) adcchannel{
+  //! energy gain, not calibrated if <= 0
+  double gain;
+  //! energy offset
+  double offset;
+  //! veto energy, not used if <= 0
+  double veto;
+  //! low energy threshold, not used if <= 0
+  double low;
+  //! DSSSD number, -1 if the channel is not mapped
+  short dsssd;
+  //! strip number, counted on each side
+  short strip;
+  //! ADC threshold
+  short thresh;
+  //! side, 0 for X, 1 for Y strips
+  char side;
+};
+
 /*!
   A class for calibration of WASABI data, includes mapping and correlation of time and energy information
 */
 class Calibration {
 public:
   //! default constructor
-  Calibration(){};
+  Calibration(){fentry = 0; fADCtable = NULL;};
   //! constructor
   Calibration(char* settings);
-  //! dummy destructor
+  //! destructor, frees the ADC channel table
   ~Calibration(){
+    free(fADCtable);
   };
   //! access the settings
   WASABISettings* GetSettings(){return fset;}
+  //! set the seed of the random generator
+  void SetSeed(unsigned long long int seed){fRand.SetSeed(seed);}
   //! Read in the ADC mapping
   void ReadADCMap(char* mapfile);
   //! Read in the TDC mapping
@@ -29,16 +58,28 @@ public:
   void ReadADCThresholds(char* threshfile);
   //! Read in the energy calibration
   void ReadCalibration(char* adccalfile ,char* tdccalfile);
+  //! Combine mapping, thresholds, and calibration into the ADC channel table
+  void BuildADCTable();
+  //! Read the mapping, thresholds, and calibration from the compiled parameter bundle
+  bool ReadBundle(char* settings);
+  //! Check the mapping and calibration and compile them into a parameter bundle
+  void WriteBundle(char* settings);
   //! apply mapping and calibration
   WASABI* BuildWASABI(WASABIRaw *raw);
+  //! apply mapping and calibration, filling an existing event
+  void BuildWASABI(WASABIRaw *raw, WASABI* event);
+  //! apply mapping and calibration to entry number entry, filling an existing event
+  void BuildWASABI(WASABIRaw *raw, WASABI* event, unsigned long long int entry);
   //! sort the hits by energy, high to low
   vector<WASABIHit*> Sort(vector<WASABIHit*> hits);
   //! sort the hits by energy, low to high
   vector<WASABIHit*> Revert(vector<WASABIHit*> hits);
    
 private:
-  //! radom generator for smearing ADC values
-  TRandom* fRand;
+  //! random generator for smearing ADC and TDC values, keyed on entry, channel and hit
+  Philox fRand;
+  //! entry number used by BuildWASABI if none is given
+  unsigned long long int fentry;
   //! settings for calibration
   WASABISettings* fset;
   
@@ -67,5 +108,13 @@ private:
   //! time offsets Y strips
   double fToffsetY[NDSSSD][NYSTRIPS];
 
+  //! table of the ADC channels by index, walked for every event, cache line aligned
+  adcchannel* fADCtable;
+
+  //! not copyable, the ADC channel table is owned
+  Calibration(const Calibration&);
+  //! not assignable, the ADC channel table is owned
+  Calibration& operator=(const Calibration&);
+
 };
 #endif
@@ -163,18 +163,38 @@ public:
   DALI(){
     Clear();
   }
-  //! Clear the music information
+  //! destructor
+  ~DALI(){
+    Clear();
+    for(vector<DALIHit*>::iterator hit=fpool.begin(); hit!=fpool.end(); hit++)
+      delete *hit;
+  }
+  //! Clear the DALI information, up to NDALIPOOL hits are kept for reuse
   void Clear(Option_t *option = ""){
     fmult = 0;
+    Recycle(fhits);
+    ClearAddback();
+  }
+  //! Clear the addback information
+  void ClearAddback(Option_t *option = ""){
     fmultAB = 0;
-    for(vector<DALIHit*>::iterator hit=fhits.begin(); hit!=fhits.end(); hit++){
-      delete *hit;
-    }
-    fhits.clear();
-    for(vector<DALIHit*>::iterator hitab=fhitsAB.begin(); hitab!=fhitsAB.end(); hitab++){
-      delete *hitab;
-    }
-    fhitsAB.clear();
+    Recycle(fhitsAB);
+  }
+  //! Get a copy of a hit from the pool of cleared hits
+  DALIHit* NewHit(DALIHit* orig){
+    if(fpool.empty())
+      return new DALIHit(*orig);
+    DALIHit* hit = fpool.back();
+    fpool.pop_back();
+    *hit = *orig;
+    return hit;
+  }
+  //! Return a hit that is no longer part of the event to the pool
+  void Recycle(DALIHit* hit){
+    if(fpool.size()<NDALIPOOL)
+      fpool.push_back(hit);
+    else
+      delete hit;
   }
   //! Add a hit
   void AddHit(DALIHit* hit){
@@ -187,12 +207,12 @@ public:
     fmultAB++;
   }
   //! Set all hits
-  void SetHits(vector<DALIHit*> hits){
+  void SetHits(const vector<DALIHit*>& hits){
     fmult = hits.size();
     fhits = hits;
   }
   //! Set all hits after addback
-  void SetABHits(vector<DALIHit*> hits){
+  void SetABHits(const vector<DALIHit*>& hits){
     fmultAB = hits.size();
     fhitsAB = hits;
   }
@@ -217,13 +237,13 @@ public:
   //! Returns the multiplicity of the event
   unsigned short GetMult(){return fmult;}
   //! Returns the whole vector of hits
-  vector<DALIHit*> GetHits(){return fhits;}
+  const vector<DALIHit*>& GetHits(){return fhits;}
   //! Returns the hit number n
   DALIHit* GetHit(unsigned short n){return fhits.at(n);}
   //! Returns the multiplicity of the event after addback
   int GetMultAB(){return fmultAB;}
   //! Returns the whole vector of hits after addback
-  vector<DALIHit*> GetHitsAB(){return fhitsAB;}
+  const vector<DALIHit*>& GetHitsAB(){return fhitsAB;}
   //! Returns the hit number n after addback
   DALIHit* GetHitAB(int n){return fhitsAB.at(n);}
 
@@ -247,6 +267,15 @@ protected:
   unsigned short fmultAB;
   //! vector with the hits after addback
   vector<DALIHit*> fhitsAB;
+  //! cleared hits for reuse
+  vector<DALIHit*> fpool; //!
+
+  //! move the hits into the pool, hits beyond NDALIPOOL are deleted
+  void Recycle(vector<DALIHit*>& hits){
+    for(vector<DALIHit*>::iterator hit=hits.begin(); hit!=hits.end(); hit++)
+      Recycle(*hit);
+    hits.clear();
+  }
 
   /// \cond CLASSIMP
   ClassDef(DALI,1);
@@ -1 +1,2 @@
 #define MAXNCRYSTAL 600
+#define NDALIPOOL 256
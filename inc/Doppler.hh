@@ -0,0 +1,44 @@
+#ifndef __DOPPLER_HH
+#define __DOPPLER_HH
+#include <iostream>
+#include <vector>
+
+#include "DALIdefs.h"
+using namespace std;
+
+/*!
+  Doppler correction for batches of DALI hits, given as arrays of crystal IDs, energies, and beta or reaction points.
+  The crystal positions are fixed, their cos(theta) is computed once. The geometry is gathered per block of hits, the correction loops have no lookups, so that the compiler can vectorize them (Doppler.o is compiled with -fno-math-errno for the sqrt). The crystal IDs must be checked by the caller.
+*/
+class Doppler {
+public:
+  //! default constructor
+  Doppler();
+  //! set the average positions of the crystals
+  void SetGeometry(const vector<vector<double> >& positions);
+  //! set the coefficients of beta as a function of the reaction point, second order polynomial
+  void SetBetaParameters(double p0, double p1, double p2){
+    fbetapar[0] = p0;
+    fbetapar[1] = p1;
+    fbetapar[2] = p2;
+  }
+  //! beta at the reaction point z
+  double Beta(double z) const {return fbetapar[0] + z*(fbetapar[1] + z*fbetapar[2]);}
+  //! cos(theta) of the crystal position
+  double CosTheta(short id) const {return fcostheta[id];}
+  //! Doppler correct n hits, each with its own beta
+  void Correct(unsigned int n, const short* id, const double* en, const double* beta, double* dcen) const;
+  //! Doppler correct n hits, each with its own reaction point, beta from the polynomial
+  void CorrectVertex(unsigned int n, const short* id, const double* en, const double* zreac, double* dcen) const;
+
+private:
+  //! x*x+y*y of the average positions
+  double fperp2[MAXNCRYSTAL];
+  //! z of the average positions
+  double fz[MAXNCRYSTAL];
+  //! cos(theta) of the average positions
+  double fcostheta[MAXNCRYSTAL];
+  //! coefficients of beta(z)
+  double fbetapar[3];
+};
+#endif
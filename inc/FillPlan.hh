@@ -0,0 +1,141 @@
+#ifndef __FILLPLAN_HH
+#define __FILLPLAN_HH
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cfloat>
+
+#include "HistogramRegistry.hh"
+using namespace std;
+
+/*!
+  An axis of the histograms of a fill plan, the bins are computed once per row for all histograms sharing the axis
+*/
+struct planaxis{
+  //! the variable
+  int var;
+  //! number of bins
+  int nbins;
+  //! lower edge
+  double low;
+  //! upper edge
+  double up;
+};
+
+/*!
+  The kinds of gates of a fill plan
+*/
+enum gateKind{
+  //! low <= value < up
+  kWithin = 0,
+  //! value > low
+  kAbove = 1
+};
+
+/*!
+  A gate of a family, the row is used if low <= value < up, or value > low for gates of kind kAbove
+*/
+struct plangate{
+  //! the variable
+  int var;
+  //! the kind, see gateKind
+  int kind;
+  //! lower limit
+  double low;
+  //! upper limit, excluded
+  double up;
+};
+
+/*!
+  A split of a family, histogram first+v-1 is filled for value v of the variable
+*/
+struct plansplit{
+  //! the variable
+  int var;
+  //! index of the histogram for value 1
+  int first;
+  //! number of histograms, larger values go into the last
+  int n;
+};
+
+/*!
+  A family of histograms of the same variables.
+  The first histogram is filled for all rows, and for each split the histogram selected by the value of its variable.
+*/
+struct planfamily{
+  //! the histograms, inclusive first
+  vector<LazyHistogram*> hists;
+  //! x axis of each histogram
+  vector<int> xaxis;
+  //! y axis of each histogram, -1 for 1D
+  vector<int> yaxis;
+  //! the splits
+  vector<plansplit> splits;
+  //! the gates
+  vector<plangate> gates;
+};
+
+/*!
+  A table of histogram families filled from rows of variables, e.g. one row per hit or pair of hits.
+  The rows of an event are collected with Set and Next, Fill computes the bin of each axis once per row and increments the bins of the histograms directly.
+  A family which is also filled for each multiplicity, and its gated variant, are each one line instead of a block of Fill calls.
+*/
+class FillPlan {
+public:
+  //! constructor, the histograms are booked in the registry
+  FillPlan(HistogramRegistry* hreg);
+  //! declare a variable of the rows, returns its index
+  int Variable(const char* name);
+  //! add a family with a 1D histogram of variable x, returns its index
+  int H1(const char* name, int x, int nbinsx, double xlow, double xup);
+  //! add a family with a 2D histogram of variables x and y, returns its index
+  int H2(const char* name, int x, int nbinsx, double xlow, double xup, int y, int nbinsy, double ylow, double yup);
+  //! split a family by the value of var, one histogram for each value from 1 to nsplit-1, larger values go into the last. A family can be split by several variables.
+  void Split(int family, int var, int nsplit, const char* format);
+  //! split a 2D family with a different binning for the split histograms
+  void Split(int family, int var, int nsplit, const char* format, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup);
+  //! fill the family only for rows with low <= var < up
+  void Gate(int family, int var, double low, double up);
+  //! fill the family only for rows with var >= low
+  void Gate(int family, int var, double low){Gate(family, var, low, DBL_MAX);}
+  //! fill the family only for rows with var > low
+  void GateAbove(int family, int var, double low);
+  //! set a variable of the current row, it keeps its value for the following rows until it is set again
+  void Set(int var, double value){fcurrent[var] = value;}
+  //! add the current row
+  void Next(){
+    for(unsigned int v=0; v<fcurrent.size(); v++)
+      fcolumns[v].push_back(fcurrent[v]);
+    fnrows++;
+  }
+  //! number of rows collected
+  unsigned int GetNRows(){return fnrows;}
+  //! fill the rows into the histograms and clear them
+  void Fill();
+  //! print the variables and families
+  void Print();
+
+private:
+  //! index of the axis with this binning, it is added if it does not exist
+  int Axis(int var, int nbins, double low, double up);
+  //! increment histogram h of a family with row r
+  void Increment(planfamily& fam, int h, unsigned int r);
+
+  //! the registry
+  HistogramRegistry* freg;
+  //! names of the variables
+  vector<string> fnames;
+  //! the current row
+  vector<double> fcurrent;
+  //! the values of each variable for all rows
+  vector<vector<double> > fcolumns;
+  //! number of rows
+  unsigned int fnrows;
+  //! the axes
+  vector<planaxis> faxes;
+  //! the bin of each axis for all rows
+  vector<vector<int> > fbins;
+  //! the families
+  vector<planfamily> ffamilies;
+};
+#endif
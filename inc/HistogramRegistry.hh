@@ -0,0 +1,155 @@
+#ifndef __HISTOGRAMREGISTRY_HH
+#define __HISTOGRAMREGISTRY_HH
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "TH1F.h"
+#include "TH2F.h"
+#include "THnSparse.h"
+using namespace std;
+
+/*!
+  A 1D or 2D histogram that is only allocated when it is filled for the first time.
+  2D histograms can be kept in sparse storage, they are converted into TH2F when they are written.
+*/
+class LazyHistogram {
+public:
+  //! constructor for a 1D histogram
+  LazyHistogram(const char* name, const char* title, int nbinsx, double xlow, double xup);
+  //! constructor for a 2D histogram
+  LazyHistogram(const char* name, const char* title, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup, bool sparse = false);
+  //! destructor
+  ~LazyHistogram();
+  //! fill a 1D histogram
+  void Fill(double x){
+    if(fh1==NULL)
+      Create();
+    fh1->Fill(x);
+  }
+  //! fill a 2D histogram, or a 1D histogram with weight y as for TH1
+  void Fill(double x, double y){
+    if(fh1==NULL && fh2==NULL && fsparse==NULL)
+      Create();
+    if(fh2!=NULL)
+      fh2->Fill(x,y);
+    else if(fsparse!=NULL){
+      double v[2] = {x,y};
+      fsparse->Fill(v);
+    }
+    else
+      fh1->Fill(x,y);
+  }
+  //! increment bin (binx,biny) of the values x and y by one, the statistics are accumulated as in Fill
+  void Increment(int binx, int biny, double x, double y){
+    if(fbins==NULL){
+      if(!IsCreated())
+	Create();
+      if(fbins==NULL){
+	if(fdim==1)
+	  Fill(x);
+	else
+	  Fill(x,y);
+	return;
+      }
+    }
+    fbins[binx + fstride*biny]++;
+    fentries++;
+    //as in TH1::Fill the under- and overflows are not included in the statistics
+    if(binx<1 || binx>fnbins[0] || (fdim==2 && (biny<1 || biny>fnbins[1])))
+      return;
+    fstats[0]++;
+    fstats[1]++;
+    fstats[2] += x;
+    fstats[3] += x*x;
+    if(fdim==2){
+      fstats[4] += y;
+      fstats[5] += y*y;
+      fstats[6] += x*y;
+    }
+  }
+  //! true if the histogram was filled
+  bool IsCreated(){return fh1!=NULL || fh2!=NULL || fsparse!=NULL;}
+  //! name
+  const char* GetName(){return fname.c_str();}
+  //! family, the name with the numbers replaced by #
+  const char* GetFamily(){return ffamily.c_str();}
+  //! number of entries, 0 if not created
+  double GetEntries();
+  //! memory of the bins if the histogram were allocated as TH1F or TH2F
+  long long int GetDenseMemory();
+  //! memory of the bins as allocated
+  long long int GetMemory();
+  //! add another histogram with the same binning
+  void Add(LazyHistogram* other);
+  //! write into the current directory if there are entries, sparse histograms are converted into TH2F
+  void Write();
+
+private:
+  //! allocate the histogram
+  void Create();
+  //! add the statistics of the increments to the histogram
+  void Flush();
+
+  //! name
+  string fname;
+  //! title
+  string ftitle;
+  //! family
+  string ffamily;
+  //! number of dimensions
+  int fdim;
+  //! number of bins
+  int fnbins[2];
+  //! lower edges
+  double flow[2];
+  //! upper edges
+  double fup[2];
+  //! use sparse storage
+  bool fsparseflag;
+  //! the 1D histogram
+  TH1F* fh1;
+  //! the 2D histogram
+  TH2F* fh2;
+  //! the sparse 2D histogram
+  THnSparseF* fsparse;
+  //! the bin contents of the dense histogram, NULL if it can not be incremented directly
+  float* fbins;
+  //! number of cells along x, including under- and overflow
+  int fstride;
+  //! entries of the increments not yet added to the histogram
+  long long int fentries;
+  //! sum of weights, weights squared, x, x squared, y, y squared, and xy of the increments
+  double fstats[7];
+};
+
+/*!
+  Booking of the histograms of an analysis. The histograms are created on their first fill, only filled ones are written.
+*/
+class HistogramRegistry {
+public:
+  //! constructor
+  HistogramRegistry();
+  //! destructor
+  ~HistogramRegistry();
+  //! 2D histograms with more bins are kept in sparse storage, 0 for none
+  void SetSparseThreshold(long long int nbins){fsparsethresh = nbins;}
+  //! book a 1D histogram
+  LazyHistogram* H1(const char* name, const char* title, int nbinsx, double xlow, double xup);
+  //! book a 2D histogram
+  LazyHistogram* H2(const char* name, const char* title, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup);
+  //! add the histograms of another registry with the same booking
+  void Add(HistogramRegistry* other);
+  //! write the filled histograms into the current directory
+  void Write();
+  //! print the number of histograms and the memory for each family
+  void MemoryReport(bool perfamily = true);
+
+private:
+  //! the histograms in the order of booking
+  vector<LazyHistogram*> fhists;
+  //! 2D histograms with more bins are sparse
+  long long int fsparsethresh;
+};
+#endif
@@ -0,0 +1,72 @@
+#ifndef __PARAMETERBUNDLE_HH
+#define __PARAMETERBUNDLE_HH
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+/*!
+  A source file a bundle was compiled from
+*/
+struct bundlesource{
+  //! file name
+  string name;
+  //! modification time when the bundle was written
+  long long int mtime;
+  //! size when the bundle was written
+  long long int size;
+  //! hash of the content
+  unsigned long long int hash;
+};
+
+/*!
+  A binary file with named arrays of parameters, compiled from text settings files.
+  The bundle records its source files, it is only used as long as none of them has changed.
+  Reading maps the file into memory, there is no parsing of the text files.
+*/
+class ParameterBundle {
+public:
+  //! constructor
+  ParameterBundle(string filename);
+  //! destructor, unmaps the file
+  ~ParameterBundle();
+  //! map the bundle file, true if it is valid and all sources are unchanged
+  bool Load();
+  //! add a source file, recorded when the bundle is written
+  void AddSource(const char* filename);
+  //! store an array to be written
+  void Set(const char* name, const double* values, unsigned int n);
+  //! store an array to be written
+  void Set(const char* name, const vector<double>& values){Set(name, values.data(), values.size());}
+  //! number of values of a loaded array, 0 if not present
+  unsigned int GetSize(const char* name);
+  //! copy a loaded array, false if it is not present or has a different size
+  bool Get(const char* name, double* values, unsigned int n);
+  //! write the bundle file
+  bool Write();
+  //! name of the bundle file
+  const char* GetFileName(){return ffilename.c_str();}
+  //! hash of the content of a file
+  static unsigned long long int Hash(const char* filename);
+
+private:
+  //! release the mapped file
+  void Unmap();
+
+  //! name of the bundle file
+  string ffilename;
+  //! source files
+  vector<bundlesource> fsources;
+  //! arrays to be written
+  map<string, vector<double> > farrays;
+  //! the mapped file
+  char* fmap;
+  //! size of the mapped file
+  long long int fmapsize;
+  //! position and number of values of each array in the mapped file
+  map<string, pair<long long int, unsigned int> > findex;
+};
+
+#endif
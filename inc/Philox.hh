@@ -0,0 +1,66 @@
+#ifndef __PHILOX_HH
+#define __PHILOX_HH
+
+/*!
+  A counter-based random generator, Philox4x32-10 (Salmon et al., SC11).
+  The random numbers are a function of the key and a counter only, there is no state that changes between calls.
+  Identical counters give identical numbers, independent of the order of the calls or the thread they are made in.
+*/
+class Philox {
+public:
+  //! default constructor
+  Philox(){SetSeed(0);}
+  //! constructor
+  Philox(unsigned long long int seed){SetSeed(seed);}
+  //! set the key
+  void SetSeed(unsigned long long int seed){
+    fkey[0] = seed & 0xffffffffULL;
+    fkey[1] = seed >> 32;
+  }
+  //! encrypt the counter into four random words
+  void Generate(const unsigned int counter[4], unsigned int out[4]) const {
+    unsigned int ctr[4] = {counter[0], counter[1], counter[2], counter[3]};
+    unsigned int key[2] = {fkey[0], fkey[1]};
+    for(int r=0; r<10; r++){
+      unsigned long long int p0 = 0xD2511F53ULL * ctr[0];
+      unsigned long long int p1 = 0xCD9E8D57ULL * ctr[2];
+      unsigned int next[4];
+      next[0] = (unsigned int)(p1 >> 32) ^ ctr[1] ^ key[0];
+      next[1] = (unsigned int)p1;
+      next[2] = (unsigned int)(p0 >> 32) ^ ctr[3] ^ key[1];
+      next[3] = (unsigned int)p0;
+      for(int i=0; i<4; i++)
+	ctr[i] = next[i];
+      key[0] += 0x9E3779B9U;
+      key[1] += 0xBB67AE85U;
+    }
+    for(int i=0; i<4; i++)
+      out[i] = ctr[i];
+  }
+  //! uniform random number in (0,1) for hit number hit of a channel in an event
+  double Uniform(unsigned long long int event, unsigned int channel, unsigned int hit) const {
+    double u;
+    Uniform(event, channel, hit, 1, &u);
+    return u;
+  }
+  //! n uniform random numbers in (0,1) for the hits first to first+n-1 of a channel in an event
+  void Uniform(unsigned long long int event, unsigned int channel, unsigned int first, unsigned int n, double* out) const {
+    unsigned int counter[4] = {(unsigned int)(event & 0xffffffffULL), (unsigned int)(event >> 32), channel, 0};
+    unsigned int words[4];
+    unsigned int block = 0xffffffffU;
+    for(unsigned int i=0; i<n; i++){
+      //each block of the counter gives four numbers
+      if((first+i)/4 != block){
+	block = (first+i)/4;
+	counter[3] = block;
+	Generate(counter, words);
+      }
+      out[i] = (words[(first+i)%4] + 0.5) * (1./4294967296.);
+    }
+  }
+private:
+  //! key
+  unsigned int fkey[2];
+};
+
+#endif
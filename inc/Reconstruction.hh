@@ -2,6 +2,7 @@
 #define __RECONSTRUCTION_HH
 #include <iostream>
 #include <iomanip>
+#include <bitset>
 
 #include "TGraph.h"
 #include "TF1.h"
@@ -9,6 +10,8 @@
 #include "DALIdefs.h"
 #include "DALI.hh"
 #include "PPAC.hh"
+#include "ParameterBundle.hh"
+#include "Doppler.hh"
 /*!
   A class for reconstruction of DALI data, includes Doppler correction and add-back
 */
@@ -31,6 +34,14 @@ public:
   void ReadReCalParams(const char *infile);
   //! read the average positions within the crystals
   void ReadPositions(const char *infile);
+  //! read the bad channels, positions, and recalibration from the compiled parameter bundle
+  bool ReadBundle(char* settings);
+  //! compile the bad channels, positions, and recalibration into a parameter bundle
+  void WriteBundle(char* settings);
+  //! precompute the Doppler kernel geometry and the addback neighbours from the positions
+  void BuildGeometry();
+  //! true if two crystals are close enough to be added back
+  bool Neighbours(short id0, short id1){return fneighbours[id0][id1];}
   //! recalibrate dali
   void ReCalibrate(vector<DALIHit*> dali);
   //! sort by energy highest first
@@ -45,14 +56,16 @@ public:
   vector<DALIHit*> TimingGate(vector<DALIHit*> hits);
   //! set the positions
   void SetPositions(DALI* dali);
+  //! filter, gate, optionally recalibrate, set the positions, sort, and add back in one pass
+  void Process(DALI* dali, bool recalibrate);
   //! apply the Doppler correction
   void DopplerCorrect(DALI* dali);
   //! apply the Doppler correction with a certain reaction point
   double DopplerCorrect(DALI* dali, double zreac);
   //! check the positions of two hits and decide if they are added back
   bool Addback(DALIHit* hit0, DALIHit* hit1);
-  //! do the adding back
-  vector<DALIHit*> Addback(vector<DALIHit*> dali);
+  //! do the adding back, the addback hits are taken from the pool of the DALI object
+  void Addback(DALI* dali);
   //! calculate the PPAC position
   TVector3 PPACPosition(SinglePPAC* pina, SinglePPAC* pinb);
   //! Align the PPAC3 after the target
@@ -79,9 +92,58 @@ private:
   vector<vector<double> > fpositions;
   //! which detectors are bad and should be excluded
   vector<unsigned short> fbad;
+  //! bad detectors flagged by ID
+  bitset<MAXNCRYSTAL> fbadch;
+  //! hits kept by Process, reused between events
+  vector<DALIHit*> fkept;
+  //! hits in the order of decreasing energy, filled by Cluster
+  vector<unsigned short> forder;
+  //! addback cluster of each hit, filled by Cluster
+  vector<short> fcluster;
+  //! seed hit of each cluster, filled by Cluster
+  vector<unsigned short> fseeds;
+  //! hits whose neighbours remain to be checked, used by Cluster
+  vector<unsigned short> fstack;
+  //! addback hits, reused between events
+  vector<DALIHit*> fhitsAB;
+
+  //! group the hits into addback clusters
+  void Cluster(const vector<DALIHit*>& hits);
+  //! copy the IDs and energies of the hits and addback hits into the batch
+  void FillBatch(DALI* dali);
+  //! copy the Doppler corrected energies from the batch to the hits and addback hits
+  void ReadBatch(DALI* dali);
   //! recalibration parameters
   vector<vector<double> > frecal;
+  //! Doppler correction with the crystal geometry and beta(z)
+  Doppler fdoppler;
+  //! crystal IDs of the hits of an event, batch for the Doppler kernel
+  vector<short> fbatchid;
+  //! energies of the hits of an event, batch for the Doppler kernel
+  vector<double> fbatchen;
+  //! beta or reaction point of the hits of an event, batch for the Doppler kernel
+  vector<double> fbatchpar;
+  //! Doppler corrected energies of the hits of an event
+  vector<double> fbatchdc;
+  //! for each crystal the crystals within the addback distance or angle
+  vector<bitset<MAXNCRYSTAL> > fneighbours;
   //! function to reconstruct beta from MINOS position
   TF1* fminos;
 };
+
+/*!
+  Compare two hits given by their positions in a vector by their energies
+*/
+class IndexComparer {
+public:
+  //! constructor
+  IndexComparer(const vector<DALIHit*>& hits) : fhits(hits){}
+  //! compares energies of the hits
+  bool operator() (unsigned short lhs, unsigned short rhs) {
+    return fhits[lhs]->GetEnergy() > fhits[rhs]->GetEnergy();
+  }
+private:
+  //! the hits
+  const vector<DALIHit*>& fhits;
+};
 #endif
@@ -0,0 +1,132 @@
+#ifndef __STREAMREADER_HH
+#define __STREAMREADER_HH
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "TTree.h"
+#include "TClonesArray.h"
+#include "TArtEventInfo.hh"
+#include "TArtGeCluster.hh"
+
+#include "Beam.hh"
+#include "FocalPlane.hh"
+#include "WASABI.hh"
+#include "EURICA.hh"
+#include "Globaldefs.h"
+
+/*!
+  IDs of the input streams for the event building
+*/
+enum streamID{
+  //! BigRIPS
+  kBigRIPS = 0,
+  //! WASABI
+  kWASABI = 1,
+  //! EURICA
+  kEURICA = 2,
+  //! number of input streams
+  kNSTREAMS = 3
+};
+
+/*!
+  One decoded entry of an input stream
+*/
+struct streamentry{
+  //! entry number in the input tree
+  unsigned int entry;
+  //! return value of TTree::GetEvent
+  Int_t status;
+  //! timestamp
+  unsigned long long int TS;
+  //! bigrips data
+  Beam* beam;
+  //! bigrips focal plane information
+  FocalPlane* fp[NFPLANES];
+  //! wasabi data
+  WASABI* wasabi;
+  //! eurica data
+  EURICA* eurica;
+};
+
+/*!
+  A class reading one input tree of the event building in a background thread.
+  The entries are decoded ahead into a bounded ring buffer, the consumer takes them in order with Peek and Pop.
+*/
+class StreamReader {
+public:
+  //! constructor
+  StreamReader(TTree* tr, int type, unsigned int depth);
+  //! destructor, stops the reader thread
+  ~StreamReader();
+  //! start the reader thread for the entries from first to end (excluded)
+  void Start(unsigned int first, unsigned int end);
+  //! stop the reader thread
+  void Stop();
+  //! wait for the next decoded entry
+  streamentry* Peek();
+  //! release the entry returned by Peek
+  void Pop();
+  //! time spent in TTree::GetEvent by the reader thread, in s
+  double GetReadTime();
+
+  //! convert the EURICA clusters into hits
+  static void AddEURICAHits(EURICA* eurica, TClonesArray* cluster, TClonesArray* clusterAB, unsigned long long int ts, unsigned int entry, int verbose);
+
+private:
+  //! loop of the reader thread
+  void Run();
+  //! read one entry into a slot of the ring buffer
+  void Decode(streamentry* slot, unsigned int entry);
+
+  //! input tree
+  TTree* ftr;
+  //! type of the stream, see streamID
+  int ftype;
+  //! number of entries in the tree
+  unsigned int fentries;
+  //! first entry to be read
+  unsigned int ffirst;
+  //! entry after the last one to be read
+  unsigned int fend;
+
+  //! ring buffer of decoded entries
+  vector<streamentry> fring;
+  //! position of the oldest decoded entry
+  unsigned int fhead;
+  //! number of decoded entries waiting
+  unsigned int fcount;
+  //! request to stop the thread
+  bool fstop;
+  //! the thread has reached the end of the tree or a faulty entry
+  bool fdone;
+  //! time spent in TTree::GetEvent, in s
+  double freadtime;
+
+  //! the reader thread
+  std::thread fthread;
+  //! protects the ring buffer
+  std::mutex fmutex;
+  //! signalled when an entry was decoded
+  std::condition_variable fnotempty;
+  //! signalled when a slot was released
+  std::condition_variable fnotfull;
+
+  //! branch buffer for the timestamp
+  unsigned long long int fTS;
+  //! branch buffer for the bigrips data
+  Beam* fbeam;
+  //! branch buffer for the bigrips focal plane information
+  FocalPlane* ffp[NFPLANES];
+  //! branch buffer for the wasabi data
+  WASABI* fwasabi;
+  //! eurica event info
+  TClonesArray *fEUeventinfo;
+  //! eurica data
+  TClonesArray *fEUcluster;
+  //! eurica AB data
+  TClonesArray *fEUclusterAB;
+};
+#endif
@@ -10,6 +10,17 @@
 #include "WASABIdefs.h"
 using namespace std;
 class WASABIHitComparer;
+class WASABIHit;
+/*!
+  Compare two clusters by their highest energy, high to low
+*/
+class ClusterComparer {
+public:
+  //! compares the highest energies
+  bool operator() (const pair<double,WASABIHit*>& lhs, const pair<double,WASABIHit*>& rhs) const {
+    return lhs.first > rhs.first;
+  }
+};
 
 /*!
   Container for the WASABI Raw ADC information
@@ -26,6 +37,12 @@ public:
     fch = ch;
     fval = val;
   }
+  //! Set all ADC information at once
+  void Set(short adc, short ch, short val){
+    fadc = adc;
+    fch = ch;
+    fval = val;
+  }
   //! Clear the ADC information
   void Clear(Option_t *option = ""){
     fadc = sqrt(-1.);
@@ -79,6 +96,13 @@ public:
     fch = ch;
     fval.push_back(val);
   }
+  //! Set the channel with a first time, the storage of the values is kept
+  void Set(short tdc, short ch, short val){
+    ftdc = tdc;
+    fch = ch;
+    fval.clear();
+    fval.push_back(val);
+  }
   //! add time to a channel
   void AddRawTDC(short val){
     fval.push_back(val);
@@ -105,7 +129,7 @@ public:
   //! Get the TDC channel
   short GetChan(){ return fch;}
   //! Get the TDC values
-  vector<short> GetVal(){ return fval;}
+  const vector<short>& GetVal(){ return fval;}
   //! Get a TDC value
   short GetVal(short n){ return fval.at(n);}
   
@@ -128,36 +152,92 @@ class WASABIRaw : public TObject {
 public:
   //! default constructor
   WASABIRaw(){
+    ftdcindexed = false;
     Clear();
   }
-  //! Clear the WASABI raw information
+  //! destructor
+  ~WASABIRaw(){
+    Clear();
+    for(vector<WASABIRawADC*>::iterator adc=fADCpool.begin(); adc!=fADCpool.end(); adc++)
+      delete *adc;
+    for(vector<WASABIRawTDC*>::iterator tdc=fTDCpool.begin(); tdc!=fTDCpool.end(); tdc++)
+      delete *tdc;
+  }
+  //! Clear the WASABI raw information, up to NWASABIPOOL adcs and tdcs are kept for reuse
   void Clear(Option_t *option = ""){
     fADCmult = 0;
     for(vector<WASABIRawADC*>::iterator adc=fadcs.begin(); adc!=fadcs.end(); adc++){
-      delete *adc;
+      if(fADCpool.size()<NWASABIPOOL)
+	fADCpool.push_back(*adc);
+      else
+	delete *adc;
     }
     fadcs.clear();
     fTDCmult = 0;
+    if(!ftdcindexed){
+      for(int i=0; i<NTDCS*NTDCCH; i++)
+	ftdcslot[i] = -1;
+    }
     for(vector<WASABIRawTDC*>::iterator tdc=ftdcs.begin(); tdc!=ftdcs.end(); tdc++){
-      delete *tdc;
+      short slot = Slot((*tdc)->GetTDC(), (*tdc)->GetChan());
+      if(slot>-1)
+	ftdcslot[slot] = -1;
+      if(fTDCpool.size()<NWASABIPOOL)
+	fTDCpool.push_back(*tdc);
+      else
+	delete *tdc;
     }
     ftdcs.clear();
+    ftdcindexed = true;
   }
   //! Add an adc
   void AddADC(WASABIRawADC* adc){
     fadcs.push_back(adc);
     fADCmult++;
   }
-  //! Add a tdc
+  //! Add a tdc, if the channel is already present only the value is added and tdc is recycled
   void AddTDC(WASABIRawTDC* tdc){
-    for(vector<WASABIRawTDC*>::iterator stored=ftdcs.begin(); stored!=ftdcs.end(); stored++){
-      if(tdc->GetTDC() == (*stored)->GetTDC() && tdc->GetChan() == (*stored)->GetChan()){
-	(*stored)->AddRawTDC(tdc->GetVal(0));
-	return;
-      }
+    WASABIRawTDC* stored = FindTDC(tdc->GetTDC(), tdc->GetChan());
+    if(stored!=NULL){
+      stored->AddRawTDC(tdc->GetVal(0));
+      if(fTDCpool.size()<NWASABIPOOL)
+	fTDCpool.push_back(tdc);
+      else
+	delete tdc;
+      return;
     }
-    ftdcs.push_back(tdc);
-    fTDCmult++;
+    InsertTDC(tdc);
+  }
+  //! Add an adc, reusing a cleared one if available
+  void AddADC(short adc, short ch, short val){
+    WASABIRawADC* stored;
+    if(fADCpool.empty()){
+      stored = new WASABIRawADC(adc,ch,val);
+    }
+    else{
+      stored = fADCpool.back();
+      fADCpool.pop_back();
+      stored->Set(adc,ch,val);
+    }
+    fadcs.push_back(stored);
+    fADCmult++;
+  }
+  //! Add a tdc value, reusing a cleared tdc if the channel is new
+  void AddTDC(short tdc, short ch, short val){
+    WASABIRawTDC* stored = FindTDC(tdc, ch);
+    if(stored!=NULL){
+      stored->AddRawTDC(val);
+      return;
+    }
+    if(fTDCpool.empty()){
+      stored = new WASABIRawTDC(tdc,ch,val);
+    }
+    else{
+      stored = fTDCpool.back();
+      fTDCpool.pop_back();
+      stored->Set(tdc,ch,val);
+    }
+    InsertTDC(stored);
   }
   
   //! Set all adcs
@@ -168,7 +248,7 @@ public:
   //! Returns the ADCmultiplicity of the event
   unsigned short GetADCmult(){return fADCmult;}
   //! Returns the whole vector of adcs
-  vector<WASABIRawADC*> GetADCs(){return fadcs;}
+  const vector<WASABIRawADC*>& GetADCs(){return fadcs;}
   //! Returns the adc number n
   WASABIRawADC* GetADC(unsigned short n){return fadcs.at(n);}
   
@@ -176,23 +256,21 @@ public:
   void SetTDCs(vector<WASABIRawTDC*> tdcs){
     fTDCmult = tdcs.size();
     ftdcs = tdcs;
+    ftdcindexed = false;
   }
   //! Returns the TDCmultiplicity of the event
   unsigned short GetTDCmult(){return fTDCmult;}
   //! Returns the whole vector of tdcs
-  vector<WASABIRawTDC*> GetTDCs(){return ftdcs;}
+  const vector<WASABIRawTDC*>& GetTDCs(){return ftdcs;}
   //! Returns the tdc number n
   // param n the number of the TDC hit
   WASABIRawTDC* GetTDC(unsigned short n){return ftdcs.at(n);}
-  //! Returns the hit in TDC module tdc and channel ch
+  //! Returns the hit in TDC module tdc and channel ch, NULL if there is none
   WASABIRawTDC* GetTDC(short tdc, short ch){
-    for(vector<WASABIRawTDC*>::iterator stored=ftdcs.begin(); stored!=ftdcs.end(); stored++){
-      if(tdc == (*stored)->GetTDC() && ch == (*stored)->GetChan()){
-	return (*stored);
-      }
-    }
-    cout << "warning TDC " << tdc << " channel " << ch << " not found!" << endl;
-    return new WASABIRawTDC();
+    WASABIRawTDC* stored = FindTDC(tdc, ch);
+    if(stored==NULL)
+      cout << "warning TDC " << tdc << " channel " << ch << " not found!" << endl;
+    return stored;
   }
   
   //! Printing information
@@ -214,6 +292,63 @@ protected:
   unsigned short fTDCmult;
   //! vector with the tdcs
   vector<WASABIRawTDC*> ftdcs;
+  //! cleared adcs for reuse
+  vector<WASABIRawADC*> fADCpool; //!
+  //! cleared tdcs for reuse
+  vector<WASABIRawTDC*> fTDCpool; //!
+  //! position in ftdcs of each TDC channel, -1 if the channel has no hit
+  short ftdcslot[NTDCS*NTDCCH]; //!
+  //! ftdcslot is up to date
+  bool ftdcindexed; //!
+
+  //! slot of a TDC channel in ftdcslot, -1 if out of range
+  short Slot(short tdc, short ch){
+    if(tdc<0 || tdc>=NTDCS || ch<0 || ch>=NTDCCH)
+      return -1;
+    return tdc*NTDCCH + ch;
+  }
+  //! rebuild ftdcslot from the vector of tdcs
+  void IndexTDCs(){
+    for(int i=0; i<NTDCS*NTDCCH; i++)
+      ftdcslot[i] = -1;
+    for(unsigned short i=0; i<ftdcs.size(); i++){
+      short slot = Slot(ftdcs[i]->GetTDC(), ftdcs[i]->GetChan());
+      if(slot>-1 && ftdcslot[slot]<0)
+	ftdcslot[slot] = i;
+    }
+    ftdcindexed = true;
+  }
+  //! the stored hit of a TDC channel, NULL if there is none
+  WASABIRawTDC* FindTDC(short tdc, short ch){
+    short slot = Slot(tdc, ch);
+    if(slot<0){
+      //channels outside of the table are not indexed
+      for(vector<WASABIRawTDC*>::iterator stored=ftdcs.begin(); stored!=ftdcs.end(); stored++){
+	if(tdc == (*stored)->GetTDC() && ch == (*stored)->GetChan())
+	  return (*stored);
+      }
+      return NULL;
+    }
+    if(!ftdcindexed)
+      IndexTDCs();
+    if(ftdcslot[slot]<0)
+      return NULL;
+    return ftdcs[ftdcslot[slot]];
+  }
+  //! append the hit of a new TDC channel
+  void InsertTDC(WASABIRawTDC* tdc){
+    short slot = Slot(tdc->GetTDC(), tdc->GetChan());
+    if(ftdcindexed && slot>-1)
+      ftdcslot[slot] = ftdcs.size();
+    ftdcs.push_back(tdc);
+    fTDCmult++;
+  }
+
+private:
+  //! not copyable, the ADCs and TDCs in the pools are owned
+  WASABIRaw(const WASABIRaw&);
+  //! not assignable, the ADCs and TDCs in the pools are owned
+  WASABIRaw& operator=(const WASABIRaw&);
 
   /// \cond CLASSIMP
   ClassDef(WASABIRaw,1);
@@ -238,6 +373,14 @@ public:
     ftime.clear();
     fhitsadded = 1;
   }
+  //! Set strip, energy and calibration flag, the storage of the time values is kept
+  void Set(short strip, double en, bool iscal){
+    fstrip = strip;
+    fen = en;
+    fiscal = iscal;
+    ftime.clear();
+    fhitsadded = 1;
+  }
   //! Clear the ADC information
   void Clear(Option_t *option = ""){
     fstrip = sqrt(-1.);
@@ -257,7 +400,7 @@ public:
   //! Get the energy
   double GetEn(){ return fen;}
   //! Get the time values
-  vector<double> GetTime(){ return ftime;}
+  const vector<double>& GetTime(){ return ftime;}
   //! Get the first time value
   double GetTime0(){
     if(ftime.size()>0)
@@ -266,6 +409,8 @@ public:
   }
   //! Get the number of hits that were added back to create one hit
   unsigned short GetHitsAdded(){return fhitsadded;}
+  //! Set the number of hits that were added back to create one hit
+  void SetHitsAdded(unsigned short hitsadded){fhitsadded = hitsadded;}
   //! Is is calibrated
   bool IsCal(){return fiscal;}
   //! Printing information 
@@ -325,59 +470,90 @@ public:
     fdsssd = dsssdnr;
     Clear();
   }
-  //! Clear the DSSSD information
+  //! destructor
+  ~DSSSD(){
+    Clear();
+    for(vector<WASABIHit*>::iterator hit=fpool.begin(); hit!=fpool.end(); hit++)
+      delete *hit;
+  }
+  //! Clear the DSSSD information, up to NWASABIPOOL hits are kept for reuse
   void Clear(Option_t *option = ""){
     fmultX = 0;
     fvetoX = false;
-    for(vector<WASABIHit*>::iterator hit=fhitsX.begin(); hit!=fhitsX.end(); hit++){
-      delete *hit;
-    }
-    fhitsX.clear();
+    Recycle(fhitsX);
     fimplantX = -1;
     
     fmultY = 0;
     fvetoY = false;
-    for(vector<WASABIHit*>::iterator hit=fhitsY.begin(); hit!=fhitsY.end(); hit++){
-      delete *hit;
-    }
-    fhitsY.clear();
+    Recycle(fhitsY);
     fimplantY = -1;
 
-    fmultABX = 0;
-    for(vector<WASABIHit*>::iterator hit=fhitsABX.begin(); hit!=fhitsABX.end(); hit++){
-      delete *hit;
-    }
-    fhitsABX.clear();
-    
-    fmultABY = 0;
-    for(vector<WASABIHit*>::iterator hit=fhitsABY.begin(); hit!=fhitsABY.end(); hit++){
-      delete *hit;
-    }
-    fhitsABY.clear();
+    for(short i=0; i<NXSTRIPS; i++)
+      fstripX[i] = -1;
+    for(short i=0; i<NYSTRIPS; i++)
+      fstripY[i] = -1;
+    fnextX.clear();
+    fnextY.clear();
+    fstripindexed = true;
+
+    ClearAddback();
   }
   //! Clear the addback  information
   void ClearAddback(Option_t *option = ""){
     fmultABX = 0;
-    for(vector<WASABIHit*>::iterator hit=fhitsABX.begin(); hit!=fhitsABX.end(); hit++){
-      delete *hit;
-    }
-    fhitsABX.clear();
-    
+    Recycle(fhitsABX);
     fmultABY = 0;
-    for(vector<WASABIHit*>::iterator hit=fhitsABY.begin(); hit!=fhitsABY.end(); hit++){
-      delete *hit;
-    }
-    fhitsABY.clear();
+    Recycle(fhitsABY);
+  }
+  //! Get a hit from the pool of cleared hits, or a new one if the pool is empty
+  WASABIHit* NewHit(short strip, double en, bool iscal){
+    if(fpool.empty())
+      return new WASABIHit(strip,en,iscal);
+    WASABIHit* hit = fpool.back();
+    fpool.pop_back();
+    hit->Set(strip,en,iscal);
+    return hit;
+  }
+  //! Get a copy of a hit from the pool of cleared hits
+  WASABIHit* NewHit(WASABIHit* orig){
+    if(fpool.empty())
+      return new WASABIHit(*orig);
+    WASABIHit* hit = fpool.back();
+    fpool.pop_back();
+    *hit = *orig;
+    return hit;
+  }
+  //! Exchange the contents with another DSSSD, the hits change owner without being copied
+  void Swap(DSSSD* other){
+    swap(fdsssd, other->fdsssd);
+    swap(fmultX, other->fmultX);
+    fhitsX.swap(other->fhitsX);
+    swap(fmultY, other->fmultY);
+    fhitsY.swap(other->fhitsY);
+    swap(fmultABX, other->fmultABX);
+    fhitsABX.swap(other->fhitsABX);
+    swap(fmultABY, other->fmultABY);
+    fhitsABY.swap(other->fhitsABY);
+    swap(fvetoX, other->fvetoX);
+    swap(fvetoY, other->fvetoY);
+    swap(fimplantX, other->fimplantX);
+    swap(fimplantY, other->fimplantY);
+    fstripindexed = false;
+    other->fstripindexed = false;
   }
   //! setting the dsssd number
   void SetDSSSD(short dsssd){fdsssd = dsssd;}
   //! Add a hit in X
   void AddHitX(WASABIHit* hit){
+    if(fstripindexed)
+      LinkStrip(fstripX, NXSTRIPS, fnextX, hit->GetStrip(), fhitsX.size());
     fhitsX.push_back(hit);
     fmultX++;
   }
   //! Add a hit in Y
   void AddHitY(WASABIHit* hit){
+    if(fstripindexed)
+      LinkStrip(fstripY, NYSTRIPS, fnextY, hit->GetStrip(), fhitsY.size());
     fhitsY.push_back(hit);
     fmultY++;
   }
@@ -386,11 +562,13 @@ public:
   void SetHitsX(vector<WASABIHit*> hits){
     fhitsX = hits;
     fmultX = hits.size();
+    fstripindexed = false;
   }
   //! Set hits in Y
   void SetHitsY(vector<WASABIHit*> hits){
     fhitsY = hits;
     fmultY = hits.size();
+    fstripindexed = false;
   }
   //! Set a veto on X
   void SetVetoX(){fvetoX = true;}
@@ -421,29 +599,30 @@ public:
   vector<WASABIHit*> GetHitsX(){return fhitsX;}
   //! Returns the X hit number n
   WASABIHit* GetHitX(unsigned short n){return fhitsX.at(n);}
-  //! Returns the hit at strip number
+  //! Returns the first hit at strip number, an empty hit if there is none
   WASABIHit* GetStripHitX(short s){
-    if(s<0 || s > NXSTRIPS){
+    if(s<0 || s >= NXSTRIPS){
       cout << "looking for X strip number " << s <<", not found!" << endl;
-      return new WASABIHit();
+      return NoHit();
     }
-    for(vector<WASABIHit*>::iterator hit=fhitsX.begin(); hit!=fhitsX.end(); hit++){
-      if((*hit)->GetStrip() ==s)
-	return (*hit);
+    if(!fstripindexed)
+      IndexStrips();
+    if(fstripX[s]<0){
+      cout << "looking for X strip number " << s <<", not found!" << endl;
+      return NoHit();
     }
-    cout << "looking for X strip number " << s <<", not found!" << endl;
-    return new WASABIHit();    
+    return fhitsX[fstripX[s]];
   }
-  //! Add the timing information to strip s
+  //! Add the timing information to all hits of strip s
   void SetStripTimeX(short s, double timeval){
-    if(s<0 || s > NXSTRIPS){
+    if(s<0 || s >= NXSTRIPS){
       cout << "looking for X strip number " << s <<", not found!" << endl;
       return;
     }
-    for(vector<WASABIHit*>::iterator hit=fhitsX.begin(); hit!=fhitsX.end(); hit++){
-      if((*hit)->GetStrip() ==s)
-	(*hit)->SetTime(timeval);
-    }
+    if(!fstripindexed)
+      IndexStrips();
+    for(short i=fstripX[s]; i>-1; i=fnextX[i])
+      fhitsX[i]->SetTime(timeval);
     //cout << "looking for X strip number " << s <<", not found!" << endl;
     return;    
   }
@@ -454,18 +633,18 @@ public:
   vector<WASABIHit*> GetHitsABX(){return fhitsABX;}
   //! Returns the addback X hit number n
   WASABIHit* GetHitABX(unsigned short n){return fhitsABX.at(n);}
-  //! Returns the addback hit at strip number
+  //! Returns the addback hit at strip number, an empty hit if there is none
   WASABIHit* GetStripHitABX(short s){
-    if(s<0 || s > NXSTRIPS){
+    if(s<0 || s >= NXSTRIPS){
       cout << "looking for addback X strip number " << s <<", not found!" << endl;
-      return new WASABIHit();
+      return NoHit();
     }
     for(vector<WASABIHit*>::iterator hit=fhitsABX.begin(); hit!=fhitsABX.end(); hit++){
       if((*hit)->GetStrip() ==s)
 	return (*hit);
     }
     cout << "looking for addback X strip number " << s <<", not found!" << endl;
-    return new WASABIHit();    
+    return NoHit();
   }
   
   //! Returns the Y multiplicity of the event
@@ -474,29 +653,30 @@ public:
   vector<WASABIHit*> GetHitsY(){return fhitsY;}
   //! Returns the Y hit number n
   WASABIHit* GetHitY(unsigned short n){return fhitsY.at(n);}
-  //! Returns the hit at strip number
+  //! Returns the first hit at strip number, an empty hit if there is none
   WASABIHit* GetStripHitY(short s){
-    if(s<0 || s > NYSTRIPS){
+    if(s<0 || s >= NYSTRIPS){
       cout << "looking for Y strip number " << s <<", not found!" << endl;
-      return new WASABIHit();
+      return NoHit();
     }
-    for(vector<WASABIHit*>::iterator hit=fhitsY.begin(); hit!=fhitsY.end(); hit++){
-      if((*hit)->GetStrip() ==s)
-	return (*hit);
+    if(!fstripindexed)
+      IndexStrips();
+    if(fstripY[s]<0){
+      cout << "looking for Y strip number " << s <<", not found!" << endl;
+      return NoHit();
     }
-    cout << "looking for Y strip number " << s <<", not found!" << endl;
-    return new WASABIHit();    
+    return fhitsY[fstripY[s]];
   }
-  //! Add the timing information to strip s
+  //! Add the timing information to all hits of strip s
   void SetStripTimeY(short s, double timeval){
-    if(s<0 || s > NYSTRIPS){
+    if(s<0 || s >= NYSTRIPS){
       cout << "looking for Y strip number " << s <<", not found!" << endl;
       return;
     }
-    for(vector<WASABIHit*>::iterator hit=fhitsY.begin(); hit!=fhitsY.end(); hit++){
-      if((*hit)->GetStrip() ==s)
-	(*hit)->SetTime(timeval);
-    }
+    if(!fstripindexed)
+      IndexStrips();
+    for(short i=fstripY[s]; i>-1; i=fnextY[i])
+      fhitsY[i]->SetTime(timeval);
     //cout << "looking for Y strip number " << s <<", not found!" << endl;
     return;    
   }
@@ -507,18 +687,18 @@ public:
   vector<WASABIHit*> GetHitsABY(){return fhitsABY;}
   //! Returns the addback Y hit number n
   WASABIHit* GetHitABY(unsigned short n){return fhitsABY.at(n);}
-  //! Returns the addback hit at strip number
+  //! Returns the addback hit at strip number, an empty hit if there is none
   WASABIHit* GetStripHitABY(short s){
-    if(s<0 || s > NYSTRIPS){
+    if(s<0 || s >= NYSTRIPS){
       cout << "looking for addback Y strip number " << s <<", not found!" << endl;
-      return new WASABIHit();
+      return NoHit();
     }
     for(vector<WASABIHit*>::iterator hit=fhitsABY.begin(); hit!=fhitsABY.end(); hit++){
       if((*hit)->GetStrip() ==s)
 	return (*hit);
     }
     cout << "looking for addback Y strip number " << s <<", not found!" << endl;
-    return new WASABIHit();    
+    return NoHit();
   }
   
 
@@ -526,10 +706,10 @@ public:
 
   //! sort the hits by energy, high to low
   vector<WASABIHit*> Sort(vector<WASABIHit*> hits);
-  //! sort the hits by energy, low to high
-  vector<WASABIHit*> Revert(vector<WASABIHit*> hits);
   //! addback
   void Addback();
+  //! find the clusters of neighboring strips
+  void Cluster(const vector<WASABIHit*>& hits, short nstrips);
   //! check if addback
   bool Addback(WASABIHit* hit0, WASABIHit* hit1);
   
@@ -591,6 +771,76 @@ protected:
   int fimplantX;
   //! implantation point Y
   int fimplantY;
+  //! cleared hits for reuse
+  vector<WASABIHit*> fpool; //!
+  //! position in fhitsX of the first hit of each X strip, -1 if none
+  short fstripX[NXSTRIPS]; //!
+  //! position in fhitsY of the first hit of each Y strip, -1 if none
+  short fstripY[NYSTRIPS]; //!
+  //! position in fhitsX of the next hit in the same X strip, -1 ends the list of a strip
+  vector<short> fnextX; //!
+  //! position in fhitsY of the next hit in the same Y strip, -1 ends the list of a strip
+  vector<short> fnextY; //!
+  //! fstripX, fstripY, fnextX, and fnextY are up to date
+  bool fstripindexed; //!
+  //! empty hit returned for strips without hits
+  WASABIHit fnohit; //!
+  //! next hit in the same strip, used by Cluster
+  vector<short> fnexthit; //!
+  //! highest energy and addback hit of each cluster, filled by Cluster
+  vector<pair<double,WASABIHit*> > fclusters; //!
+
+  //! rebuild the strip index from the hit vectors
+  void IndexStrips(){
+    for(short i=0; i<NXSTRIPS; i++)
+      fstripX[i] = -1;
+    for(short i=0; i<NYSTRIPS; i++)
+      fstripY[i] = -1;
+    fnextX.clear();
+    fnextY.clear();
+    for(unsigned short i=0; i<fhitsX.size(); i++)
+      LinkStrip(fstripX, NXSTRIPS, fnextX, fhitsX[i]->GetStrip(), i);
+    for(unsigned short i=0; i<fhitsY.size(); i++)
+      LinkStrip(fstripY, NYSTRIPS, fnextY, fhitsY[i]->GetStrip(), i);
+    fstripindexed = true;
+  }
+  //! append hit i of strip s to the end of the list of its strip
+  void LinkStrip(short* first, short nstrips, vector<short>& next, short s, short i){
+    next.resize(i+1);
+    next[i] = -1;
+    if(s<0 || s>=nstrips)
+      return;
+    if(first[s]<0){
+      first[s] = i;
+      return;
+    }
+    short j = first[s];
+    while(next[j]>-1)
+      j = next[j];
+    next[j] = i;
+  }
+  //! the empty hit for strips without hits, cleared before it is returned
+  WASABIHit* NoHit(){
+    fnohit.Clear();
+    return &fnohit;
+  }
+
+  //! move the hits into the pool, hits beyond NWASABIPOOL are deleted
+  void Recycle(vector<WASABIHit*>& hits){
+    for(vector<WASABIHit*>::iterator hit=hits.begin(); hit!=hits.end(); hit++){
+      if(fpool.size()<NWASABIPOOL)
+	fpool.push_back(*hit);
+      else
+	delete *hit;
+    }
+    hits.clear();
+  }
+
+private:
+  //! not copyable, the hits and the pool are owned
+  DSSSD(const DSSSD&);
+  //! not assignable, the hits and the pool are owned
+  DSSSD& operator=(const DSSSD&);
 
   /// \cond CLASSIMP
   ClassDef(DSSSD,1);
@@ -608,6 +858,11 @@ public:
       fdsssd[i] = new DSSSD(i);    
     //Clear();
   }
+  //! destructor
+  ~WASABI(){
+    for(int i=0; i<NDSSSD; i++)
+      delete fdsssd[i];
+  }
   //! Clear the wasabi information
   void Clear(Option_t *option = ""){
     for(int i=0; i<NDSSSD; i++){
@@ -615,6 +870,11 @@ public:
       fdsssd[i]->SetDSSSD(i);
     }
   }
+  //! Exchange the contents with another WASABI, the DSSSD objects themselves stay in place
+  void Swap(WASABI* other){
+    for(int i=0; i<NDSSSD; i++)
+      fdsssd[i]->Swap(other->fdsssd[i]);
+  }
   //! return the DSSSD information
   DSSSD* GetDSSSD(int i){return fdsssd[i];}
   //! printing information
@@ -625,11 +885,133 @@ public:
 protected:
   //! sub DSSSD
   DSSSD* fdsssd[NDSSSD];
+private:
+  //! not copyable, the DSSSDs are owned
+  WASABI(const WASABI&);
+  //! not assignable, the DSSSDs are owned
+  WASABI& operator=(const WASABI&);
+
   /// \cond CLASSIMP
   ClassDef(WASABI,1);
   /// \endcond
 };
 
+/*!
+  The hit vectors of a DSSSD, as stored in WASABIColumns
+*/
+enum hitSide{
+  //! X strips
+  kSideX = 0,
+  //! Y strips
+  kSideY = 1,
+  //! X strips after addback
+  kSideABX = 2,
+  //! Y strips after addback
+  kSideABY = 3,
+  //! number of hit vectors per DSSSD
+  kNSIDES = 4
+};
+
+/*!
+  Columnar storage of the WASABI information.
+  All hits of an event are kept in flat arrays, one entry per hit, ordered by DSSSD and side, see hitSide.
+  The time values of all hits are in one array, each hit has an offset and a number of values.
+  When written with splitting each array goes into its own basket.
+*/
+class WASABIColumns : public TObject {
+public:
+  //! default constructor
+  WASABIColumns(){
+    Clear();
+  }
+  //! Clear the columns, the storage is kept
+  void Clear(Option_t *option = "");
+  //! Fill the columns from a WASABI event
+  void Set(WASABI* wasabi);
+  //! Fill a WASABI event from the columns
+  void Get(WASABI* wasabi);
+
+  //! Number of hits in the event, all DSSSDs and sides
+  unsigned int GetNHits(){return fstrip.size();}
+  //! First hit of a DSSSD and side
+  unsigned int GetFirst(short dsssd, short side){return ffirst[dsssd*kNSIDES+side];}
+  //! Entry after the last hit of a DSSSD and side
+  unsigned int GetEnd(short dsssd, short side){return ffirst[dsssd*kNSIDES+side+1];}
+  //! DSSSD of hit i
+  short GetDSSSD(unsigned int i){return fdsssdnr[i];}
+  //! side of hit i, see hitSide
+  short GetSide(unsigned int i){return fside[i];}
+  //! strip of hit i
+  short GetStrip(unsigned int i){return fstrip[i];}
+  //! energy of hit i
+  double GetEn(unsigned int i){return fen[i];}
+  //! hit i is calibrated
+  bool IsCal(unsigned int i){return fiscal[i];}
+  //! number of hits added back to create hit i
+  unsigned short GetHitsAdded(unsigned int i){return fhitsadded[i];}
+  //! first time value of hit i, NaN if there is none
+  double GetTime0(unsigned int i){return ftime0[i];}
+  //! number of time values of hit i
+  unsigned short GetNTimes(unsigned int i){return fntimes[i];}
+  //! time value n of hit i
+  double GetTime(unsigned int i, unsigned short n){return ftimes[ftimeoffset[i]+n];}
+
+  //! DSSSD d is vetoed in X
+  bool IsVetoX(short d){return fvetoX[d];}
+  //! DSSSD d is vetoed in Y
+  bool IsVetoY(short d){return fvetoY[d];}
+  //! Implantation X of DSSSD d
+  int ImplantX(short d){return fimplantX[d];}
+  //! Implantation Y of DSSSD d
+  int ImplantY(short d){return fimplantY[d];}
+
+  //! Printing information
+  void Print(Option_t *option = "") const {
+    for(unsigned int i=0;i<fstrip.size();i++){
+      cout << "DSSSD " << fdsssdnr[i] << "\tside " << fside[i] << "\tstrip " << fstrip[i] << "\ten " << fen[i] << "\ttime0 " << ftime0[i] << "\ttimes " << fntimes[i] << "\thits added " << fhitsadded[i] << endl;
+    }
+  }
+
+protected:
+  //! add the hits of one vector of a DSSSD
+  void AddHits(DSSSD* dsssd, short side);
+
+  //! first hit of each DSSSD and side, the last element is the number of hits
+  unsigned int ffirst[NDSSSD*kNSIDES+1];
+  //! veto in X per DSSSD
+  bool fvetoX[NDSSSD];
+  //! veto in Y per DSSSD
+  bool fvetoY[NDSSSD];
+  //! implantation point X per DSSSD
+  int fimplantX[NDSSSD];
+  //! implantation point Y per DSSSD
+  int fimplantY[NDSSSD];
+  //! DSSSD number per hit
+  vector<short> fdsssdnr;
+  //! side per hit, see hitSide
+  vector<short> fside;
+  //! strip number per hit
+  vector<short> fstrip;
+  //! energy per hit
+  vector<double> fen;
+  //! calibrated flag per hit
+  vector<bool> fiscal;
+  //! number of hits added back per hit
+  vector<unsigned short> fhitsadded;
+  //! first time value per hit
+  vector<double> ftime0;
+  //! number of time values per hit
+  vector<unsigned short> fntimes;
+  //! position of the first time value of each hit in ftimes
+  vector<unsigned int> ftimeoffset;
+  //! time values of all hits
+  vector<double> ftimes;
+
+  /// \cond CLASSIMP
+  ClassDef(WASABIColumns,1);
+  /// \endcond
+};
+
 /*!
   Compare two hits by their energies
 */
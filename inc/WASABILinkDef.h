@@ -5,7 +5,10 @@
 #pragma link C++ class WASABIRawADC+;
 #pragma link C++ class WASABIRawTDC+;
 #pragma link C++ class WASABIRaw+;
+#pragma read sourceClass="WASABIRaw" targetClass="WASABIRaw" version="[1-]" source="" target="ftdcindexed" code="{ ftdcindexed = false; }"
 #pragma link C++ class WASABIHit+;
 #pragma link C++ class DSSSD+;
+#pragma read sourceClass="DSSSD" targetClass="DSSSD" version="[1-]" source="" target="fstripindexed" code="{ fstripindexed = false; }"
 #pragma link C++ class WASABI+;
+#pragma link C++ class WASABIColumns+;
 #endif
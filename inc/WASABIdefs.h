@@ -9,3 +9,5 @@
 #define NDSSSD  3
 #define NXSTRIPS 60
 #define NYSTRIPS 40
+
+#define NWASABIPOOL 256
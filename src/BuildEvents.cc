@@ -1,6 +1,13 @@
 #include "BuildEvents.hh"
 using namespace std;
 
+/*!
+  Destructor, stops the background readers
+*/
+BuildEvents::~BuildEvents(){
+  DeleteReaders();
+}
+
 /*!
   Initialyze the event building
   \param brtr tree with input bigrips data
@@ -30,7 +37,6 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
   fBRentry = 0;
   fWAentry = 0;
   fEUentry = 0;
-  fnbytes = 0;
 
   fBRts = 0;
   fbeam = new Beam;
@@ -56,25 +62,16 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
   flocalEUts = 0;
   flocaleurica = new EURICA;
 
+  SetBranchAddresses();
   if(fhasBR){
-    fBRtr->SetBranchAddress("timestamp",&flocalBRts);
-    fBRtr->SetBranchAddress("beam",&flocalbeam);
-    for(unsigned short f=0;f<NFPLANES;f++){
-      fBRtr->SetBranchAddress(Form("fp%d",fpID[f]),&flocalfp[f]);
-    }
     fBRentries = fBRtr->GetEntries();
     cout << fBRentries << " entries in BigRIPS tree" << endl;
   }
   if(fhasWA){
-    fWAtr->SetBranchAddress("timestamp",&flocalWAts);
-    fWAtr->SetBranchAddress("wasabi",&flocalwasabi);
     fWAentries = fWAtr->GetEntries();
     cout << fWAentries << " entries in WASABI tree" << endl;
   }
   if(fhasEU){
-    fEUtr->SetBranchAddress("EventInfo",&fEUeventinfo);
-    fEUtr->SetBranchAddress("GeCluster",&fEUcluster);
-    fEUtr->SetBranchAddress("GeAddback",&fEUclusterAB);
     fEUentries = fEUtr->GetEntries();
     cout << fEUentries << " entries in EURICA tree" << endl;
   }
@@ -94,6 +91,15 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
   fmtr->Branch("euentry",&fEUentry,320000);
   fmtr->BranchRef();
 
+  //statistics of the event building
+  double range = 10.*max(fwindow, (unsigned long long)1);
+  fTSdiff[0] = new TH1F("hTSdiff_WA_BR","timestamp difference WASABI - BigRIPS",2000,-range,range);
+  fTSdiff[1] = new TH1F("hTSdiff_EU_BR","timestamp difference EURICA - BigRIPS",2000,-range,range);
+  fTSdiff[2] = new TH1F("hTSdiff_EU_WA","timestamp difference EURICA - WASABI",2000,-range,range);
+  fevententriesh = new TH1F("hEventEntries","number of entries per event",50,0,50);
+  feventspanh = new TH1F("hEventSpan","timestamp difference between first and last entry of an event",1000,0,range);
+  ResetStatistics();
+
 
   if(fverbose>-1){
     Int_t status = 0;
@@ -130,6 +136,92 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
       cout << "last EURICA timestamp: " << flocalEUts << endl;
     }
   }
+  fBRend = fBRentries;
+  fWAend = fWAentries;
+  fEUend = fEUentries;
+  ftsread = false;
+  fprescanned = false;
+  fdryrun = false;
+  fdetectors.SetNStreams(kNSTREAMS);
+  Rewind();
+}
+
+/*!
+  Point the branches of the input trees to the local copies
+*/
+void BuildEvents::SetBranchAddresses(){
+  if(fhasBR){
+    fBRtr->SetBranchAddress("timestamp",&flocalBRts);
+    fBRtr->SetBranchAddress("beam",&flocalbeam);
+    for(unsigned short f=0;f<NFPLANES;f++){
+      fBRtr->SetBranchAddress(Form("fp%d",fpID[f]),&flocalfp[f]);
+    }
+  }
+  if(fhasWA){
+    fWAtr->SetBranchAddress("timestamp",&flocalWAts);
+    fWAtr->SetBranchAddress("wasabi",&flocalwasabi);
+  }
+  if(fhasEU){
+    fEUtr->SetBranchAddress("EventInfo",&fEUeventinfo);
+    fEUtr->SetBranchAddress("GeCluster",&fEUcluster);
+    fEUtr->SetBranchAddress("GeAddback",&fEUclusterAB);
+  }
+}
+
+/*!
+  Start the background readers on the current entry ranges. The readers are created at the first call, not in Init, so that the timestamps can be scanned before any reader thread uses the trees.
+  Nothing is read ahead after the pre-scan.
+*/
+void BuildEvents::StartReaders(){
+  if(fprefetch<1 || fprescanned)
+    return;
+  if(fBRreader==NULL && fWAreader==NULL && fEUreader==NULL)
+    cout << "reading " << fprefetch << " entries ahead per input tree" << endl;
+  if(fhasBR){
+    if(fBRreader==NULL)
+      fBRreader = new StreamReader(fBRtr, kBigRIPS, fprefetch);
+    fBRreader->Start(fBRentry, fBRend);
+  }
+  if(fhasWA){
+    if(fWAreader==NULL)
+      fWAreader = new StreamReader(fWAtr, kWASABI, fprefetch);
+    fWAreader->Start(fWAentry, fWAend);
+  }
+  if(fhasEU){
+    if(fEUreader==NULL)
+      fEUreader = new StreamReader(fEUtr, kEURICA, fprefetch);
+    fEUreader->Start(fEUentry, fEUend);
+  }
+}
+
+/*!
+  Delete the background readers. The readers redirect the branch addresses of the trees to their buffers, these are pointed back to the local copies before the buffers are freed.
+*/
+void BuildEvents::DeleteReaders(){
+  if(fBRreader==NULL && fWAreader==NULL && fEUreader==NULL)
+    return;
+  if(fBRreader!=NULL)
+    fBRreader->Stop();
+  if(fWAreader!=NULL)
+    fWAreader->Stop();
+  if(fEUreader!=NULL)
+    fEUreader->Stop();
+  SetBranchAddresses();
+  delete fBRreader;
+  delete fWAreader;
+  delete fEUreader;
+  fBRreader = NULL;
+  fWAreader = NULL;
+  fEUreader = NULL;
+}
+/*!
+  Reset the event building to the first entries of all trees
+*/
+void BuildEvents::Rewind(){
+  fBRentry = 0;
+  fWAentry = 0;
+  fEUentry = 0;
+
   flocalBRts = 0;
   flocalWAts = 0;
   flocalEUts = 0;
@@ -140,6 +232,19 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
   flocalwasabi->Clear();
   flocaleurica->Clear();
 
+  fBRts = 0;
+  fbeam->Clear();
+  for(unsigned short f=0;f<NFPLANES;f++){
+    ffp[f]->Clear();
+  }
+  fWAts = 0;
+  fwasabi->Clear();
+  fEUts = 0;
+  feurica->Clear();
+  fBRevent = -1;
+  fWAevent = -1;
+  fEUevent.clear();
+
   flastBRts = 0;
   flastWAts = 0;
   flastEUts = 0;
@@ -147,7 +252,321 @@ void BuildEvents::Init(TTree* brtr, TTree* watr, TTree* eutr){
   fWAtsjump = false;
   fEUtsjump = false;
 
+  fcurrentts = 0;
+  fdetectors.Clear();
+
+  for(int s=0;s<kNSTREAMS;s++)
+    flastmergedts[s] = 0;
+  fevententries = 0;
+  feventfirstts = 0;
+}
+
+/*!
+  Read an entry of an input tree and measure the time needed
+  \param tr the tree
+  \param entry the entry number
+  \param id the stream, see streamID
+  \return the return value of TTree::GetEvent
+*/
+Int_t BuildEvents::TimedGetEvent(TTree* tr, unsigned int entry, int id){
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Int_t status = tr->GetEvent(entry);
+  freadtime[id] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return status;
+}
+
+/*!
+  Reset the statistics of the event building
+*/
+void BuildEvents::ResetStatistics(){
+  for(int s=0;s<kNSTREAMS;s++){
+    fnbytes[s] = 0;
+    fnread[s] = 0;
+    fnmerged[s] = 0;
+    freadtime[s] = 0;
+  }
+  fnsteps = 0;
+  for(int r=0;r<kNCLOSE;r++)
+    fnclosed[r] = 0;
+  fnwritten = 0;
+  for(int p=0;p<3;p++)
+    fTSdiff[p]->Reset();
+  fevententriesh->Reset();
+  feventspanh->Reset();
 }
+
+/*!
+  Add a merged entry to the statistics
+  \param id the stream, see streamID
+  \param ts the timestamp of the entry
+*/
+void BuildEvents::AddToStatistics(int id, unsigned long long int ts){
+  if(fnsteps==0)
+    fstart = chrono::steady_clock::now();
+  fnsteps++;
+  fnmerged[id]++;
+  //the histograms are indexed by the pairs (1,0), (2,0), (2,1), always showing the later minus the earlier stream
+  for(int o=0;o<kNSTREAMS;o++){
+    if(o==id || flastmergedts[o]==0)
+      continue;
+    long long int diff = (long long int)(ts - flastmergedts[o]);
+    if(id>o)
+      fTSdiff[id+o-1]->Fill(diff);
+    else
+      fTSdiff[id+o-1]->Fill(-diff);
+  }
+  flastmergedts[id] = ts;
+  if(fevententries==0)
+    feventfirstts = ts;
+  fevententries++;
+}
+
+/*!
+  Print the statistics of the event building and write the histograms and a summary to the current directory
+  \param name the name of the summary
+*/
+void BuildEvents::WriteStatistics(const char* name){
+  const char* names[kNSTREAMS] = {"BigRIPS", "WASABI", "EURICA"};
+  StreamReader* readers[kNSTREAMS] = {fBRreader, fWAreader, fEUreader};
+  double elapsed = 0;
+  if(fnsteps>0)
+    elapsed = chrono::duration<double>(chrono::steady_clock::now() - fstart).count();
+  ostringstream summary;
+  summary << "event building statistics" << endl;
+  summary << "window " << fwindow << ", mode " << fmode << endl;
+  for(int s=0;s<kNSTREAMS;s++){
+    double readtime = freadtime[s];
+    if(readers[s]!=NULL)
+      readtime += readers[s]->GetReadTime();
+    summary << names[s] << ": " << fnmerged[s] << " entries merged, " << fnread[s] << " entries read, ";
+    summary << fnbytes[s]/1e6 << " MB read in " << readtime << " s" << endl;
+  }
+  summary << "events closed: " << fnclosed[kCloseBigRIPS] << " by a second BigRIPS entry, ";
+  summary << fnclosed[kCloseWindow] << " larger than window, " << fnclosed[kCloseEnd] << " at the end of the data" << endl;
+  summary << "events written: " << fnwritten << endl;
+  summary << "merge steps: " << fnsteps << " in " << elapsed << " s";
+  if(elapsed>0)
+    summary << ", " << fnsteps/elapsed << " steps/s";
+  summary << endl;
+  cout << endl << summary.str();
+
+  for(int p=0;p<3;p++)
+    fTSdiff[p]->Write("",TObject::kOverwrite);
+  fevententriesh->Write("",TObject::kOverwrite);
+  feventspanh->Write("",TObject::kOverwrite);
+  TObjString text(summary.str().c_str());
+  text.Write(name,TObject::kOverwrite);
+}
+
+/*!
+  Read the timestamps of all entries, only the timestamp branches are read
+*/
+void BuildEvents::ReadTimestamps(){
+  if(ftsread)
+    return;
+  //the timestamps are read into the local copies
+  DeleteReaders();
+  if(fhasBR){
+    TBranch* br = fBRtr->GetBranch("timestamp");
+    fBRTS.resize(fBRentries);
+    for(unsigned int i=0;i<fBRentries;i++){
+      br->GetEntry(i);
+      fBRTS[i] = flocalBRts;
+    }
+    cout << "read " << fBRTS.size() << " BigRIPS timestamps" << endl;
+  }
+  if(fhasWA){
+    TBranch* br = fWAtr->GetBranch("timestamp");
+    fWATS.resize(fWAentries);
+    for(unsigned int i=0;i<fWAentries;i++){
+      br->GetEntry(i);
+      fWATS[i] = flocalWAts;
+    }
+    cout << "read " << fWATS.size() << " WASABI timestamps" << endl;
+  }
+  if(fhasEU){
+    TBranch* br = fEUtr->GetBranch("EventInfo");
+    fEUTS.resize(fEUentries);
+    for(unsigned int i=0;i<fEUentries;i++){
+      br->GetEntry(i);
+      fEUTS[i] = ((TArtEventInfo*) fEUeventinfo->At(0))->GetTimeStamp();
+    }
+    cout << "read " << fEUTS.size() << " EURICA timestamps" << endl;
+  }
+  ftsread = true;
+}
+
+/*!
+  Find the timestamp resets in the input trees. Each tree is divided into segments with increasing timestamps, the segments of the trees are paired in order.
+  \return the entry ranges of the segments, in order
+*/
+vector<eventrange> BuildEvents::Segments(){
+  ReadTimestamps();
+  vector<unsigned long long int>* ts[kNSTREAMS] = {&fBRTS, &fWATS, &fEUTS};
+  const char* names[kNSTREAMS] = {"BigRIPS", "WASABI", "EURICA"};
+  vector<unsigned int> starts[kNSTREAMS];
+  unsigned int nsegments = 0;
+  for(int s=0;s<kNSTREAMS;s++){
+    if(ts[s]->size()==0)
+      continue;
+    starts[s].push_back(0);
+    for(unsigned int i=1;i<ts[s]->size();i++){
+      if(ts[s]->at(i)<ts[s]->at(i-1)){
+	if(fverbose>-1)
+	  cout << names[s] << " timestamp reset at entry " << i << ", this = " << ts[s]->at(i) << ", last = " << ts[s]->at(i-1) << endl;
+	starts[s].push_back(i);
+      }
+    }
+    nsegments = max(nsegments, (unsigned int)starts[s].size());
+  }
+  for(int s=0;s<kNSTREAMS;s++){
+    if(ts[s]->size()>0 && starts[s].size()!=nsegments)
+      cout << "warning: " << names[s] << " has " << starts[s].size() << " segments, but there are " << nsegments << " segments in other trees. The last ones are merged without " << names[s] << " data" << endl;
+  }
+
+  vector<eventrange> segments;
+  for(unsigned int k=0;k<nsegments;k++){
+    eventrange seg;
+    seg.startTS = 0;
+    bool first = true;
+    for(int s=0;s<kNSTREAMS;s++){
+      if(k<starts[s].size()){
+	seg.first[s] = starts[s][k];
+	seg.end[s] = k+1<starts[s].size() ? starts[s][k+1] : ts[s]->size();
+	if(k>0 && (first || ts[s]->at(seg.first[s])<seg.startTS))
+	  seg.startTS = ts[s]->at(seg.first[s]);
+	first = false;
+      }
+      else{
+	seg.first[s] = ts[s]->size();
+	seg.end[s] = ts[s]->size();
+      }
+    }
+    segments.push_back(seg);
+  }
+  if(nsegments>1)
+    cout << nsegments << " timestamp segments found" << endl;
+  return segments;
+}
+
+/*!
+  Split the data into time slices which can be merged independently. Each timestamp segment is merged separately, and within a segment the slices are cut only where the merged timestamps have a gap larger than the event building window, so no event is split.
+  The cuts are placed such that the slices contain similar numbers of entries.
+  \param nslices the number of slices wanted
+  \return the entry ranges of the slices, in order
+*/
+vector<eventrange> BuildEvents::TimeSlices(unsigned int nslices){
+  vector<eventrange> segments = Segments();
+  vector<eventrange> slices;
+  vector<unsigned long long int>* ts[kNSTREAMS] = {&fBRTS, &fWATS, &fEUTS};
+  unsigned long long int total = 0;
+  for(int s=0;s<kNSTREAMS;s++)
+    total += ts[s]->size();
+
+  TSQueue heads;
+  heads.SetNStreams(kNSTREAMS);
+  unsigned long long int merged = 0;
+  unsigned int cut = 1;
+  for(vector<eventrange>::iterator seg=segments.begin(); seg!=segments.end(); seg++){
+    eventrange current = *seg;
+    heads.Clear();
+    for(int s=0;s<kNSTREAMS;s++){
+      current.end[s] = current.first[s];
+      if(seg->first[s]<seg->end[s])
+	heads.Push(ts[s]->at(seg->first[s]), s);
+    }
+    unsigned long long int lastts = 0;
+    bool started = false;
+    while(!heads.Empty()){
+      detector head = heads.Top();
+      heads.Pop();
+      if(started && cut<nslices && head.TS - lastts > fwindow && merged >= cut*total/nslices){
+	slices.push_back(current);
+	for(int s=0;s<kNSTREAMS;s++)
+	  current.first[s] = current.end[s];
+	current.startTS = head.TS;
+	cut++;
+      }
+      lastts = head.TS;
+      started = true;
+      merged++;
+      unsigned int& next = current.end[head.ID];
+      next++;
+      if(next<seg->end[head.ID])
+	heads.Push(ts[head.ID]->at(next), head.ID);
+    }
+    slices.push_back(current);
+    //a new segment is a natural cut
+    while(cut<nslices && merged >= cut*total/nslices)
+      cut++;
+  }
+  if(fverbose>-1){
+    for(unsigned int i=0;i<slices.size();i++){
+      cout << "slice " << i << " starting at TS = " << slices[i].startTS;
+      cout << ", BigRIPS entries " << slices[i].first[kBigRIPS] << " - " << slices[i].end[kBigRIPS];
+      cout << ", WASABI entries " << slices[i].first[kWASABI] << " - " << slices[i].end[kWASABI];
+      cout << ", EURICA entries " << slices[i].first[kEURICA] << " - " << slices[i].end[kEURICA] << endl;
+    }
+  }
+  return slices;
+}
+
+/*!
+  Restrict the event building to a range of entries, e.g. one time slice
+  \param range the first and last entries of each tree and the timestamp of the first entry
+*/
+void BuildEvents::SetRange(eventrange range){
+  Rewind();
+  fBRentry = range.first[kBigRIPS];
+  fWAentry = range.first[kWASABI];
+  fEUentry = range.first[kEURICA];
+  fBRend = min(range.end[kBigRIPS], (unsigned int)fBRentries);
+  fWAend = min(range.end[kWASABI], (unsigned int)fWAentries);
+  fEUend = min(range.end[kEURICA], (unsigned int)fEUentries);
+  //the previous event is closed at the end of the previous range
+  fcurrentts = range.startTS;
+  //the readers are restarted on the new range by ReadEach
+  if(fBRreader!=NULL)
+    fBRreader->Stop();
+  if(fWAreader!=NULL)
+    fWAreader->Stop();
+  if(fEUreader!=NULL)
+    fEUreader->Stop();
+}
+
+/*!
+  Pre-scan for the two pass event building. The timestamps of all entries are read and the merging is done once on the timestamps alone.
+  This determines which entries end up in a written event, afterwards the event building starts again from the first entries and only those are read completely.
+*/
+void BuildEvents::PreScan(){
+  if(fBRreader!=NULL || fWAreader!=NULL || fEUreader!=NULL){
+    cout << "reading ahead is not used together with the pre-scan" << endl;
+    DeleteReaders();
+  }
+  if(fmode==0)
+    cout << "all events are written in mode 0, the pre-scan does not reduce the data to be read" << endl;
+
+  ReadTimestamps();
+  fBRneeded.assign(fBRTS.size(), false);
+  fWAneeded.assign(fWATS.size(), false);
+  fEUneeded.assign(fEUTS.size(), false);
+  fprescanned = true;
+
+  cout << "pre-scan: merging timestamps" << endl;
+  fdryrun = true;
+  ReadEach();
+  while(Merge()){
+  }
+  CloseEvent();
+  fdryrun = false;
+  Rewind();
+  ResetStatistics();
+
+  cout << "pre-scan: " << count(fBRneeded.begin(), fBRneeded.end(), true) << " of " << fBRTS.size() << " BigRIPS, ";
+  cout << count(fWAneeded.begin(), fWAneeded.end(), true) << " of " << fWATS.size() << " WASABI, ";
+  cout << count(fEUneeded.begin(), fEUneeded.end(), true) << " of " << fEUTS.size() << " EURICA entries are needed" << endl;
+}
+
 bool BuildEvents::ReadBigRIPS(){
   if(fverbose>1)
     cout << __PRETTY_FUNCTION__ << endl;
@@ -157,10 +576,27 @@ bool BuildEvents::ReadBigRIPS(){
     flocalfp[f]->Clear();
   }
   flocalBRts = 0;
-  if(fBRentry==fBRentries){
+  if(fBRentry==fBRend){
     return false;
   }
-  Int_t status = fBRtr->GetEvent(fBRentry);
+  Int_t status;
+  bool tsonly = false;
+  streamentry* pre = NULL;
+  if(fBRreader!=NULL){
+    pre = fBRreader->Peek();
+    if(pre==NULL)
+      return false;
+    status = pre->status;
+    flocalBRts = pre->TS;
+  }
+  else if(fprescanned && !fBRneeded[fBRentry]){
+    //the entry is not part of a written event, only its timestamp is needed
+    flocalBRts = fBRTS[fBRentry];
+    status = 1;
+    tsonly = true;
+  }
+  else
+    status = TimedGetEvent(fBRtr, fBRentry, kBigRIPS);
   if(fverbose>2)
     cout << "status " << status << endl;
   if(status == -1){
@@ -171,21 +607,28 @@ bool BuildEvents::ReadBigRIPS(){
     cerr<<"Error occured, entry "<<fBRentry<<" in tree "<<fBRtr->GetName()<<" in file doesn't exist"<<endl;
     return false;
   }
-  fnbytes += status;
+  if(!tsonly){
+    fnbytes[kBigRIPS] += status;
+    fnread[kBigRIPS]++;
+  }
   if(flocalBRts<flastBRts){
     cout << endl << "BigRIPS timestamp jump detected. this = " << flocalBRts << ", last = " << flastBRts << endl;
     fBRtsjump = true;
     return false;
   }
+  if(pre!=NULL){
+    swap(flocalbeam, pre->beam);
+    for(unsigned short f=0;f<NFPLANES;f++){
+      swap(flocalfp[f], pre->fp[f]);
+    }
+    fBRreader->Pop();
+  }
 
   if(fverbose>0)
     cout << "read new bigrips with TS = " << flocalBRts << " tof = "<< flocalbeam->GetTOF(0)+48<< endl;
   fBRentry++;
 
-  detector* det = new detector;
-  det->TS = flocalBRts;
-  det->ID = 0;
-  fdetectors.push_back(det);
+  fdetectors.Push(flocalBRts, kBigRIPS);
 
   flastBRts = flocalBRts;
   return true;
@@ -195,10 +638,27 @@ bool BuildEvents::ReadWASABI(){
     cout << __PRETTY_FUNCTION__ << endl;
   flocalwasabi->Clear();
   flocalWAts = 0;
-  if(fWAentry==fWAentries){
+  if(fWAentry==fWAend){
     return false;
   }
-  Int_t status = fWAtr->GetEvent(fWAentry);
+  Int_t status;
+  bool tsonly = false;
+  streamentry* pre = NULL;
+  if(fWAreader!=NULL){
+    pre = fWAreader->Peek();
+    if(pre==NULL)
+      return false;
+    status = pre->status;
+    flocalWAts = pre->TS;
+  }
+  else if(fprescanned && !fWAneeded[fWAentry]){
+    //the entry is not part of a written event, only its timestamp is needed
+    flocalWAts = fWATS[fWAentry];
+    status = 1;
+    tsonly = true;
+  }
+  else
+    status = TimedGetEvent(fWAtr, fWAentry, kWASABI);
   if(fverbose>2)
     cout << "status " << status << endl;
   if(status == -1){
@@ -209,21 +669,25 @@ bool BuildEvents::ReadWASABI(){
     cerr<<"Error occured, entry "<<fWAentry<<" in tree "<<fWAtr->GetName()<<" in file doesn't exist"<<endl;
     return false;
   }
-  fnbytes += status;
+  if(!tsonly){
+    fnbytes[kWASABI] += status;
+    fnread[kWASABI]++;
+  }
   
   if(flocalWAts<flastWAts){
     cout <<"WASABI timestamp jump detected. this = " << flocalWAts << ", last = " << flastWAts << endl;
     fWAtsjump = true;
     return false;
   }
+  if(pre!=NULL){
+    swap(flocalwasabi, pre->wasabi);
+    fWAreader->Pop();
+  }
   if(fverbose>0)
     cout << "read new wasabi with TS = " << flocalWAts << endl;
   fWAentry++;
 
-  detector* det = new detector;
-  det->TS = flocalWAts;
-  det->ID = 1;
-  fdetectors.push_back(det);
+  fdetectors.Push(flocalWAts, kWASABI);
 
   flastWAts = flocalWAts;
   return true;
@@ -231,10 +695,25 @@ bool BuildEvents::ReadWASABI(){
 bool BuildEvents::ReadEURICA(){
   if(fverbose>1)
     cout << __PRETTY_FUNCTION__ << endl;
-  if(fEUentry==fEUentries){
+  if(fEUentry==fEUend){
     return false;
   }
-  Int_t status = fEUtr->GetEvent(fEUentry);
+  Int_t status;
+  bool tsonly = false;
+  streamentry* pre = NULL;
+  if(fEUreader!=NULL){
+    pre = fEUreader->Peek();
+    if(pre==NULL)
+      return false;
+    status = pre->status;
+  }
+  else if(fprescanned && !fEUneeded[fEUentry]){
+    //the entry is not part of a written event, only its timestamp is needed
+    status = 1;
+    tsonly = true;
+  }
+  else
+    status = TimedGetEvent(fEUtr, fEUentry, kEURICA);
   if(fverbose>2)
     cout << "status " << status << endl;
   if(status == -1){
@@ -245,9 +724,17 @@ bool BuildEvents::ReadEURICA(){
     cerr<<"Error occured, entry "<<fEUentry<<" in tree "<<fEUtr->GetName()<<" in file doesn't exist"<<endl;
     return false;
   }
-  fnbytes += status;
+  if(!tsonly){
+    fnbytes[kEURICA] += status;
+    fnread[kEURICA]++;
+  }
   
-  flocalEUts = ((TArtEventInfo*) fEUeventinfo->At(0))->GetTimeStamp();
+  if(pre!=NULL)
+    flocalEUts = pre->TS;
+  else if(fprescanned)
+    flocalEUts = fEUTS[fEUentry];
+  else
+    flocalEUts = ((TArtEventInfo*) fEUeventinfo->At(0))->GetTimeStamp();
   if(flocalEUts<flastEUts){
     cout <<"EURICA timestamp jump detected. this = " << flocalEUts << ", last = " << flastEUts << endl;
     fEUtsjump = true;
@@ -256,39 +743,23 @@ bool BuildEvents::ReadEURICA(){
   if(fverbose>0)
     cout << "read new eurica with TS = " << flocalEUts << endl;
 
-  //cout << "fEUcluster->GetEntries() " << fEUcluster->GetEntries() << "\tfEUclusterAB->GetEntries() " << fEUclusterAB->GetEntries() << endl; 
-  for(int i=0;i<fEUcluster->GetEntries();i++){
-    TArtGeCluster *hit =(TArtGeCluster*) fEUcluster->At(i);
-    if(hit->GetEnergy()>1){
-      if(fverbose>2)
-	cout << fEUentry << "\t" << i <<"\t" << hit->GetEnergy() << "\t" << hit->GetTiming() << endl;
-      
-      EURICAHit *euhit = new EURICAHit(hit->GetChannel(),hit->GetEnergy(),hit->GetTiming(),1,flocalEUts);
-      flocaleurica->AddHit(euhit);
-    }
-  }
-  for(int i=0;i<fEUclusterAB->GetEntries();i++){
-    TArtGeCluster *hit =(TArtGeCluster*) fEUclusterAB->At(i);
-    if(hit->GetEnergy()>1){
-      if(fverbose>2)
-	cout << fEUentry << "\t" << i <<"\t" << hit->GetEnergy() << "\t" << hit->GetTiming() << endl;
-      
-      EURICAHit *euhit = new EURICAHit(hit->GetChannel(),hit->GetEnergy(),hit->GetTiming(),1,flocalEUts);
-      flocaleurica->AddHitAB(euhit);
-    }
+  if(pre!=NULL){
+    //the hits have been converted by the reader thread
+    swap(flocaleurica, pre->eurica);
+    fEUreader->Pop();
   }
+  else if(!tsonly)
+    StreamReader::AddEURICAHits(flocaleurica, fEUcluster, fEUclusterAB, flocalEUts, fEUentry, fverbose);
   fEUentry++;
 
-  detector* det = new detector;
-  det->TS = flocalEUts;
-  det->ID = 2;
-  fdetectors.push_back(det);
+  fdetectors.Push(flocalEUts, kEURICA);
 
   flastEUts = flocalEUts;
   return true;
 }
 
 bool BuildEvents::ReadEach(){
+  StartReaders();
   flastBRts = 0;
   flastWAts = 0;
   flastEUts = 0;
@@ -306,7 +777,7 @@ bool BuildEvents::ReadEach(){
     return false;
   }
 }
-void BuildEvents::CloseEvent(){
+void BuildEvents::CloseEvent(int reason){
   if(fverbose>0)
     cout << __PRETTY_FUNCTION__ << endl;
   // // bool printme = false;
@@ -320,16 +791,39 @@ void BuildEvents::CloseEvent(){
     cout << "closing event with local TS = " << flocalBRts << " tof = "<< flocalbeam->GetTOF(0)+48<< endl;
     cout << "closing event with set TS = " << fBRts << " tof = "<< fbeam->GetTOF(0)+48<< endl;
   }
+  bool write = false;
   switch(fmode){
   default:
   case 0: //write all events
-    fmtr->Fill();
+    write = true;
     break;
   case 1://isomer data BR and WA coincidence
     if(fBRts>0 && fWAts >0)
-      fmtr->Fill();
+      write = true;
     break;
   }
+  if(write && fdryrun){
+    //remember the entries which make up this event, of several WASABI entries only the last one is written
+    if(fBRevent>-1)
+      fBRneeded[fBRevent] = true;
+    if(fWAevent>-1)
+      fWAneeded[fWAevent] = true;
+    for(vector<unsigned int>::iterator e=fEUevent.begin(); e!=fEUevent.end(); e++)
+      fEUneeded[*e] = true;
+  }
+  else if(write)
+    fmtr->Fill();
+  if(fevententries>0){
+    fnclosed[reason]++;
+    if(write)
+      fnwritten++;
+    fevententriesh->Fill(fevententries);
+    feventspanh->Fill(fcurrentts - feventfirstts);
+  }
+  fevententries = 0;
+  fBRevent = -1;
+  fWAevent = -1;
+  fEUevent.clear();
 
   fBRts = 0;
   fbeam->Clear();
@@ -353,67 +847,66 @@ bool BuildEvents::Merge(){
     cout << __PRETTY_FUNCTION__ << endl;
 
   if(fverbose>1){
-    cout << "before sorting" << endl;
-    for(vector<detector*>::iterator det=fdetectors.begin(); det!=fdetectors.end(); det++){
-      cout << "ID = " << (*det)->ID << ", TS = " << (*det)->TS << endl;
-    }
+    cout << "stream heads" << endl;
+    fdetectors.Print();
   }
-  sort(fdetectors.begin(), fdetectors.end(),TSComparer());
-  if(fverbose>1){
-    cout << "after sorting" << endl;
-    for(vector<detector*>::iterator det=fdetectors.begin(); det!=fdetectors.end(); det++){
-      cout << "ID = " << (*det)->ID << ", TS = " << (*det)->TS << endl;
-    }
+  if(fdetectors.Empty()){
+    cout << "all files finished " << endl;
+    return false;
   }
+  int id = fdetectors.Top().ID;
+  fdetectors.Pop();
 
-  switch(fdetectors.at(0)->ID){
-  case 0: //BigRIPS
+  switch(id){
+  case kBigRIPS:
     if(fBRts>0){
       if(fverbose>1)
 	cout << "has already BigRIPS" << endl;
-      CloseEvent();
+      CloseEvent(kCloseBigRIPS);
     }
     else if(flocalBRts - fcurrentts > fwindow){
       if(fverbose>0)
 	cout << "BR larger than window" << endl;
-      CloseEvent();
+      CloseEvent(kCloseWindow);
     }
     fBRts = flocalBRts;
-    fbeam = (Beam*)flocalbeam->Clone();
+    //copy into the objects of the output branches, the local ones are overwritten by the next read
+    *fbeam = *flocalbeam;
     for(unsigned short f=0;f<NFPLANES;f++){
-      ffp[f] = (FocalPlane*)flocalfp[f]->Clone(Form("fp_%d",f));
+      *ffp[f] = *flocalfp[f];
     }
+    fBRevent = fBRentry-1;
     fcurrentts = fBRts;
-    fdetectors.erase(fdetectors.begin());
     if(!ReadBigRIPS()&&fBRtsjump==false)
       cout << "failed to read BigRIPS, end of file" << endl;
     break;
-  case 1: //WASABI
+  case kWASABI:
     if(flocalWAts - fcurrentts > fwindow){
       if(fverbose>0)
 	cout << "WA larger than window" << endl;
-      CloseEvent();
+      CloseEvent(kCloseWindow);
     }
     fWAts = flocalWAts;
-    fwasabi = (WASABI*)flocalwasabi->Clone();
+    //hand the hits over to the output object, anything it still held is released with the local one
+    fwasabi->Swap(flocalwasabi);
     flocalwasabi->Clear();
+    fWAevent = fWAentry-1;
     fcurrentts = fWAts;
-    fdetectors.erase(fdetectors.begin());
     if(!ReadWASABI()&&fWAtsjump==false)
       cout << "failed to read WASABI, end of file" << endl;
     break;
-  case 2: //EURICA
+  case kEURICA:
     if(flocalEUts - fcurrentts > fwindow){
       if(fverbose>0)
 	cout << "EU larger than window" << endl;
-      CloseEvent();
+      CloseEvent(kCloseWindow);
     }
     fEUts = flocalEUts;
     feurica->AddHits(flocaleurica->GetHits());
     feurica->AddHitsAB(flocaleurica->GetHitsAB());
     flocaleurica->Clear();
+    fEUevent.push_back(fEUentry-1);
     fcurrentts = fEUts;
-    fdetectors.erase(fdetectors.begin());
     if(!ReadEURICA()&&fEUtsjump==false)
       cout << "failed to read EURICA, end of file" << endl;
     break;
@@ -421,12 +914,13 @@ bool BuildEvents::Merge(){
   default:
     break;
   }
+  AddToStatistics(id, fcurrentts);
   if(flastevent>0 && flastevent == (int)(fBRentry + fWAentry + fEUentry)){
     cout << "last event reached " << endl;
     return false;
   }
 
-  if(fdetectors.size()==0){
+  if(fdetectors.Empty()){
     if(fhasBR && fhasEU && fhasWA && fEUtsjump==true && fWAtsjump==true && fBRtsjump==true){
       cout << "all timestamps jumped" << endl;
       fEUtsjump = false;
@@ -7,12 +7,152 @@ using namespace std;
   \param settings the settings file
 */
 Calibration::Calibration(char* settings){
-  fRand = new TRandom();
+  fentry = 0;
+  fADCtable = NULL;
   fset = new WASABISettings(settings);
-  ReadADCMap(fset->ADCMapFile());
-  ReadADCThresholds(fset->ADCThreshFile());
-  ReadCalibration(fset->CalFile(), fset->TOffsetFile());
-  ReadTDCMap(fset->TDCMapFile());
+  if(!ReadBundle(settings)){
+    ReadADCMap(fset->ADCMapFile());
+    ReadADCThresholds(fset->ADCThreshFile());
+    ReadCalibration(fset->CalFile(), fset->TOffsetFile());
+    ReadTDCMap(fset->TDCMapFile());
+    WriteBundle(settings);
+  }
+  BuildADCTable();
+}
+/*!
+  Read the mapping, thresholds, and calibration from the parameter bundle compiled from the settings file, settings.wasabi.bundle
+  \param settings the settings file
+  \return false if there is no bundle or the settings or any of the files given in them have changed
+*/
+bool Calibration::ReadBundle(char* settings){
+  if(settings == NULL)
+    return false;
+  ParameterBundle bundle(string(settings) + ".wasabi.bundle");
+  if(!bundle.Load())
+    return false;
+  double adc[2][NADCS*NADCCH];
+  double thresh[NADCS*NADCCH];
+  double tdc[2][NTDCS*NTDCCH];
+  double strip[6][NDSSSD*NXSTRIPS];
+  bool ok = bundle.Get("ADC.DSSSD", adc[0], NADCS*NADCCH);
+  ok = ok && bundle.Get("ADC.Strip", adc[1], NADCS*NADCCH);
+  ok = ok && bundle.Get("ADC.Thresh", thresh, NADCS*NADCCH);
+  ok = ok && bundle.Get("TDC.DSSSD", tdc[0], NTDCS*NTDCCH);
+  ok = ok && bundle.Get("TDC.Strip", tdc[1], NTDCS*NTDCCH);
+  ok = ok && bundle.Get("Gain.XStrip", strip[0], NDSSSD*NXSTRIPS);
+  ok = ok && bundle.Get("Offset.XStrip", strip[1], NDSSSD*NXSTRIPS);
+  ok = ok && bundle.Get("TOffset.XStrip", strip[2], NDSSSD*NXSTRIPS);
+  ok = ok && bundle.Get("Gain.YStrip", strip[3], NDSSSD*NYSTRIPS);
+  ok = ok && bundle.Get("Offset.YStrip", strip[4], NDSSSD*NYSTRIPS);
+  ok = ok && bundle.Get("TOffset.YStrip", strip[5], NDSSSD*NYSTRIPS);
+  if(!ok){
+    cout << "parameter bundle " << bundle.GetFileName() << " is incomplete" << endl;
+    return false;
+  }
+  for(int i=0; i<NADCS*NADCCH; i++){
+    fDSSSD[i] = adc[0][i];
+    fStrip[i] = adc[1][i];
+    fThresh[i] = thresh[i];
+  }
+  for(int i=0; i<NTDCS*NTDCCH; i++){
+    fTDCDSSSD[i] = tdc[0][i];
+    fTDCStrip[i] = tdc[1][i];
+  }
+  for(int d=0; d<NDSSSD; d++){
+    for(int x=0; x<NXSTRIPS; x++){
+      fgainX[d][x] = strip[0][d*NXSTRIPS+x];
+      foffsetX[d][x] = strip[1][d*NXSTRIPS+x];
+      fToffsetX[d][x] = strip[2][d*NXSTRIPS+x];
+    }
+    for(int y=0; y<NYSTRIPS; y++){
+      fgainY[d][y] = strip[3][d*NYSTRIPS+y];
+      foffsetY[d][y] = strip[4][d*NYSTRIPS+y];
+      fToffsetY[d][y] = strip[5][d*NYSTRIPS+y];
+    }
+  }
+  if(fset->GetVLevel()>0)
+    cout << "mapping and calibration read from " << bundle.GetFileName() << endl;
+  return true;
+}
+/*!
+  Check the mapping and the calibration for channels mapped to the same strip and strips without calibration, and write the parameter bundle settings.wasabi.bundle
+  \param settings the settings file
+*/
+void Calibration::WriteBundle(char* settings){
+  //validation
+  short adcchannel[NDSSSD][NXSTRIPS+NYSTRIPS];
+  for(int d=0; d<NDSSSD; d++){
+    for(int s=0; s<NXSTRIPS+NYSTRIPS; s++)
+      adcchannel[d][s] = -1;
+  }
+  int nwarnings = 0;
+  for(int i=0; i<NADCS*NADCCH; i++){
+    short d = fDSSSD[i];
+    short s = fStrip[i];
+    if(d<0 || d>NDSSSD-1 || s<0 || s>NXSTRIPS+NYSTRIPS-1)
+      continue;
+    if(adcchannel[d][s]>-1){
+      cout << "warning ADC channels " << adcchannel[d][s] << " and " << i << " are both mapped to DSSSD " << d << " strip " << s << endl;
+      nwarnings++;
+    }
+    else
+      adcchannel[d][s] = i;
+    if((s<NXSTRIPS && fgainX[d][s]<=0) || (s>=NXSTRIPS && fgainY[d][s-NXSTRIPS]<=0)){
+      if(fset->GetVLevel()>0)
+	cout << "warning ADC channel " << i << " (DSSSD " << d << " strip " << s << ") has no gain" << endl;
+      nwarnings++;
+    }
+  }
+  if(nwarnings>0)
+    cout << nwarnings << " warnings for the mapping and calibration" << endl;
+  if(settings == NULL)
+    return;
+
+  ParameterBundle bundle(string(settings) + ".wasabi.bundle");
+  bundle.AddSource(settings);
+  bundle.AddSource(fset->ADCMapFile());
+  bundle.AddSource(fset->ADCThreshFile());
+  bundle.AddSource(fset->CalFile());
+  bundle.AddSource(fset->TOffsetFile());
+  bundle.AddSource(fset->TDCMapFile());
+  double adc[2][NADCS*NADCCH];
+  double thresh[NADCS*NADCCH];
+  double tdc[2][NTDCS*NTDCCH];
+  double strip[6][NDSSSD*NXSTRIPS];
+  for(int i=0; i<NADCS*NADCCH; i++){
+    adc[0][i] = fDSSSD[i];
+    adc[1][i] = fStrip[i];
+    thresh[i] = fThresh[i];
+  }
+  for(int i=0; i<NTDCS*NTDCCH; i++){
+    tdc[0][i] = fTDCDSSSD[i];
+    tdc[1][i] = fTDCStrip[i];
+  }
+  for(int d=0; d<NDSSSD; d++){
+    for(int x=0; x<NXSTRIPS; x++){
+      strip[0][d*NXSTRIPS+x] = fgainX[d][x];
+      strip[1][d*NXSTRIPS+x] = foffsetX[d][x];
+      strip[2][d*NXSTRIPS+x] = fToffsetX[d][x];
+    }
+    for(int y=0; y<NYSTRIPS; y++){
+      strip[3][d*NYSTRIPS+y] = fgainY[d][y];
+      strip[4][d*NYSTRIPS+y] = foffsetY[d][y];
+      strip[5][d*NYSTRIPS+y] = fToffsetY[d][y];
+    }
+  }
+  bundle.Set("ADC.DSSSD", adc[0], NADCS*NADCCH);
+  bundle.Set("ADC.Strip", adc[1], NADCS*NADCCH);
+  bundle.Set("ADC.Thresh", thresh, NADCS*NADCCH);
+  bundle.Set("TDC.DSSSD", tdc[0], NTDCS*NTDCCH);
+  bundle.Set("TDC.Strip", tdc[1], NTDCS*NTDCCH);
+  bundle.Set("Gain.XStrip", strip[0], NDSSSD*NXSTRIPS);
+  bundle.Set("Offset.XStrip", strip[1], NDSSSD*NXSTRIPS);
+  bundle.Set("TOffset.XStrip", strip[2], NDSSSD*NXSTRIPS);
+  bundle.Set("Gain.YStrip", strip[3], NDSSSD*NYSTRIPS);
+  bundle.Set("Offset.YStrip", strip[4], NDSSSD*NYSTRIPS);
+  bundle.Set("TOffset.YStrip", strip[5], NDSSSD*NYSTRIPS);
+  if(bundle.Write())
+    cout << "mapping and calibration compiled into " << bundle.GetFileName() << endl;
 }
 /*!
   Read in the ADC mapping, from adc number and channel to dssd and strip
@@ -28,6 +168,7 @@ void Calibration::ReadADCMap(char* mapfile){
       fStrip[a*NADCCH+c] -= 1;
     }
   } 
+  delete adcmap;
 }
 /*!
   Read in the TDC mapping, from tdc number and channel to dssd and strip
@@ -41,6 +182,7 @@ void Calibration::ReadTDCMap(char* mapfile){
       fTDCStrip[a*NTDCCH+c] = tdcmap->GetValue(Form("WASABI.Strip.%d",a*NTDCCH+c),-1);
     }
   } 
+  delete tdcmap;
 }
 /*!
   Read in the ADC thresholds
@@ -53,6 +195,7 @@ void Calibration::ReadADCThresholds(char* threshfile){
       fThresh[a*NADCCH+c] = adcthresh->GetValue(Form("WASABI.Thresh.%d",a*NADCCH+c),0);
     }
   } 
+  delete adcthresh;
 }
 /*!
   Read in the energy calibration
@@ -78,6 +221,58 @@ void Calibration::ReadCalibration(char* adccalfile, char* tdccalfile){
 	cout << "d = " << d << ", ystrip gain = " << fgainY[d][y] << ", offset = " << foffsetY[d][y] << ", Toffset = " << fToffsetY[d][y] << endl;
     }
   } 
+  delete adccal;
+  delete tdccal;
+}
+/*!
+  Combine the ADC mapping, thresholds, calibration, and the veto and threshold settings into one record per ADC channel.
+  Has to be called again if the mapping, thresholds or calibration are read in again.
+*/
+void Calibration::BuildADCTable(){
+  //new does not guarantee the alignment of adcchannel before C++17
+  if(fADCtable==NULL){
+    void* table = NULL;
+    if(posix_memalign(&table, 64, NADCS*NADCCH*sizeof(adcchannel))!=0){
+      cout << "could not allocate the ADC channel table" << endl;
+      return;
+    }
+    fADCtable = (adcchannel*)table;
+  }
+  for(int index=0; index<NADCS*NADCCH; index++){
+    adcchannel* chan = &fADCtable[index];
+    short dsssd = fDSSSD[index];
+    short strip = fStrip[index];
+    chan->thresh = fThresh[index];
+    chan->dsssd = -1;
+    chan->strip = -1;
+    chan->side = 0;
+    chan->gain = -1;
+    chan->offset = 0;
+    chan->veto = -1;
+    chan->low = -1;
+    if(dsssd<0 || dsssd>NDSSSD-1)
+      continue;
+    if(strip<0 || strip>NXSTRIPS+NYSTRIPS-1)
+      continue;
+    chan->dsssd = dsssd;
+    if(strip < NXSTRIPS){
+      chan->strip = strip;
+      chan->side = 0;
+      chan->gain = fgainX[dsssd][strip];
+      chan->offset = foffsetX[dsssd][strip];
+      chan->veto = fset->VetoX(dsssd);
+      chan->low = fset->ThreshX(dsssd);
+    }
+    else{
+      strip -= NXSTRIPS;
+      chan->strip = strip;
+      chan->side = 1;
+      chan->gain = fgainY[dsssd][strip];
+      chan->offset = foffsetY[dsssd][strip];
+      chan->veto = fset->VetoY(dsssd);
+      chan->low = fset->ThreshY(dsssd);
+    }
+  }
 }
 /*!
   Apply mapping and calibrations, 
@@ -85,66 +280,82 @@ void Calibration::ReadCalibration(char* adccalfile, char* tdccalfile){
   \returns calibrated wasabi event
 */
 WASABI* Calibration::BuildWASABI(WASABIRaw *raw){
-  //cout << __PRETTY_FUNCTION__ << endl;
   WASABI* event = new WASABI();
+  BuildWASABI(raw, event);
+  return event;
+}
+/*!
+  Apply mapping and calibrations to the next entry, the entries are counted by this Calibration
+  \param raw wasabi data
+  \param event the calibrated wasabi event to be filled
+*/
+void Calibration::BuildWASABI(WASABIRaw *raw, WASABI* event){
+  BuildWASABI(raw, event, fentry++);
+}
+/*!
+  Apply mapping and calibrations, the event is cleared and filled, its hits are taken from the pools of the DSSSDs.
+  The random numbers for smearing depend only on the seed, the entry number, the channel and the hit, so the result is independent of the order in which entries are calibrated.
+  \param raw wasabi data
+  \param event the calibrated wasabi event to be filled
+  \param entry the entry number
+*/
+void Calibration::BuildWASABI(WASABIRaw *raw, WASABI* event, unsigned long long int entry){
+  //cout << __PRETTY_FUNCTION__ << endl;
+  event->Clear();
 
   //adc mapping and calibration
-  vector<WASABIRawADC*> rawadcs = raw->GetADCs();
-  for(vector<WASABIRawADC*>::iterator adc=rawadcs.begin(); adc!=rawadcs.end(); adc++){
+  const vector<WASABIRawADC*>& rawadcs = raw->GetADCs();
+  for(vector<WASABIRawADC*>::const_iterator adc=rawadcs.begin(); adc!=rawadcs.end(); adc++){
     short index = (*adc)->GetADC()*NADCCH + (*adc)->GetChan();
-    short dsssd = fDSSSD[index];
-    short strip = fStrip[index];
-    if(dsssd<0 || dsssd>NDSSSD-1)
+    if(index<0 || index>NADCS*NADCCH-1)
       continue;
-    if(strip<0 || strip>NXSTRIPS+NYSTRIPS-1)
+    const adcchannel& chan = fADCtable[index];
+    if(chan.dsssd<0)
       continue;
 
-
-    //cout << "adc = " << (*adc)->GetADC() << ", ch = " << (*adc)->GetChan() << ", index = " << index << ", dsssd = " << dsssd << ", strip = " << strip << ", val = " << (*adc)->GetVal() << endl;
-    short adcval = (*adc)->GetVal() - fThresh[index];
+    //cout << "adc = " << (*adc)->GetADC() << ", ch = " << (*adc)->GetChan() << ", index = " << index << ", dsssd = " << chan.dsssd << ", strip = " << chan.strip << ", val = " << (*adc)->GetVal() << endl;
+    short adcval = (*adc)->GetVal() - chan.thresh;
     if(adcval<0)
       continue;
     
-    double en = adcval+fRand->Uniform(0,1);
-    if(strip < NXSTRIPS){
-      bool cal = false;
-      if(fgainX[dsssd][strip]>0){
-	cal = true;
-	en = en * fgainX[dsssd][strip] + foffsetX[dsssd][strip];
-      }
-      if(fset->VetoX(dsssd) > 0 && en > fset->VetoX(dsssd))
-	event->GetDSSSD(dsssd)->SetVetoX();
-      if(fset->ThreshX(dsssd) > 0 && en < fset->ThreshX(dsssd))
+    double en = adcval+fRand.Uniform(entry,index,0);
+    bool cal = false;
+    if(chan.gain>0){
+      cal = true;
+      en = en * chan.gain + chan.offset;
+    }
+    DSSSD* dsssd = event->GetDSSSD(chan.dsssd);
+    if(chan.side==0){
+      if(chan.veto > 0 && en > chan.veto)
+	dsssd->SetVetoX();
+      if(chan.low > 0 && en < chan.low)
 	continue;
-      event->GetDSSSD(dsssd)->AddHitX(new WASABIHit(strip,en,cal));
-      //cout << " added X strip " << strip << " with energy " << en << endl;
+      dsssd->AddHitX(dsssd->NewHit(chan.strip,en,cal));
     }
     else{
-      strip -= NXSTRIPS;
-      bool cal = false;
-      if(fgainY[dsssd][strip]>0){
-	cal = true;
-	en = en * fgainY[dsssd][strip] + foffsetY[dsssd][strip];
-      }
-      if(fset->VetoY(dsssd) > 0 && en > fset->VetoY(dsssd))
-	event->GetDSSSD(dsssd)->SetVetoY();
-      if(fset->ThreshY(dsssd) > 0 && en < fset->ThreshY(dsssd))
+      if(chan.veto > 0 && en > chan.veto)
+	dsssd->SetVetoY();
+      if(chan.low > 0 && en < chan.low)
 	continue;
-      event->GetDSSSD(dsssd)->AddHitY(new WASABIHit(strip,en,cal));
-      //cout << " added Y strip " << strip << " with energy " << en << endl;
+      dsssd->AddHitY(dsssd->NewHit(chan.strip,en,cal));
     }
   }
 
   //time calibration and mapping
   short references[NTDCS];
   for(int t=0;t<NTDCS;t++){
-    references[t] = raw->GetTDC(t,fset->TDCrefchannel(t))->GetVal()[0];
+    WASABIRawTDC* ref = raw->GetTDC(t,fset->TDCrefchannel(t));
+    references[t] = 0;
+    if(ref!=NULL && ref->GetVal().size()>0)
+      references[t] = ref->GetVal(0);
     //cout << "reference TDC " << t << " ch " << fset->TDCrefchannel(t) << ",\t" << raw->GetTDC(t,fset->TDCrefchannel(t))->GetVal().size() << "\t"<< references[t] << endl;
   }
-  vector<WASABIRawTDC*> rawtdcs = raw->GetTDCs();
-  for(vector<WASABIRawTDC*>::iterator tdc=rawtdcs.begin(); tdc!=rawtdcs.end(); tdc++){
+  const vector<WASABIRawTDC*>& rawtdcs = raw->GetTDCs();
+  for(vector<WASABIRawTDC*>::const_iterator tdc=rawtdcs.begin(); tdc!=rawtdcs.end(); tdc++){
     short tdcnr = (*tdc)->GetTDC();
     short index = tdcnr*NTDCCH + (*tdc)->GetChan();
+    if(tdcnr<0 || tdcnr>NTDCS-1 || index<0 || index>NTDCS*NTDCCH-1)
+      continue;
     short dsssd = fTDCDSSSD[index];
     short strip = fTDCStrip[index];
     if(dsssd<0 || dsssd>NDSSSD-1)
@@ -159,10 +370,16 @@ WASABI* Calibration::BuildWASABI(WASABIRaw *raw){
     cout << endl;
     */
     
+    //the TDC channels follow the ADC channels, the random numbers are made in blocks of four
+    const vector<short>& vals = (*tdc)->GetVal();
+    unsigned int channel = NADCS*NADCCH + index;
+    double dither[4];
     if(strip < NXSTRIPS){
       //cout << "xstrips ";
-      for(unsigned short v = 0; v<(*tdc)->GetVal().size(); v++){
-	double tval  = (*tdc)->GetVal()[v]+fRand->Uniform(0,1) - references[tdcnr];
+      for(unsigned short v = 0; v<vals.size(); v++){
+	if(v%4==0)
+	  fRand.Uniform(entry, channel, v, min(4,(int)vals.size()-v), dither);
+	double tval  = vals[v]+dither[v%4] - references[tdcnr];
 	tval -= fToffsetX[dsssd][strip];
 	event->GetDSSSD(dsssd)->SetStripTimeX(strip,tval);
 	//cout << tval << "\t";
@@ -172,8 +389,10 @@ WASABI* Calibration::BuildWASABI(WASABIRaw *raw){
     else{
       strip -= NXSTRIPS;
       //cout << "ystrips ";
-       for(unsigned short v = 0; v<(*tdc)->GetVal().size(); v++){
-	double tval  = (*tdc)->GetVal()[v]+fRand->Uniform(0,1) - references[tdcnr];
+       for(unsigned short v = 0; v<vals.size(); v++){
+	if(v%4==0)
+	  fRand.Uniform(entry, channel, v, min(4,(int)vals.size()-v), dither);
+	double tval  = vals[v]+dither[v%4] - references[tdcnr];
 	tval -= fToffsetY[dsssd][strip];
  	event->GetDSSSD(dsssd)->SetStripTimeY(strip,tval);
       }
@@ -221,6 +440,4 @@ WASABI* Calibration::BuildWASABI(WASABIRaw *raw){
   // for(int i=0; i<NDSSSD; i++)
   //   event->GetDSSSD(i)->Print();
   //event->Print();
-  
-  return event;
 }
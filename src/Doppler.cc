@@ -0,0 +1,89 @@
+#include "Doppler.hh"
+#include <cmath>
+using namespace std;
+
+//! number of hits whose geometry is gathered at once
+static const unsigned int kBlock = 64;
+
+/*!
+  Default constructor, all crystals at the origin and beta 0
+*/
+Doppler::Doppler(){
+  for(int i=0;i<MAXNCRYSTAL;i++){
+    fz[i] = 0;
+    fperp2[i] = 0;
+    fcostheta[i] = 1;
+  }
+  SetBetaParameters(0,0,0);
+}
+
+/*!
+  Set the average positions of the crystals and compute their cos(theta)
+  \param positions the x, y, z positions for each crystal ID
+*/
+void Doppler::SetGeometry(const vector<vector<double> >& positions){
+  for(int i=0;i<MAXNCRYSTAL;i++){
+    if(i<(int)positions.size() && positions[i].size()>2){
+      fz[i] = positions[i][2];
+      fperp2[i] = positions[i][0]*positions[i][0] + positions[i][1]*positions[i][1];
+    }
+    double r = sqrt(fperp2[i] + fz[i]*fz[i]);
+    //same convention as TVector3::CosTheta for the origin
+    fcostheta[i] = r>0 ? fz[i]/r : 1;
+  }
+}
+
+/*!
+  Doppler correct a batch of hits, which may belong to different events.
+  The geometry of each block of hits is gathered first, the correction is then a loop without lookups.
+  \param n the number of hits
+  \param id the crystal IDs, 0 to MAXNCRYSTAL-1
+  \param en the energies in the laboratory
+  \param beta the beta for each hit
+  \param dcen the Doppler corrected energies
+*/
+void Doppler::Correct(unsigned int n, const short* id, const double* en, const double* beta, double* dcen) const {
+  double costheta[kBlock];
+  for(unsigned int first=0;first<n;first+=kBlock){
+    unsigned int m = n-first<kBlock ? n-first : kBlock;
+    for(unsigned int i=0;i<m;i++)
+      costheta[i] = fcostheta[id[first+i]];
+    const double* e = en+first;
+    const double* b = beta+first;
+    double* dc = dcen+first;
+    for(unsigned int i=0;i<m;i++)
+      dc[i] = e[i]/sqrt(1-b[i]*b[i])*(1-b[i]*costheta[i]);
+  }
+}
+
+/*!
+  Doppler correct a batch of hits with the angle seen from the reaction point, which may be different for each hit.
+  A crystal position exactly at the reaction point gives cos(theta) 1, as TVector3::CosTheta.
+  \param n the number of hits
+  \param id the crystal IDs, 0 to MAXNCRYSTAL-1
+  \param en the energies in the laboratory
+  \param zreac the reaction point along the beam axis for each hit
+  \param dcen the Doppler corrected energies
+*/
+void Doppler::CorrectVertex(unsigned int n, const short* id, const double* en, const double* zreac, double* dcen) const {
+  double z[kBlock];
+  double perp2[kBlock];
+  for(unsigned int first=0;first<n;first+=kBlock){
+    unsigned int m = n-first<kBlock ? n-first : kBlock;
+    for(unsigned int i=0;i<m;i++){
+      z[i] = fz[id[first+i]];
+      perp2[i] = fperp2[id[first+i]];
+    }
+    const double* e = en+first;
+    const double* zr = zreac+first;
+    double* dc = dcen+first;
+    for(unsigned int i=0;i<m;i++){
+      double dz = z[i] - zr[i];
+      double r2 = perp2[i] + dz*dz;
+      double r = sqrt(r2);
+      double costheta = r2>0 ? dz/r : 1;
+      double b = fbetapar[0] + zr[i]*(fbetapar[1] + zr[i]*fbetapar[2]);
+      dc[i] = e[i]/sqrt(1-b*b)*(1-b*costheta);
+    }
+  }
+}
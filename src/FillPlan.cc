@@ -0,0 +1,260 @@
+#include "FillPlan.hh"
+#include <cstdio>
+using namespace std;
+
+/*!
+  Constructor
+  \param hreg the registry in which the histograms are booked
+*/
+FillPlan::FillPlan(HistogramRegistry* hreg){
+  freg = hreg;
+  fnrows = 0;
+}
+
+/*!
+  Declare a variable of the rows
+  \param name the name of the variable
+  \return the index used in Set and the definition of the families
+*/
+int FillPlan::Variable(const char* name){
+  fnames.push_back(name);
+  fcurrent.push_back(0);
+  fcolumns.push_back(vector<double>());
+  return fnames.size()-1;
+}
+
+/*!
+  Index of the axis with this binning, histograms with the same variable and binning share the axis
+  \return the index of the axis
+*/
+int FillPlan::Axis(int var, int nbins, double low, double up){
+  for(unsigned int a=0; a<faxes.size(); a++){
+    if(faxes[a].var==var && faxes[a].nbins==nbins && faxes[a].low==low && faxes[a].up==up)
+      return a;
+  }
+  planaxis axis;
+  axis.var = var;
+  axis.nbins = nbins;
+  axis.low = low;
+  axis.up = up;
+  faxes.push_back(axis);
+  fbins.push_back(vector<int>());
+  return faxes.size()-1;
+}
+
+/*!
+  Add a family with a 1D histogram
+  \param name the name and title of the histogram
+  \param x the variable
+  \return the index of the family
+*/
+int FillPlan::H1(const char* name, int x, int nbinsx, double xlow, double xup){
+  planfamily family;
+  family.hists.push_back(freg->H1(name,name,nbinsx,xlow,xup));
+  family.xaxis.push_back(Axis(x,nbinsx,xlow,xup));
+  family.yaxis.push_back(-1);
+  ffamilies.push_back(family);
+  return ffamilies.size()-1;
+}
+
+/*!
+  Add a family with a 2D histogram
+  \param name the name and title of the histogram
+  \param x the variable on the x axis
+  \param y the variable on the y axis
+  \return the index of the family
+*/
+int FillPlan::H2(const char* name, int x, int nbinsx, double xlow, double xup, int y, int nbinsy, double ylow, double yup){
+  planfamily family;
+  family.hists.push_back(freg->H2(name,name,nbinsx,xlow,xup,nbinsy,ylow,yup));
+  family.xaxis.push_back(Axis(x,nbinsx,xlow,xup));
+  family.yaxis.push_back(Axis(y,nbinsy,ylow,yup));
+  ffamilies.push_back(family);
+  return ffamilies.size()-1;
+}
+
+/*!
+  Split a family by the value of a variable, e.g. the multiplicity. The split histograms have the binning of the inclusive one.
+  \param family the family
+  \param var the variable, rows with values below 1 only fill the inclusive histogram
+  \param nsplit the histograms are numbered 1 to nsplit-1, larger values go into the last one
+  \param format the name of the split histograms, with %d for the number
+*/
+void FillPlan::Split(int family, int var, int nsplit, const char* format){
+  planfamily& fam = ffamilies[family];
+  planaxis& x = faxes[fam.xaxis[0]];
+  if(fam.yaxis[0]<0){
+    string form(format);
+    char name[256];
+    plansplit split;
+    split.var = var;
+    split.first = fam.hists.size();
+    split.n = nsplit-1;
+    fam.splits.push_back(split);
+    for(int s=1; s<nsplit; s++){
+      snprintf(name,sizeof(name),form.c_str(),s);
+      fam.hists.push_back(freg->H1(name,name,x.nbins,x.low,x.up));
+      fam.xaxis.push_back(fam.xaxis[0]);
+      fam.yaxis.push_back(-1);
+    }
+    return;
+  }
+  planaxis& y = faxes[fam.yaxis[0]];
+  Split(family,var,nsplit,format,x.nbins,x.low,x.up,y.nbins,y.low,y.up);
+}
+
+/*!
+  Split a 2D family by the value of a variable, with a different binning for the split histograms
+  \param family the family
+  \param var the variable, rows with values below 1 only fill the inclusive histogram
+  \param nsplit the histograms are numbered 1 to nsplit-1, larger values go into the last one
+  \param format the name of the split histograms, with %d for the number
+*/
+void FillPlan::Split(int family, int var, int nsplit, const char* format, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup){
+  planfamily& fam = ffamilies[family];
+  if(fam.yaxis[0]<0){
+    cout << "can not split 1D family " << fam.hists[0]->GetName() << " with a 2D binning" << endl;
+    return;
+  }
+  //the format may be a buffer of Form, it is copied before the names are formatted
+  string form(format);
+  char name[256];
+  int xaxis = Axis(faxes[fam.xaxis[0]].var,nbinsx,xlow,xup);
+  int yaxis = Axis(faxes[fam.yaxis[0]].var,nbinsy,ylow,yup);
+  plansplit split;
+  split.var = var;
+  split.first = fam.hists.size();
+  split.n = nsplit-1;
+  fam.splits.push_back(split);
+  for(int s=1; s<nsplit; s++){
+    snprintf(name,sizeof(name),form.c_str(),s);
+    fam.hists.push_back(freg->H2(name,name,nbinsx,xlow,xup,nbinsy,ylow,yup));
+    fam.xaxis.push_back(xaxis);
+    fam.yaxis.push_back(yaxis);
+  }
+}
+
+/*!
+  Gate a family on a variable
+  \param family the family
+  \param var the variable
+  \param low the lower limit, included
+  \param up the upper limit, excluded
+*/
+void FillPlan::Gate(int family, int var, double low, double up){
+  plangate gate;
+  gate.var = var;
+  gate.kind = kWithin;
+  gate.low = low;
+  gate.up = up;
+  ffamilies[family].gates.push_back(gate);
+}
+
+/*!
+  Gate a family on a variable with an excluded lower limit
+  \param family the family
+  \param var the variable
+  \param low the lower limit, excluded
+*/
+void FillPlan::GateAbove(int family, int var, double low){
+  plangate gate;
+  gate.var = var;
+  gate.kind = kAbove;
+  gate.low = low;
+  gate.up = DBL_MAX;
+  ffamilies[family].gates.push_back(gate);
+}
+
+/*!
+  Fill the collected rows into the histograms and clear them.
+  The bin of each axis is computed once per row, as in TAxis::FindFixBin, the histograms are incremented directly.
+*/
+void FillPlan::Fill(){
+  if(fnrows==0)
+    return;
+  for(unsigned int a=0; a<faxes.size(); a++){
+    const planaxis& axis = faxes[a];
+    const double* values = fcolumns[axis.var].data();
+    fbins[a].resize(fnrows);
+    int* bins = fbins[a].data();
+    for(unsigned int r=0; r<fnrows; r++){
+      if(values[r]<axis.low)
+	bins[r] = 0;
+      else if(!(values[r]<axis.up))
+	bins[r] = axis.nbins+1;
+      else
+	bins[r] = 1 + (int)(axis.nbins*(values[r]-axis.low)/(axis.up-axis.low));
+    }
+  }
+  for(vector<planfamily>::iterator fam=ffamilies.begin(); fam!=ffamilies.end(); fam++){
+    for(unsigned int r=0; r<fnrows; r++){
+      bool pass = true;
+      for(vector<plangate>::iterator g=fam->gates.begin(); g!=fam->gates.end(); g++){
+	double v = fcolumns[g->var][r];
+	bool inside;
+	if(g->kind==kAbove)
+	  inside = v>g->low;
+	else
+	  inside = v>=g->low && v<g->up;
+	if(!inside){
+	  pass = false;
+	  break;
+	}
+      }
+      if(!pass)
+	continue;
+      Increment(*fam,0,r);
+      for(vector<plansplit>::iterator s=fam->splits.begin(); s!=fam->splits.end(); s++){
+	int v = (int)fcolumns[s->var][r];
+	if(v<1)
+	  continue;
+	if(v>s->n)
+	  v = s->n;
+	Increment(*fam,s->first+v-1,r);
+      }
+    }
+  }
+  for(unsigned int v=0; v<fcolumns.size(); v++)
+    fcolumns[v].clear();
+  fnrows = 0;
+}
+
+/*!
+  Increment a histogram of a family with a row
+  \param fam the family
+  \param h the histogram
+  \param r the row
+*/
+void FillPlan::Increment(planfamily& fam, int h, unsigned int r){
+  int xaxis = fam.xaxis[h];
+  int yaxis = fam.yaxis[h];
+  double x = fcolumns[faxes[xaxis].var][r];
+  if(yaxis<0)
+    fam.hists[h]->Increment(fbins[xaxis][r],0,x,0);
+  else
+    fam.hists[h]->Increment(fbins[xaxis][r],fbins[yaxis][r],x,fcolumns[faxes[yaxis].var][r]);
+}
+
+/*!
+  Print the variables, the number of axes, and the families with their histograms and gates
+*/
+void FillPlan::Print(){
+  cout << "fill plan with " << fnames.size() << " variables, " << faxes.size() << " axes, " << ffamilies.size() << " families" << endl;
+  for(vector<planfamily>::iterator fam=ffamilies.begin(); fam!=ffamilies.end(); fam++){
+    cout << fam->hists[0]->GetName() << "\t";
+    if(fam->yaxis[0]>-1)
+      cout << fnames[faxes[fam->yaxis[0]].var] << ":";
+    cout << fnames[faxes[fam->xaxis[0]].var];
+    for(vector<plansplit>::iterator s=fam->splits.begin(); s!=fam->splits.end(); s++)
+      cout << ", split by " << fnames[s->var] << " into " << s->n;
+    for(vector<plangate>::iterator g=fam->gates.begin(); g!=fam->gates.end(); g++){
+      if(g->kind==kAbove)
+	cout << ", " << fnames[g->var] << " > " << g->low;
+      else if(g->up==DBL_MAX)
+	cout << ", " << fnames[g->var] << " >= " << g->low;
+      else
+	cout << ", " << g->low << " <= " << fnames[g->var] << " < " << g->up;
+    }
+    cout << endl;
+  }
+}
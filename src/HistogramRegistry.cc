@@ -0,0 +1,295 @@
+#include "HistogramRegistry.hh"
+#include <iomanip>
+using namespace std;
+
+/*!
+  Family of a histogram, the name with each group of digits replaced by #
+  \param name the name of the histogram
+  \return the family
+*/
+static string Family(const char* name){
+  string family;
+  for(const char* c=name; *c!='\0'; c++){
+    if(*c>='0' && *c<='9'){
+      if(family.empty() || family[family.size()-1]!='#')
+	family += '#';
+    }
+    else
+      family += *c;
+  }
+  return family;
+}
+
+/*!
+  Constructor for a 1D histogram, nothing is allocated
+*/
+LazyHistogram::LazyHistogram(const char* name, const char* title, int nbinsx, double xlow, double xup){
+  fname = name;
+  ftitle = title;
+  ffamily = Family(name);
+  fdim = 1;
+  fnbins[0] = nbinsx;
+  flow[0] = xlow;
+  fup[0] = xup;
+  fnbins[1] = 0;
+  flow[1] = 0;
+  fup[1] = 0;
+  fsparseflag = false;
+  fh1 = NULL;
+  fh2 = NULL;
+  fsparse = NULL;
+  fbins = NULL;
+  fstride = 0;
+  fentries = 0;
+  for(int i=0;i<7;i++)
+    fstats[i] = 0;
+}
+
+/*!
+  Constructor for a 2D histogram, nothing is allocated
+*/
+LazyHistogram::LazyHistogram(const char* name, const char* title, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup, bool sparse){
+  fname = name;
+  ftitle = title;
+  ffamily = Family(name);
+  fdim = 2;
+  fnbins[0] = nbinsx;
+  flow[0] = xlow;
+  fup[0] = xup;
+  fnbins[1] = nbinsy;
+  flow[1] = ylow;
+  fup[1] = yup;
+  fsparseflag = sparse;
+  fh1 = NULL;
+  fh2 = NULL;
+  fsparse = NULL;
+  fbins = NULL;
+  fstride = 0;
+  fentries = 0;
+  for(int i=0;i<7;i++)
+    fstats[i] = 0;
+}
+
+/*!
+  Destructor
+*/
+LazyHistogram::~LazyHistogram(){
+  delete fh1;
+  delete fh2;
+  delete fsparse;
+}
+
+/*!
+  Allocate the histogram, it is not attached to any directory.
+  The bins of dense histograms without weights can be incremented directly.
+*/
+void LazyHistogram::Create(){
+  if(fdim==1){
+    fh1 = new TH1F(fname.c_str(),ftitle.c_str(),fnbins[0],flow[0],fup[0]);
+    fh1->SetDirectory(0);
+    if(fh1->GetSumw2N()==0)
+      fbins = fh1->GetArray();
+  }
+  else if(fsparseflag){
+    fsparse = new THnSparseF(fname.c_str(),ftitle.c_str(),2,fnbins,flow,fup);
+  }
+  else{
+    fh2 = new TH2F(fname.c_str(),ftitle.c_str(),fnbins[0],flow[0],fup[0],fnbins[1],flow[1],fup[1]);
+    fh2->SetDirectory(0);
+    if(fh2->GetSumw2N()==0)
+      fbins = fh2->GetArray();
+  }
+  fstride = fnbins[0]+2;
+}
+
+/*!
+  Add the entries and statistics of the direct increments to the histogram
+*/
+void LazyHistogram::Flush(){
+  if(fentries==0)
+    return;
+  TH1* h = fh1;
+  if(h==NULL)
+    h = fh2;
+  double stats[7];
+  h->GetStats(stats);
+  int nstats = fdim==1 ? 4 : 7;
+  for(int i=0;i<nstats;i++){
+    stats[i] += fstats[i];
+    fstats[i] = 0;
+  }
+  h->PutStats(stats);
+  h->SetEntries(h->GetEntries()+fentries);
+  fentries = 0;
+}
+
+/*!
+  Number of entries
+  \return the entries, 0 if the histogram was never filled
+*/
+double LazyHistogram::GetEntries(){
+  Flush();
+  if(fh1!=NULL)
+    return fh1->GetEntries();
+  if(fh2!=NULL)
+    return fh2->GetEntries();
+  if(fsparse!=NULL)
+    return fsparse->GetEntries();
+  return 0;
+}
+
+/*!
+  Memory of the bins of a TH1F or TH2F with this binning, including under- and overflows
+  \return bytes
+*/
+long long int LazyHistogram::GetDenseMemory(){
+  long long int ncells = fnbins[0]+2;
+  if(fdim==2)
+    ncells *= fnbins[1]+2;
+  return ncells*sizeof(float);
+}
+
+/*!
+  Memory of the bins as allocated, for sparse histograms the filled bins with their coordinates
+  \return bytes
+*/
+long long int LazyHistogram::GetMemory(){
+  if(fh1!=NULL || fh2!=NULL)
+    return GetDenseMemory();
+  if(fsparse!=NULL)
+    return fsparse->GetNbins()*(sizeof(float)+sizeof(long long int));
+  return 0;
+}
+
+/*!
+  Add another histogram with the same booking, a histogram that was never filled is created first
+  \param other the histogram to be added
+*/
+void LazyHistogram::Add(LazyHistogram* other){
+  if(!other->IsCreated())
+    return;
+  if(!IsCreated())
+    Create();
+  Flush();
+  other->Flush();
+  if(fh1!=NULL)
+    fh1->Add(other->fh1);
+  else if(fh2!=NULL)
+    fh2->Add(other->fh2);
+  else
+    fsparse->Add(other->fsparse);
+}
+
+/*!
+  Write the histogram into the current directory if it has entries, sparse histograms are written as TH2F
+*/
+void LazyHistogram::Write(){
+  if(GetEntries()<=0)
+    return;
+  if(fh1!=NULL)
+    fh1->Write("",TObject::kOverwrite);
+  else if(fh2!=NULL)
+    fh2->Write("",TObject::kOverwrite);
+  else if(fsparse!=NULL){
+    TH2F* h = new TH2F(fname.c_str(),ftitle.c_str(),fnbins[0],flow[0],fup[0],fnbins[1],flow[1],fup[1]);
+    h->SetDirectory(0);
+    int coord[2];
+    for(long long int i=0; i<fsparse->GetNbins(); i++){
+      double content = fsparse->GetBinContent(i,coord);
+      h->SetBinContent(h->GetBin(coord[0],coord[1]),content);
+    }
+    h->ResetStats();
+    h->SetEntries(fsparse->GetEntries());
+    h->Write("",TObject::kOverwrite);
+    delete h;
+  }
+}
+
+/*!
+  Constructor, no sparse histograms
+*/
+HistogramRegistry::HistogramRegistry(){
+  fsparsethresh = 0;
+}
+
+/*!
+  Destructor, deletes the histograms
+*/
+HistogramRegistry::~HistogramRegistry(){
+  for(vector<LazyHistogram*>::iterator h=fhists.begin(); h!=fhists.end(); h++)
+    delete *h;
+}
+
+/*!
+  Book a 1D histogram
+  \return the histogram, allocated on the first fill
+*/
+LazyHistogram* HistogramRegistry::H1(const char* name, const char* title, int nbinsx, double xlow, double xup){
+  fhists.push_back(new LazyHistogram(name,title,nbinsx,xlow,xup));
+  return fhists.back();
+}
+
+/*!
+  Book a 2D histogram, it is sparse if it has more bins than the sparse threshold
+  \return the histogram, allocated on the first fill
+*/
+LazyHistogram* HistogramRegistry::H2(const char* name, const char* title, int nbinsx, double xlow, double xup, int nbinsy, double ylow, double yup){
+  bool sparse = fsparsethresh>0 && (long long int)nbinsx*nbinsy>fsparsethresh;
+  fhists.push_back(new LazyHistogram(name,title,nbinsx,xlow,xup,nbinsy,ylow,yup,sparse));
+  return fhists.back();
+}
+
+/*!
+  Add the histograms of another registry, both must have booked the same histograms in the same order
+  \param other the registry to be added
+*/
+void HistogramRegistry::Add(HistogramRegistry* other){
+  if(other->fhists.size()!=fhists.size()){
+    cout << "can not add histogram registries with " << fhists.size() << " and " << other->fhists.size() << " histograms" << endl;
+    return;
+  }
+  for(unsigned int i=0; i<fhists.size(); i++)
+    fhists[i]->Add(other->fhists[i]);
+}
+
+/*!
+  Write the histograms with entries into the current directory
+*/
+void HistogramRegistry::Write(){
+  for(vector<LazyHistogram*>::iterator h=fhists.begin(); h!=fhists.end(); h++)
+    (*h)->Write();
+}
+
+/*!
+  Print the number of booked and allocated histograms and their memory, in total and for each family
+  \param perfamily print a line for each family
+*/
+void HistogramRegistry::MemoryReport(bool perfamily){
+  vector<string> order;
+  map<string, vector<long long int> > families;
+  vector<long long int> total(4,0);
+  for(vector<LazyHistogram*>::iterator h=fhists.begin(); h!=fhists.end(); h++){
+    string family = (*h)->GetFamily();
+    if(families.find(family)==families.end()){
+      order.push_back(family);
+      families[family] = vector<long long int>(4,0);
+    }
+    vector<long long int> cost(4,0);
+    cost[0] = 1;
+    cost[1] = (*h)->IsCreated();
+    cost[2] = (*h)->GetDenseMemory();
+    cost[3] = (*h)->GetMemory();
+    for(int i=0;i<4;i++){
+      families[family][i] += cost[i];
+      total[i] += cost[i];
+    }
+  }
+  if(perfamily){
+    cout << setw(40) << left << "family" << right << setw(8) << "booked" << setw(8) << "filled" << setw(12) << "dense MB" << setw(12) << "used MB" << endl;
+    for(vector<string>::iterator f=order.begin(); f!=order.end(); f++){
+      vector<long long int>& cost = families[*f];
+      cout << setw(40) << left << *f << right << setw(8) << cost[0] << setw(8) << cost[1] << setw(12) << setprecision(1) << fixed << cost[2]/1048576. << setw(12) << cost[3]/1048576. << endl;
+    }
+  }
+  cout << total[1] << " of " << total[0] << " histograms filled, " << setprecision(1) << fixed << total[3]/1048576. << " MB used instead of " << total[2]/1048576. << " MB" << endl;
+}
@@ -0,0 +1,267 @@
+#include "ParameterBundle.hh"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <thread>
+using namespace std;
+
+//! identifier at the start of a bundle file
+static const char kBundleMagic[8] = {'S','A','L','V','P','A','R','\0'};
+//! version of the file layout, bundles of other versions are rebuilt
+static const unsigned int kBundleVersion = 1;
+
+/*!
+  Constructor
+  \param filename the bundle file
+*/
+ParameterBundle::ParameterBundle(string filename){
+  ffilename = filename;
+  fmap = NULL;
+  fmapsize = 0;
+}
+
+/*!
+  Destructor, unmaps the file
+*/
+ParameterBundle::~ParameterBundle(){
+  Unmap();
+}
+
+/*!
+  Release the mapped file
+*/
+void ParameterBundle::Unmap(){
+  if(fmap!=NULL)
+    munmap(fmap, fmapsize);
+  fmap = NULL;
+  fmapsize = 0;
+  findex.clear();
+}
+
+/*!
+  Map the bundle file and check the version and the source files.
+  A source is unchanged if its modification time and size are the same, or if its content has the same hash.
+  \return true if the bundle can be used
+*/
+bool ParameterBundle::Load(){
+  Unmap();
+  int fd = open(ffilename.c_str(), O_RDONLY);
+  if(fd<0)
+    return false;
+  struct stat st;
+  if(fstat(fd, &st)<0 || st.st_size<(long long int)(sizeof(kBundleMagic)+3*sizeof(unsigned int))){
+    close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map==MAP_FAILED)
+    return false;
+  fmap = (char*)map;
+  fmapsize = st.st_size;
+
+  long long int pos = 0;
+  unsigned int version, nsources, narrays;
+  if(memcmp(fmap, kBundleMagic, sizeof(kBundleMagic))!=0){
+    cout << "parameter bundle " << ffilename << " has a wrong format" << endl;
+    Unmap();
+    return false;
+  }
+  pos += sizeof(kBundleMagic);
+  memcpy(&version, fmap+pos, sizeof(version));
+  pos += sizeof(version);
+  if(version!=kBundleVersion){
+    cout << "parameter bundle " << ffilename << " has version " << version << ", expected " << kBundleVersion << endl;
+    Unmap();
+    return false;
+  }
+  memcpy(&nsources, fmap+pos, sizeof(nsources));
+  pos += sizeof(nsources);
+  memcpy(&narrays, fmap+pos, sizeof(narrays));
+  pos += sizeof(narrays);
+
+  for(unsigned int i=0; i<nsources; i++){
+    bundlesource src;
+    unsigned int len;
+    if(pos+(long long int)sizeof(len)>fmapsize){
+      Unmap();
+      return false;
+    }
+    memcpy(&len, fmap+pos, sizeof(len));
+    pos += sizeof(len);
+    if(pos+len+2*sizeof(long long int)+sizeof(unsigned long long int)>(unsigned long long int)fmapsize){
+      Unmap();
+      return false;
+    }
+    src.name = string(fmap+pos, len);
+    pos += len;
+    memcpy(&src.mtime, fmap+pos, sizeof(src.mtime));
+    pos += sizeof(src.mtime);
+    memcpy(&src.size, fmap+pos, sizeof(src.size));
+    pos += sizeof(src.size);
+    memcpy(&src.hash, fmap+pos, sizeof(src.hash));
+    pos += sizeof(src.hash);
+    struct stat sst;
+    if(stat(src.name.c_str(), &sst)<0){
+      cout << "source " << src.name << " of parameter bundle " << ffilename << " not found" << endl;
+      Unmap();
+      return false;
+    }
+    if((long long int)sst.st_mtime==src.mtime && (long long int)sst.st_size==src.size)
+      continue;
+    if(Hash(src.name.c_str())!=src.hash){
+      cout << "source " << src.name << " of parameter bundle " << ffilename << " has changed" << endl;
+      Unmap();
+      return false;
+    }
+  }
+
+  for(unsigned int i=0; i<narrays; i++){
+    unsigned int len, n;
+    if(pos+(long long int)sizeof(len)>fmapsize){
+      Unmap();
+      return false;
+    }
+    memcpy(&len, fmap+pos, sizeof(len));
+    pos += sizeof(len);
+    if(pos+len+sizeof(n)>(unsigned long long int)fmapsize){
+      Unmap();
+      return false;
+    }
+    string name(fmap+pos, len);
+    pos += len;
+    memcpy(&n, fmap+pos, sizeof(n));
+    pos += sizeof(n);
+    if(pos+n*sizeof(double)>(unsigned long long int)fmapsize){
+      Unmap();
+      return false;
+    }
+    findex[name] = make_pair(pos, n);
+    pos += n*sizeof(double);
+  }
+  return true;
+}
+
+/*!
+  Add a source file, its modification time, size, and hash are recorded when the bundle is written
+  \param filename the source file
+*/
+void ParameterBundle::AddSource(const char* filename){
+  bundlesource src;
+  src.name = filename;
+  src.mtime = 0;
+  src.size = 0;
+  src.hash = 0;
+  fsources.push_back(src);
+}
+
+/*!
+  Store an array to be written
+  \param name the name of the array
+  \param values the values
+  \param n the number of values
+*/
+void ParameterBundle::Set(const char* name, const double* values, unsigned int n){
+  farrays[name] = vector<double>(values, values+n);
+}
+
+/*!
+  Number of values of a loaded array
+  \param name the name of the array
+  \return the number of values, 0 if the array is not present
+*/
+unsigned int ParameterBundle::GetSize(const char* name){
+  map<string, pair<long long int, unsigned int> >::iterator it = findex.find(name);
+  if(it==findex.end())
+    return 0;
+  return it->second.second;
+}
+
+/*!
+  Copy a loaded array
+  \param name the name of the array
+  \param values the destination
+  \param n the expected number of values
+  \return false if the array is not present or has a different size
+*/
+bool ParameterBundle::Get(const char* name, double* values, unsigned int n){
+  map<string, pair<long long int, unsigned int> >::iterator it = findex.find(name);
+  if(it==findex.end() || it->second.second!=n)
+    return false;
+  memcpy(values, fmap+it->second.first, n*sizeof(double));
+  return true;
+}
+
+/*!
+  Write the bundle file, it is written to a temporary file of this process and thread first and renamed, so that parallel jobs never see a partial bundle
+  \return true if successful
+*/
+bool ParameterBundle::Write(){
+  string tmpname = ffilename + "." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+  ofstream out(tmpname.c_str(), ios::binary);
+  if(!out.good()){
+    cout << "could not write parameter bundle " << ffilename << endl;
+    return false;
+  }
+  unsigned int nsources = fsources.size();
+  unsigned int narrays = farrays.size();
+  out.write(kBundleMagic, sizeof(kBundleMagic));
+  out.write((const char*)&kBundleVersion, sizeof(kBundleVersion));
+  out.write((const char*)&nsources, sizeof(nsources));
+  out.write((const char*)&narrays, sizeof(narrays));
+  for(vector<bundlesource>::iterator src=fsources.begin(); src!=fsources.end(); src++){
+    struct stat sst;
+    if(stat(src->name.c_str(), &sst)==0){
+      src->mtime = sst.st_mtime;
+      src->size = sst.st_size;
+    }
+    src->hash = Hash(src->name.c_str());
+    unsigned int len = src->name.size();
+    out.write((const char*)&len, sizeof(len));
+    out.write(src->name.data(), len);
+    out.write((const char*)&src->mtime, sizeof(src->mtime));
+    out.write((const char*)&src->size, sizeof(src->size));
+    out.write((const char*)&src->hash, sizeof(src->hash));
+  }
+  for(map<string, vector<double> >::iterator arr=farrays.begin(); arr!=farrays.end(); arr++){
+    unsigned int len = arr->first.size();
+    unsigned int n = arr->second.size();
+    out.write((const char*)&len, sizeof(len));
+    out.write(arr->first.data(), len);
+    out.write((const char*)&n, sizeof(n));
+    out.write((const char*)arr->second.data(), n*sizeof(double));
+  }
+  out.close();
+  if(!out.good() || rename(tmpname.c_str(), ffilename.c_str())!=0){
+    cout << "could not write parameter bundle " << ffilename << endl;
+    remove(tmpname.c_str());
+    return false;
+  }
+  return true;
+}
+
+/*!
+  Hash of the content of a file, 64 bit FNV-1a
+  \param filename the file
+  \return the hash, 0 if the file can not be read
+*/
+unsigned long long int ParameterBundle::Hash(const char* filename){
+  ifstream in(filename, ios::binary);
+  if(!in.good())
+    return 0;
+  unsigned long long int hash = 14695981039346656037ULL;
+  char buffer[4096];
+  while(in.good()){
+    in.read(buffer, sizeof(buffer));
+    streamsize n = in.gcount();
+    for(streamsize i=0; i<n; i++){
+      hash ^= (unsigned char)buffer[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
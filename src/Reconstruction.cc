@@ -12,15 +12,23 @@ Reconstruction::Reconstruction(char* settings){
   double pp[3] = {-fset->MINOSlength()/2, 0, fset->MINOSlength()/2};
   double bb[3] = {fset->BetaBefore(), fbeta, fset->BetaAfter()};
   TGraph *gbeta = new TGraph(3,pp,bb);
+  fminos = NULL;
   if(fset->MINOSlength()>0){
     fminos = new TF1("fminos","pol2",-fset->MINOSlength()/2,fset->MINOSlength()/2);
     gbeta->Fit(fminos,"Rn");
+    fdoppler.SetBetaParameters(fminos->GetParameter(0),fminos->GetParameter(1),fminos->GetParameter(2));
   }
+  else
+    fdoppler.SetBetaParameters(fbeta,0,0);
   
-  ReadBadChannels(fset->BadChFile());
-  ReadPositions(fset->DALIPosFile());
-  if(fset->DoReCalibration())
-    ReadReCalParams(fset->ReCalFile());
+  if(!ReadBundle(settings)){
+    ReadBadChannels(fset->BadChFile());
+    ReadPositions(fset->DALIPosFile());
+    if(fset->DoReCalibration())
+      ReadReCalParams(fset->ReCalFile());
+    WriteBundle(settings);
+  }
+  BuildGeometry();
   if(fset->VerboseLevel()>1){
     for(unsigned short i=0;i<fpositions.size();i++){
       cout << i << "\t" << fpositions[i][0]<< "\t" << fpositions[i][1]<< "\t" << fpositions[i][2]<<endl;
@@ -40,9 +48,13 @@ void Reconstruction::ReadBadChannels(const char* infile){
   TEnv* bad = new TEnv(infile);
   unsigned short nbad = bad->GetValue("Number.Bad.Channels",0);
   fbad.resize(nbad);
+  fbadch.reset();
   for(int i=0;i<nbad;i++){
     fbad.at(i) = bad->GetValue(Form("Bad.Channel.%d",i),-1);
+    if(fbad.at(i)<MAXNCRYSTAL)
+      fbadch.set(fbad.at(i));
   }
+  delete bad;
 }
 
 /*!
@@ -59,6 +71,7 @@ void Reconstruction::ReadReCalParams(const char* infile){
     r.at(2) = cal->GetValue(Form("DALI.%d.Parameter.2",i),0.0);
     frecal.push_back(r);
   }
+  delete cal;
 }
 
 /*!
@@ -75,6 +88,112 @@ void Reconstruction::ReadPositions(const char* infile){
     r.at(2) = pos->GetValue(Form("Average.Position.Z.%d",i),0.0);
     fpositions.push_back(r);
   }
+  delete pos;
+}
+
+/*!
+  Read the bad channels, positions, and recalibration from the parameter bundle compiled from the settings file, settings.dali.bundle
+  \param settings the settings file
+  \return false if there is no bundle or the settings or any of the files given in them have changed
+*/
+bool Reconstruction::ReadBundle(char* settings){
+  if(settings == NULL)
+    return false;
+  ParameterBundle bundle(string(settings) + ".dali.bundle");
+  if(!bundle.Load())
+    return false;
+  vector<double> bad(bundle.GetSize("DALI.Bad"));
+  vector<double> pos(MAXNCRYSTAL*3);
+  vector<double> recal(MAXNCRYSTAL*3);
+  bool ok = bad.size()==0 || bundle.Get("DALI.Bad", bad.data(), bad.size());
+  ok = ok && bundle.Get("DALI.Positions", pos.data(), pos.size());
+  if(fset->DoReCalibration())
+    ok = ok && bundle.Get("DALI.ReCal", recal.data(), recal.size());
+  if(!ok){
+    cout << "parameter bundle " << bundle.GetFileName() << " is incomplete" << endl;
+    return false;
+  }
+  fbad.resize(bad.size());
+  fbadch.reset();
+  for(unsigned short i=0;i<bad.size();i++){
+    fbad[i] = bad[i];
+    if(fbad[i]<MAXNCRYSTAL)
+      fbadch.set(fbad[i]);
+  }
+  fpositions.assign(MAXNCRYSTAL, vector<double>(3));
+  for(int i=0;i<MAXNCRYSTAL;i++)
+    for(int j=0;j<3;j++)
+      fpositions[i][j] = pos[i*3+j];
+  if(fset->DoReCalibration()){
+    frecal.assign(MAXNCRYSTAL, vector<double>(3));
+    for(int i=0;i<MAXNCRYSTAL;i++)
+      for(int j=0;j<3;j++)
+	frecal[i][j] = recal[i*3+j];
+  }
+  if(fset->VerboseLevel()>0)
+    cout << "bad channels, positions, and recalibration read from " << bundle.GetFileName() << endl;
+  return true;
+}
+
+/*!
+  Compile the bad channels, positions, and recalibration into the parameter bundle settings.dali.bundle
+  \param settings the settings file
+*/
+void Reconstruction::WriteBundle(char* settings){
+  if(settings == NULL)
+    return;
+  ParameterBundle bundle(string(settings) + ".dali.bundle");
+  bundle.AddSource(settings);
+  bundle.AddSource(fset->BadChFile());
+  bundle.AddSource(fset->DALIPosFile());
+  if(fset->DoReCalibration())
+    bundle.AddSource(fset->ReCalFile());
+  vector<double> bad(fbad.begin(), fbad.end());
+  vector<double> pos;
+  for(unsigned short i=0;i<fpositions.size();i++)
+    pos.insert(pos.end(), fpositions[i].begin(), fpositions[i].end());
+  bundle.Set("DALI.Bad", bad);
+  bundle.Set("DALI.Positions", pos);
+  if(fset->DoReCalibration()){
+    vector<double> recal;
+    for(unsigned short i=0;i<frecal.size();i++)
+      recal.insert(recal.end(), frecal[i].begin(), frecal[i].end());
+    bundle.Set("DALI.ReCal", recal);
+  }
+  if(bundle.Write())
+    cout << "bad channels, positions, and recalibration compiled into " << bundle.GetFileName() << endl;
+}
+
+/*!
+  Pass the positions of the crystals to the Doppler kernel and precompute, for the addback type, distance and angle of the settings, which pairs of crystals are neighbours. The positions of the hits are the average positions of their crystal, so the spatial addback condition is a lookup per pair.
+*/
+void Reconstruction::BuildGeometry(){
+  fdoppler.SetGeometry(fpositions);
+  fneighbours.assign(MAXNCRYSTAL, bitset<MAXNCRYSTAL>());
+  vector<TVector3> pos(MAXNCRYSTAL);
+  for(int i=0;i<MAXNCRYSTAL && i<(int)fpositions.size();i++)
+    pos[i].SetXYZ(fpositions[i][0],fpositions[i][1],fpositions[i][2]);
+  int type = fset->AddbackType();
+  double distance = fset->AddbackDistance();
+  double angle = fset->AddbackAngle()*TMath::Pi()/180.;
+  int npairs = 0;
+  for(int i=0;i<MAXNCRYSTAL;i++){
+    for(int j=i;j<MAXNCRYSTAL;j++){
+      bool close = false;
+      if(type==1)
+	close = pos[i].DeltaR(pos[j])<distance;
+      else if(type==2)
+	close = pos[i].Angle(pos[j])<angle;
+      if(close){
+	fneighbours[i].set(j);
+	fneighbours[j].set(i);
+	if(i!=j)
+	  npairs++;
+      }
+    }
+  }
+  if(fset->VerboseLevel()>1)
+    cout << npairs << " pairs of neighbouring crystals for addback type " << type << endl;
 }
 
 /*!
@@ -121,12 +240,8 @@ vector<DALIHit*> Reconstruction::FilterBadHits(vector<DALIHit*> hits){
   vector<DALIHit*> output;
   for(unsigned short i=0;i<hits.size();i++){
     if(hits.at(i)->GetEnergy()<fset->Overflow() && hits.at(i)->GetEnergy()> fset->Underflow()){
-      bool bad = false;
-      for(unsigned short j=0;j<fbad.size();j++){
-	if(hits.at(i)->GetID()==fbad.at(j))
-	  bad = true;
-      }
-      if(!bad)
+      short id = hits.at(i)->GetID();
+      if(id<0 || id>=MAXNCRYSTAL || !fbadch[id])
 	output.push_back(hits.at(i));
     }
   }
@@ -179,97 +294,74 @@ bool Reconstruction::Addback(DALIHit* hit0, DALIHit* hit1){
   if(tdiff < fset->AddbackTimeDiff(0) || tdiff > fset->AddbackTimeDiff(1))
     return false;
 
-  if(fset->AddbackType()==1){
-    if(hit0->GetPos().DeltaR(hit1->GetPos())<fset->AddbackDistance())
-      return true;
-  }
-  else if(fset->AddbackType()==2){
-    if(hit0->GetPos().Angle(hit1->GetPos())<fset->AddbackAngle()*TMath::Pi()/180.)
-      return true;
-  }
-  return false;
+  //the positions are the average positions of the crystals, the distance or angle is precomputed
+  short id0 = hit0->GetID();
+  short id1 = hit1->GetID();
+  if(id0<0 || id0>=MAXNCRYSTAL || id1<0 || id1>=MAXNCRYSTAL)
+    return false;
+  return fneighbours[id0][id1];
 }
 
 /*!
-  Addback
-  \param hits a vector with the energy sorted hits
-  \return a vector with the addback hits
+  Group the hits into addback clusters. The hits are taken as seeds in the order of decreasing energy, a cluster contains all unassigned hits above the addback threshold that can be reached from its seed through pairs accepted by Addback(hit0, hit1).
+  \param hits the hits
 */
-vector<DALIHit*> Reconstruction::Addback(vector<DALIHit*> hits){
-  vector<DALIHit*> hitsAB;
-  vector<DALIHit*> unusedhits;
-  for(unsigned short i=0;i<hits.size();i++){
-    short id = hits.at(i)->GetID();
-    double en = hits.at(i)->GetEnergy();
-    double DCen = hits.at(i)->GetDCEnergy();
-    TVector3 pos = hits.at(i)->GetPos();
-    double time = hits.at(i)->GetTime();
-    double toffset = hits.at(i)->GetTOffset();
-    unsigned short hitsadded = hits.at(i)->GetHitsAdded();
-    unusedhits.push_back(new DALIHit(id, en, DCen, pos, time, toffset, hitsadded));
-  }
-  unusedhits = Revert(unusedhits);
-
-  while(unusedhits.size() > 0){
-    //first one is automatically good
-    vector<DALIHit*> currenthits; //current hits contains all hits that have already been added to thishit, to still know their positions
-    currenthits.push_back(unusedhits.back());
-    DALIHit* thishit = unusedhits.back();
-    unusedhits.pop_back();
-    
-    // how many hits added
-    int added = 0;
-    do{
-      added =0;
-      int addme =-1;
-      bool found = false;
-      for(unsigned short k=0;k<currenthits.size();k++){
-	for(unsigned short j=0;j<unusedhits.size();j++){
-	  if(unusedhits.at(j)->GetEnergy()<fset->AddbackThresh())
-	    continue;
-	  if(Addback(currenthits.at(k),unusedhits.at(j))){	    
-	    addme = j;
-	    found = true;
-	    break;
-	  }
-	}//loop unused hits
-	if(found)
-	  break;
-      }//loop add back hits
-      if(found && addme >-1){
-	added++;
-	currenthits.push_back(unusedhits.at(addme));
-	thishit->AddBackHit(unusedhits.at(addme));
-	unusedhits.erase(unusedhits.begin() + addme);
-      }
-      if(hits.size()==0)
-	break;
-    }while(added>0);//do
-    //done with addback for thishit
-    if(fset->VerboseLevel()>2){
-      cout << "current hits" << endl;
-      for(unsigned short k=0;k<currenthits.size();k++){
-	currenthits.at(k)->Print();
-      }
-      cout << "unused hits" << endl;
-      for(unsigned short k=0;k<unusedhits.size();k++){
-	unusedhits.at(k)->Print();
+void Reconstruction::Cluster(const vector<DALIHit*>& hits){
+  unsigned short n = hits.size();
+  double thresh = fset->AddbackThresh();
+  forder.resize(n);
+  for(unsigned short i=0;i<n;i++)
+    forder[i] = i;
+  stable_sort(forder.begin(), forder.end(), IndexComparer(hits));
+  fcluster.assign(n, -1);
+  fseeds.clear();
+  for(unsigned short s=0;s<n;s++){
+    unsigned short seed = forder[s];
+    if(fcluster[seed]>-1)
+      continue;
+    short c = fseeds.size();
+    fseeds.push_back(seed);
+    fcluster[seed] = c;
+    fstack.clear();
+    fstack.push_back(seed);
+    while(!fstack.empty()){
+      unsigned short m = fstack.back();
+      fstack.pop_back();
+      for(unsigned short j=0;j<n;j++){
+	if(fcluster[j]>-1 || hits[j]->GetEnergy()<thresh)
+	  continue;
+	if(Addback(hits[m],hits[j])){
+	  fcluster[j] = c;
+	  fstack.push_back(j);
+	}
       }
-      cout << "this hit" <<endl;
-      thishit->Print();
     }
-    //add the addbacked hit into the vector
-    hitsAB.push_back(thishit);
-  }//while
-  
+  }
+}
+
+/*!
+  Addback, the hits after addback are copies of the seeds with the energies of the other hits in the cluster added, they are taken from the pool of the DALI object
+  \param dali the DALI object, the hits are replaced by the addback hits
+*/
+void Reconstruction::Addback(DALI* dali){
+  const vector<DALIHit*>& hits = dali->GetHits();
+  Cluster(hits);
+  dali->ClearAddback();
+  fhitsAB.clear();
+  for(unsigned short c=0;c<fseeds.size();c++)
+    fhitsAB.push_back(dali->NewHit(hits[fseeds[c]]));
+  for(unsigned short i=0;i<forder.size();i++){
+    unsigned short h = forder[i];
+    if(fseeds[fcluster[h]]!=h)
+      fhitsAB[fcluster[h]]->AddBackHit(hits[h]);
+  }
   if(fset->VerboseLevel()>2){
     cout << "after addback " << endl;
-    for(unsigned short k=0;k<hitsAB.size();k++){
-      hitsAB.at(k)->Print();
+    for(unsigned short k=0;k<fhitsAB.size();k++){
+      fhitsAB.at(k)->Print();
     }
   }
-
-  return hitsAB;
+  dali->SetABHits(fhitsAB);
 }
 
 /*!
@@ -292,23 +384,129 @@ void Reconstruction::SetPositions(DALI* dali){
 }
 
 /*!
-  Do the Doppler correction
+  Process the DALI hits in place: bad channels, over and underflows, and hits outside the timing gate are removed and returned to the pool, the remaining ones are recalibrated if requested, get their positions, and are sorted by energy. The addback hits are built from them and sorted.
+  \param dali the DALI object
+  \param recalibrate apply the recalibration parameters to the energies
+*/
+void Reconstruction::Process(DALI* dali, bool recalibrate){
+  double overflow = fset->Overflow();
+  double underflow = fset->Underflow();
+  double tlow = fset->TimingGate(0);
+  double thigh = fset->TimingGate(1);
+  fkept.clear();
+  const vector<DALIHit*>& hits = dali->GetHits();
+  for(vector<DALIHit*>::const_iterator it=hits.begin(); it!=hits.end(); it++){
+    DALIHit* hit = *it;
+    short id = hit->GetID();
+    double en = hit->GetEnergy();
+    double toffset = hit->GetTOffset();
+    if(id<0 || id>=MAXNCRYSTAL){
+      cout << "invalid ID in DALI: " << id <<endl;
+      hit->Print();
+      dali->Recycle(hit);
+      continue;
+    }
+    //hits without ADC or TDC value have NaN energy or time and fail the positive comparisons
+    if(fbadch[id] || !(en<overflow && en>underflow && toffset>tlow && toffset<thigh)){
+      dali->Recycle(hit);
+      continue;
+    }
+    if(recalibrate)
+      hit->SetEnergy(frecal[id][0] + frecal[id][1]*en + frecal[id][2]*en*en);
+    hit->SetPos(fpositions[id][0],fpositions[id][1],fpositions[id][2]);
+    fkept.push_back(hit);
+  }
+  sort(fkept.begin(), fkept.end(), HitComparer());
+  dali->SetHits(fkept);
+
+  Addback(dali);
+  sort(fhitsAB.begin(), fhitsAB.end(), HitComparer());
+  dali->SetABHits(fhitsAB);
+}
+
+/*!
+  Copy the IDs and energies of the hits followed by the addback hits into the batch for the Doppler kernel. Hits with an invalid crystal ID are left out, the kernel looks up the geometry by ID.
+  \param dali the DALI object
+*/
+void Reconstruction::FillBatch(DALI* dali){
+  const vector<DALIHit*>& hits = dali->GetHits();
+  const vector<DALIHit*>& hitsAB = dali->GetHitsAB();
+  fbatchid.clear();
+  fbatchen.clear();
+  for(vector<DALIHit*>::const_iterator hit=hits.begin(); hit!=hits.end(); hit++){
+    short id = (*hit)->GetID();
+    if(id<0 || id>=MAXNCRYSTAL){
+      cout << "invalid ID in DALI: " << id << ", no Doppler correction" << endl;
+      continue;
+    }
+    fbatchid.push_back(id);
+    fbatchen.push_back((*hit)->GetEnergy());
+  }
+  for(vector<DALIHit*>::const_iterator hit=hitsAB.begin(); hit!=hitsAB.end(); hit++){
+    short id = (*hit)->GetID();
+    if(id<0 || id>=MAXNCRYSTAL){
+      cout << "invalid ID in DALI addback: " << id << ", no Doppler correction" << endl;
+      continue;
+    }
+    fbatchid.push_back(id);
+    fbatchen.push_back((*hit)->GetEnergy());
+  }
+  fbatchdc.resize(fbatchid.size());
+}
+
+/*!
+  Copy the Doppler corrected energies from the batch back to the hits and addback hits, hits with an invalid crystal ID get NaN
+  \param dali the DALI object
+*/
+void Reconstruction::ReadBatch(DALI* dali){
+  const vector<DALIHit*>& hits = dali->GetHits();
+  const vector<DALIHit*>& hitsAB = dali->GetHitsAB();
+  unsigned int n = 0;
+  for(vector<DALIHit*>::const_iterator hit=hits.begin(); hit!=hits.end(); hit++){
+    short id = (*hit)->GetID();
+    if(id<0 || id>=MAXNCRYSTAL)
+      (*hit)->SetDCEnergy(sqrt(-1.));
+    else
+      (*hit)->SetDCEnergy(fbatchdc[n++]);
+  }
+  for(vector<DALIHit*>::const_iterator hit=hitsAB.begin(); hit!=hitsAB.end(); hit++){
+    short id = (*hit)->GetID();
+    if(id<0 || id>=MAXNCRYSTAL)
+      (*hit)->SetDCEnergy(sqrt(-1.));
+    else
+      (*hit)->SetDCEnergy(fbatchdc[n++]);
+  }
+}
+
+/*!
+  Do the Doppler correction, the hits must have the average positions of their crystals, as set by Process or SetPositions
   \param dali the input DALI object
 */
 void Reconstruction::DopplerCorrect(DALI* dali){
-  dali->DopplerCorrect(fbeta);
+  FillBatch(dali);
+  fbatchpar.assign(fbatchid.size(), fbeta);
+  fdoppler.Correct(fbatchid.size(), fbatchid.data(), fbatchen.data(), fbatchpar.data(), fbatchdc.data());
+  ReadBatch(dali);
 }
 
 /*!
-  Do the Doppler correction including the target positons
+  Do the Doppler correction including the target positons, the hits must have the average positions of their crystals, as set by Process or SetPositions. The positions of the hits are shifted by the reaction point, as before.
   \param dali the input DALI object
   \param zreac the reaction point in the target
   \return event by events beta
 */
 double Reconstruction::DopplerCorrect(DALI* dali, double zreac){
-  double beta = fminos->Eval(zreac);
-  //cout << fbeta <<"\t" << beta << "\t" << zreac << endl;
-  dali->DopplerCorrect(beta,zreac);
+  double beta = fdoppler.Beta(zreac);
+  FillBatch(dali);
+  fbatchpar.assign(fbatchid.size(), zreac);
+  fdoppler.CorrectVertex(fbatchid.size(), fbatchid.data(), fbatchen.data(), fbatchpar.data(), fbatchdc.data());
+  ReadBatch(dali);
+  const vector<DALIHit*>& hits = dali->GetHits();
+  const vector<DALIHit*>& hitsAB = dali->GetHitsAB();
+  for(vector<DALIHit*>::const_iterator hit=hits.begin(); hit!=hits.end(); hit++)
+    (*hit)->SetPos((*hit)->GetPos() - TVector3(0,0,zreac));
+  for(vector<DALIHit*>::const_iterator hit=hitsAB.begin(); hit!=hitsAB.end(); hit++)
+    (*hit)->SetPos((*hit)->GetPos() - TVector3(0,0,zreac));
   return beta;
 }
 
@@ -0,0 +1,269 @@
+#include "StreamReader.hh"
+using namespace std;
+
+/*!
+  Constructor, sets up the ring buffer and the branch addresses of the tree
+  \param tr the input tree
+  \param type the type of the stream, see streamID
+  \param depth number of entries to be decoded ahead
+*/
+StreamReader::StreamReader(TTree* tr, int type, unsigned int depth){
+  ftr = tr;
+  ftype = type;
+  fentries = ftr->GetEntries();
+  ffirst = 0;
+  fend = fentries;
+  if(depth<1)
+    depth = 1;
+  fring.resize(depth);
+  for(unsigned int i=0;i<depth;i++){
+    streamentry* slot = &fring[i];
+    slot->entry = 0;
+    slot->status = 0;
+    slot->TS = 0;
+    slot->beam = NULL;
+    for(unsigned short f=0;f<NFPLANES;f++)
+      slot->fp[f] = NULL;
+    slot->wasabi = NULL;
+    slot->eurica = NULL;
+    switch(ftype){
+    case kBigRIPS:
+      slot->beam = new Beam;
+      for(unsigned short f=0;f<NFPLANES;f++)
+	slot->fp[f] = new FocalPlane;
+      break;
+    case kWASABI:
+      slot->wasabi = new WASABI;
+      break;
+    case kEURICA:
+      slot->eurica = new EURICA;
+      break;
+    default:
+      break;
+    }
+  }
+  fhead = 0;
+  fcount = 0;
+  fstop = false;
+  fdone = false;
+  freadtime = 0;
+
+  fTS = 0;
+  fbeam = fring[0].beam;
+  for(unsigned short f=0;f<NFPLANES;f++)
+    ffp[f] = fring[0].fp[f];
+  fwasabi = fring[0].wasabi;
+  fEUeventinfo = NULL;
+  fEUcluster = NULL;
+  fEUclusterAB = NULL;
+  switch(ftype){
+  case kBigRIPS:
+    ftr->SetBranchAddress("timestamp",&fTS);
+    ftr->SetBranchAddress("beam",&fbeam);
+    for(unsigned short f=0;f<NFPLANES;f++){
+      ftr->SetBranchAddress(Form("fp%d",fpID[f]),&ffp[f]);
+    }
+    break;
+  case kWASABI:
+    ftr->SetBranchAddress("timestamp",&fTS);
+    ftr->SetBranchAddress("wasabi",&fwasabi);
+    break;
+  case kEURICA:
+    ftr->SetBranchAddress("EventInfo",&fEUeventinfo);
+    ftr->SetBranchAddress("GeCluster",&fEUcluster);
+    ftr->SetBranchAddress("GeAddback",&fEUclusterAB);
+    break;
+  default:
+    break;
+  }
+}
+
+/*!
+  Destructor, stops the thread and deletes the buffered objects
+*/
+StreamReader::~StreamReader(){
+  Stop();
+  for(unsigned int i=0;i<fring.size();i++){
+    delete fring[i].beam;
+    for(unsigned short f=0;f<NFPLANES;f++)
+      delete fring[i].fp[f];
+    delete fring[i].wasabi;
+    delete fring[i].eurica;
+  }
+}
+
+/*!
+  Start the reader thread
+  \param first the first entry to be read
+  \param end the entry after the last one to be read
+*/
+void StreamReader::Start(unsigned int first, unsigned int end){
+  Stop();
+  ffirst = first;
+  fend = min(end, fentries);
+  fhead = 0;
+  fcount = 0;
+  fstop = false;
+  fdone = false;
+  fthread = thread(&StreamReader::Run, this);
+}
+
+/*!
+  Stop the reader thread, entries not yet consumed are discarded
+*/
+void StreamReader::Stop(){
+  if(!fthread.joinable())
+    return;
+  {
+    lock_guard<mutex> lock(fmutex);
+    fstop = true;
+  }
+  fnotfull.notify_all();
+  fthread.join();
+}
+
+/*!
+  Wait for the next decoded entry, the entry stays in the buffer until Pop is called
+  \return the entry, NULL if the end of the tree has been reached
+*/
+streamentry* StreamReader::Peek(){
+  unique_lock<mutex> lock(fmutex);
+  while(fcount==0 && !fdone)
+    fnotempty.wait(lock);
+  if(fcount==0)
+    return NULL;
+  return &fring[fhead];
+}
+
+/*!
+  Release the oldest entry, its slot is reused by the reader thread
+*/
+void StreamReader::Pop(){
+  {
+    lock_guard<mutex> lock(fmutex);
+    if(fcount==0)
+      return;
+    fhead = (fhead+1)%fring.size();
+    fcount--;
+  }
+  fnotfull.notify_one();
+}
+
+/*!
+  Time spent reading the tree
+  \return the time spent in TTree::GetEvent by the reader thread, in s
+*/
+double StreamReader::GetReadTime(){
+  lock_guard<mutex> lock(fmutex);
+  return freadtime;
+}
+
+/*!
+  Loop of the reader thread, decode entries until the end of the tree, a faulty entry, or a stop request
+*/
+void StreamReader::Run(){
+  for(unsigned int entry=ffirst; entry<fend; entry++){
+    streamentry* slot;
+    {
+      unique_lock<mutex> lock(fmutex);
+      while(fcount==fring.size() && !fstop)
+	fnotfull.wait(lock);
+      if(fstop)
+	return;
+      //the consumer only moves fhead and fcount together, this slot is not visible to it until fcount is increased
+      slot = &fring[(fhead+fcount)%fring.size()];
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Decode(slot, entry);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bool faulty = slot->status<1;
+    {
+      lock_guard<mutex> lock(fmutex);
+      freadtime += elapsed;
+      fcount++;
+      if(faulty)
+	fdone = true;
+    }
+    fnotempty.notify_one();
+    if(faulty)
+      return;
+  }
+  {
+    lock_guard<mutex> lock(fmutex);
+    fdone = true;
+  }
+  fnotempty.notify_one();
+}
+
+/*!
+  Read one entry directly into the objects of a slot
+  \param slot the slot of the ring buffer
+  \param entry the entry number
+*/
+void StreamReader::Decode(streamentry* slot, unsigned int entry){
+  slot->entry = entry;
+  slot->TS = 0;
+  fTS = 0;
+  switch(ftype){
+  case kBigRIPS:
+    slot->beam->Clear();
+    fbeam = slot->beam;
+    for(unsigned short f=0;f<NFPLANES;f++){
+      slot->fp[f]->Clear();
+      ffp[f] = slot->fp[f];
+    }
+    slot->status = ftr->GetEvent(entry);
+    slot->TS = fTS;
+    break;
+  case kWASABI:
+    slot->wasabi->Clear();
+    fwasabi = slot->wasabi;
+    slot->status = ftr->GetEvent(entry);
+    slot->TS = fTS;
+    break;
+  case kEURICA:
+    slot->eurica->Clear();
+    slot->status = ftr->GetEvent(entry);
+    if(slot->status>0){
+      slot->TS = ((TArtEventInfo*) fEUeventinfo->At(0))->GetTimeStamp();
+      AddEURICAHits(slot->eurica, fEUcluster, fEUclusterAB, slot->TS, entry, 0);
+    }
+    break;
+  default:
+    slot->status = -1;
+    break;
+  }
+}
+
+/*!
+  Convert the EURICA clusters above 1 keV into hits
+  \param eurica the object to add the hits to
+  \param cluster the clusters
+  \param clusterAB the clusters after addback
+  \param ts the timestamp of the entry
+  \param entry the entry number, for printing
+  \param verbose the verbose level
+*/
+void StreamReader::AddEURICAHits(EURICA* eurica, TClonesArray* cluster, TClonesArray* clusterAB, unsigned long long int ts, unsigned int entry, int verbose){
+  //cout << "cluster->GetEntries() " << cluster->GetEntries() << "\tclusterAB->GetEntries() " << clusterAB->GetEntries() << endl;
+  for(int i=0;i<cluster->GetEntries();i++){
+    TArtGeCluster *hit =(TArtGeCluster*) cluster->At(i);
+    if(hit->GetEnergy()>1){
+      if(verbose>2)
+	cout << entry << "\t" << i <<"\t" << hit->GetEnergy() << "\t" << hit->GetTiming() << endl;
+
+      EURICAHit *euhit = new EURICAHit(hit->GetChannel(),hit->GetEnergy(),hit->GetTiming(),1,ts);
+      eurica->AddHit(euhit);
+    }
+  }
+  for(int i=0;i<clusterAB->GetEntries();i++){
+    TArtGeCluster *hit =(TArtGeCluster*) clusterAB->At(i);
+    if(hit->GetEnergy()>1){
+      if(verbose>2)
+	cout << entry << "\t" << i <<"\t" << hit->GetEnergy() << "\t" << hit->GetTiming() << endl;
+
+      EURICAHit *euhit = new EURICAHit(hit->GetChannel(),hit->GetEnergy(),hit->GetTiming(),1,ts);
+      eurica->AddHitAB(euhit);
+    }
+  }
+}
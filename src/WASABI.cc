@@ -1,15 +1,4 @@
 #include "WASABI.hh"
-/*!
-  Sort the hits by their energy, first the one with the lowest energy
-  \param hits a vector with the unsorted hits
-  \return a vector with the sorted hits
-*/
-vector<WASABIHit*> DSSSD::Revert(vector<WASABIHit*> hits){
-  sort(hits.begin(), hits.end(), WASABIHitComparer());
-  reverse(hits.begin(), hits.end());
-  return hits;
-}
-
 /*!
   Sort the hits by their energy, first the one with the highest energy
   \param hits a vector with the unsorted hits
@@ -20,99 +9,77 @@ vector<WASABIHit*> DSSSD::Sort(vector<WASABIHit*> hits){
   return hits;
 }
 /*!
-  Addback neighboring hits
+  Addback neighboring hits, separately for the X and Y strips
 */
 void DSSSD::Addback(){
   //cout << "addback" << endl;
-  vector<WASABIHit*> unusedhits;
-  unusedhits.clear();
-  for(unsigned short i=0;i<fhitsX.size();i++){
-    unusedhits.push_back((WASABIHit*)fhitsX.at(i)->Clone());	
-  }
-  unusedhits = Revert(unusedhits);
-  while(unusedhits.size() > 0){
-    //first one is automatically good
-    vector<WASABIHit*> currenthits; //current hits contains all hits that have already been added to thishit, to still know their positions
-    currenthits.push_back(unusedhits.back());
-    WASABIHit* thishit = unusedhits.back();
-    unusedhits.pop_back();
-
-    // how many hits added
-    int added = 0;
-    do{
-      added =0;
-      int addme =-1;
-      bool found = false;
-      for(unsigned short k=0;k<currenthits.size();k++){
-	for(unsigned short j=0;j<unusedhits.size();j++){
-	  if(Addback(currenthits.at(k),unusedhits.at(j))){	    
-	    addme = j;
-	    found = true;
-	    break;
-	  }
-	}//loop unused hits
-	if(found)
-	  break;
-      }//loop add back hits
-      if(found && addme >-1){
-	added++;
-	currenthits.push_back(unusedhits.at(addme));
-	thishit->AddBackHit(unusedhits.at(addme));
-	unusedhits.erase(unusedhits.begin() + addme);
-      }
-    }while(added>0);//do
-    //done with addback for thishit
-    //add the addbacked hit into the vector
-    AddABHitX(thishit);
-  }//while unused hits
+  Cluster(fhitsX, NXSTRIPS);
+  for(vector<pair<double,WASABIHit*> >::iterator cl=fclusters.begin(); cl!=fclusters.end(); cl++)
+    AddABHitX(cl->second);
+  Cluster(fhitsY, NYSTRIPS);
+  for(vector<pair<double,WASABIHit*> >::iterator cl=fclusters.begin(); cl!=fclusters.end(); cl++)
+    AddABHitY(cl->second);
+  //Print();
+}
 
-  //addback Ystrips
-  unusedhits.clear();
-  for(unsigned short i=0;i<fhitsY.size();i++){
-    unusedhits.push_back((WASABIHit*)fhitsY.at(i)->Clone());	
+/*!
+  Find the clusters of hits in neighboring strips in one pass over the strips.
+  A cluster is a run of consecutive strips with hits, a single strip with several hits gives one cluster per hit.
+  The addback hit is a copy of the hit with the highest energy, with the energies of all hits of the cluster added.
+  \param hits the hits of one side
+  \param nstrips the number of strips of this side
+  The clusters are stored in fclusters, ordered by the highest energy in the cluster, high to low
+*/
+void DSSSD::Cluster(const vector<WASABIHit*>& hits, short nstrips){
+  fclusters.clear();
+  //list of the hits of each strip, fnexthit links to the next hit in the same strip, -1 ends a list
+  short firsthit[NXSTRIPS > NYSTRIPS ? NXSTRIPS : NYSTRIPS];
+  for(short s=0; s<nstrips; s++)
+    firsthit[s] = -1;
+  fnexthit.resize(hits.size());
+  for(short i=hits.size()-1; i>=0; i--){
+    short s = hits[i]->GetStrip();
+    if(s<0 || s>=nstrips){
+      //strips outside of the detector have no neighbors
+      fclusters.push_back(make_pair(hits[i]->GetEn(), NewHit(hits[i])));
+      continue;
+    }
+    fnexthit[i] = firsthit[s];
+    firsthit[s] = i;
   }
-  unusedhits = Revert(unusedhits);
-  while(unusedhits.size() > 0){
-    //first one is automatically good
-    vector<WASABIHit*> currenthits; //current hits contains all hits that have already been added to thishit, to still know their positions
-    currenthits.push_back(unusedhits.back());
-    WASABIHit* thishit = unusedhits.back();
-    unusedhits.pop_back();
-
-    // how many hits added
-    int added = 0;
-    do{
-      added =0;
-      int addme =-1;
-      bool found = false;
-      for(unsigned short k=0;k<currenthits.size();k++){
-	for(unsigned short j=0;j<unusedhits.size();j++){
-	  if(Addback(currenthits.at(k),unusedhits.at(j))){	    
-	    addme = j;
-	    found = true;
-	    break;
-	  }
-	}//loop unused hits
-	if(found)
-	  break;
-      }//loop add back hits
-      if(found && addme >-1){
-	added++;
-	currenthits.push_back(unusedhits.at(addme));
-	thishit->AddBackHit(unusedhits.at(addme));
-	unusedhits.erase(unusedhits.begin() + addme);
+  short s = 0;
+  while(s<nstrips){
+    if(firsthit[s]<0){
+      s++;
+      continue;
+    }
+    short start = s;
+    while(s<nstrips && firsthit[s]>-1)
+      s++;
+    if(s-start==1){
+      //hits in the same strip are not neighbors
+      for(short i=firsthit[start]; i>-1; i=fnexthit[i])
+	fclusters.push_back(make_pair(hits[i]->GetEn(), NewHit(hits[i])));
+      continue;
+    }
+    //the hit with the highest energy is the seed of the cluster
+    short seed = firsthit[start];
+    for(short t=start; t<s; t++){
+      for(short i=firsthit[t]; i>-1; i=fnexthit[i]){
+	if(hits[i]->GetEn() > hits[seed]->GetEn())
+	  seed = i;
       }
-    }while(added>0);//do
-    //done with addback for thishit
-    //add the addbacked hit into the vector
-    AddABHitY(thishit);
-  }//while unused hits
-
-
-
-  
-  //Print();
-
+    }
+    WASABIHit* abhit = NewHit(hits[seed]);
+    for(short t=start; t<s; t++){
+      for(short i=firsthit[t]; i>-1; i=fnexthit[i]){
+	if(i!=seed)
+	  abhit->AddBackHit(hits[i]);
+      }
+    }
+    fclusters.push_back(make_pair(hits[seed]->GetEn(), abhit));
+  }
+  stable_sort(fclusters.begin(), fclusters.end(), ClusterComparer());
 }
 
 /*!
@@ -126,3 +93,143 @@ bool DSSSD::Addback(WASABIHit* hit0, WASABIHit* hit1){
     return true;
   return false;
 }
+
+/*!
+  Clear the columns, the storage of the arrays is kept
+*/
+void WASABIColumns::Clear(Option_t *option){
+  for(int i=0; i<NDSSSD*kNSIDES+1; i++)
+    ffirst[i] = 0;
+  for(int d=0; d<NDSSSD; d++){
+    fvetoX[d] = false;
+    fvetoY[d] = false;
+    fimplantX[d] = -1;
+    fimplantY[d] = -1;
+  }
+  fdsssdnr.clear();
+  fside.clear();
+  fstrip.clear();
+  fen.clear();
+  fiscal.clear();
+  fhitsadded.clear();
+  ftime0.clear();
+  fntimes.clear();
+  ftimeoffset.clear();
+  ftimes.clear();
+}
+
+/*!
+  Fill the columns from a WASABI event
+  \param wasabi the event
+*/
+void WASABIColumns::Set(WASABI* wasabi){
+  Clear();
+  for(int d=0; d<NDSSSD; d++){
+    DSSSD* dsssd = wasabi->GetDSSSD(d);
+    fvetoX[d] = dsssd->IsVetoX();
+    fvetoY[d] = dsssd->IsVetoY();
+    fimplantX[d] = dsssd->ImplantX();
+    fimplantY[d] = dsssd->ImplantY();
+    for(short side=0; side<kNSIDES; side++){
+      ffirst[d*kNSIDES+side] = fstrip.size();
+      AddHits(dsssd, side);
+    }
+  }
+  ffirst[NDSSSD*kNSIDES] = fstrip.size();
+}
+
+/*!
+  Add the hits of one vector of a DSSSD to the columns
+  \param dsssd the DSSSD
+  \param side the hit vector, see hitSide
+*/
+void WASABIColumns::AddHits(DSSSD* dsssd, short side){
+  unsigned short mult = 0;
+  switch(side){
+  case kSideX:
+    mult = dsssd->GetMultX();
+    break;
+  case kSideY:
+    mult = dsssd->GetMultY();
+    break;
+  case kSideABX:
+    mult = dsssd->GetMultABX();
+    break;
+  case kSideABY:
+    mult = dsssd->GetMultABY();
+    break;
+  default:
+    break;
+  }
+  for(unsigned short n=0; n<mult; n++){
+    WASABIHit* hit = NULL;
+    switch(side){
+    case kSideX:
+      hit = dsssd->GetHitX(n);
+      break;
+    case kSideY:
+      hit = dsssd->GetHitY(n);
+      break;
+    case kSideABX:
+      hit = dsssd->GetHitABX(n);
+      break;
+    case kSideABY:
+      hit = dsssd->GetHitABY(n);
+      break;
+    default:
+      break;
+    }
+    const vector<double>& times = hit->GetTime();
+    fdsssdnr.push_back(dsssd->GetDSSSD());
+    fside.push_back(side);
+    fstrip.push_back(hit->GetStrip());
+    fen.push_back(hit->GetEn());
+    fiscal.push_back(hit->IsCal());
+    fhitsadded.push_back(hit->GetHitsAdded());
+    ftime0.push_back(hit->GetTime0());
+    fntimes.push_back(times.size());
+    ftimeoffset.push_back(ftimes.size());
+    ftimes.insert(ftimes.end(), times.begin(), times.end());
+  }
+}
+
+/*!
+  Fill a WASABI event from the columns, the hits are taken from the pools of the DSSSDs
+  \param wasabi the event to be filled, it is cleared first
+*/
+void WASABIColumns::Get(WASABI* wasabi){
+  wasabi->Clear();
+  for(int d=0; d<NDSSSD; d++){
+    DSSSD* dsssd = wasabi->GetDSSSD(d);
+    if(fvetoX[d])
+      dsssd->SetVetoX();
+    if(fvetoY[d])
+      dsssd->SetVetoY();
+    dsssd->SetImplantX(fimplantX[d]);
+    dsssd->SetImplantY(fimplantY[d]);
+    for(short side=0; side<kNSIDES; side++){
+      for(unsigned int i=ffirst[d*kNSIDES+side]; i<ffirst[d*kNSIDES+side+1]; i++){
+	WASABIHit* hit = dsssd->NewHit(fstrip[i], fen[i], fiscal[i]);
+	hit->SetHitsAdded(fhitsadded[i]);
+	for(unsigned short t=0; t<fntimes[i]; t++)
+	  hit->SetTime(ftimes[ftimeoffset[i]+t]);
+	switch(side){
+	case kSideX:
+	  dsssd->AddHitX(hit);
+	  break;
+	case kSideY:
+	  dsssd->AddHitY(hit);
+	  break;
+	case kSideABX:
+	  dsssd->AddABHitX(hit);
+	  break;
+	case kSideABY:
+	  dsssd->AddABHitY(hit);
+	  break;
+	default:
+	  break;
+	}
+      }
+    }
+  }
+}